@@ -5,11 +5,14 @@
  * This file provides the instantations of the abstract semantics template class
  * so that a single source file can handle compiling the object code.
  * Files wanting to use abstract semantics should include THIS file.
+ * It also names the UnrolledSemanticsTemplate instantiations (which need no separate code generation).
  */
 
 #include "AbstractSemanticsTemplate.h"
+#include "BoxBoundedDisjunctsDomainDropoutInstantiation.h"
 #include "BoxStateDomainDropoutInstantiation.h"
 #include "BoxDisjunctsDomainDropoutInstantiation.h"
+#include "UnrolledSemanticsTemplate.hpp"
 
 
 // Forward-declare the types to get code generation
@@ -20,4 +23,8 @@ template class AbstractSemanticsTemplate<BoxDisjunctsDomainDropoutInstantiation:
 typedef AbstractSemanticsTemplate<BoxDropoutDomain::AbstractionType> BoxDropoutSemantics;
 typedef AbstractSemanticsTemplate<BoxDisjunctsDomainDropoutInstantiation::AbstractionType> BoxDisjunctsDropoutSemantics;
 
+typedef UnrolledSemanticsTemplate<BoxDropoutDomain> BoxDropoutUnrolledSemantics;
+typedef UnrolledSemanticsTemplate<BoxDisjunctsDomainDropoutInstantiation> BoxDisjunctsDropoutUnrolledSemantics;
+typedef UnrolledSemanticsTemplate<BoxBoundedDisjunctsDomainDropoutInstantiation> BoxBoundedDisjunctsDropoutUnrolledSemantics;
+
 #endif
@@ -18,7 +18,6 @@ private:
     void parseRelation(DataSet *data, bool booleanized, int label_ind);
     void parseData(DataSet *data, float thres);
 
-    float stofloat(string s);
     vector<string> readNominal(string vals);
     map<string, int> makeNominalMap(vector<string> tags);
     string trimBrackets(string s); 
@@ -27,6 +26,7 @@ private:
     map<string, int> label_map;
     vector<string> labels;
     int label_id;
+    int num_attributes; // Including the label and ignored attributes
     map<int, map<string, int> > boolean_maps; // stores mapping info for boolean attributes (index + val = boolean val)
     set<int> ignored_inds; // indices with nominal data that is not used 
     Error* err_handler; 
@@ -2,18 +2,20 @@
 #define ARFFSCANNER_H
 
 #include "Error.h"
+#include "TextTokenizer.h"
 
 #include <string> 
 #include <iostream> 
-#include <fstream>
 #include <sstream>
+#include <vector>
 
 using namespace std;
 
 class ArffScanner {
 private:
     string file;
-    ifstream fp;
+    string contents; // The whole file, read up front
+    size_t position; // Start of the next line in contents
     Error *err_handler; 
 
 public: 
@@ -22,6 +24,10 @@ public:
 
     bool nextLine();
     std::string nextWord();
+    // The lines after the current one, skipping blank and comment lines;
+    // they point into this scanner, so it must outlive them
+    std::vector<TextLine> remainingLines();
+    bool isFatal() { return err_handler->isFatal(); }
     int lineNum; 
     bool isEOF;
     string curLine; 
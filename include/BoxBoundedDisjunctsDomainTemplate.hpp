@@ -5,10 +5,12 @@
 #include "BoxStateDomainTemplate.hpp"
 #include "CommonEnums.h"
 #include "Feature.hpp"
+#include "RunProfile.h"
 #include "StateDomainTemplate.hpp"
+#include <algorithm> // for std::lower_bound
 #include <forward_list>
 #include <queue> // for priority_queue
-#include <set>
+#include <utility>
 #include <vector>
 
 
@@ -30,9 +32,17 @@ public:
 private:
     // The main operation of combining disjuncts uses a priority queue to greedily merge pairs.
     // We need some auxiliary types for this.
+    // Disjuncts are referred to by pointer, but ordered by when they appeared
+    // (the original disjuncts in order, then each merged one), never by address,
+    // so that which pairs get merged and the order of the result don't depend on where things were allocated.
+    struct DisjunctRef {
+        unsigned int order;
+        const typename Types::Single *disjunct;
+        bool operator <(const DisjunctRef &right) const { return order < right.order; }
+    };
     struct ScoreTuple {
-        const typename Types::Single *e1;
-        const typename Types::Single *e2;
+        DisjunctRef e1;
+        DisjunctRef e2;
         S score;
     };
     struct GreaterThanForScoreTuple { // The comparator for the priority queue
@@ -40,17 +50,32 @@ private:
             // std::priority_queue prioritizes the maximal element by this ordering;
             // we would like b to be higher priority than a (i.e. this function returns true)
             // exactly when a's imprecision increase/score is greater than b's.
-            return a.score > b.score;
+            // Ties go to the pair that appeared first.
+            if(a.score != b.score) {
+                return a.score > b.score;
+            }
+            return std::make_pair(a.e1.order, a.e2.order) > std::make_pair(b.e1.order, b.e2.order);
         }
     };
     typedef std::priority_queue<ScoreTuple, std::vector<ScoreTuple>, GreaterThanForScoreTuple> ScoreQueue;
+    // The disjuncts currently included, in order, plus whether each order is included.
+    // A disjunct leaves for good when it is merged (the merge gets a fresh order), so queued pairs are
+    // invalidated lazily: selectMerge drops a pair when it surfaces with either side no longer included.
+    struct Included {
+        std::vector<DisjunctRef> refs; // Sorted by order
+        std::vector<bool> by_order;
+        unsigned int size() const { return refs.size(); }
+        bool contains(const DisjunctRef &ref) const { return ref.order < by_order.size() && by_order[ref.order]; }
+        void insert(const DisjunctRef &ref);
+        void erase(const DisjunctRef &ref);
+    };
 
     typename Types::Many combined(const typename Types::Many &element) const;
     // Some subroutines for the above
-    void initializeMerging(ScoreQueue &score_queue, std::set<const typename Types::Single *> &included, std::queue<const typename Types::Single *> &pending, const typename Types::Many &disjuncts) const;
-    ScoreTuple selectMerge(ScoreQueue &score_queue, const std::set<const typename Types::Single *> &included) const;
-    void performMerge(const ScoreTuple &to_merge, ScoreQueue &score_queue, std::set<const typename Types::Single *> &included, std::forward_list<typename Types::Single> &new_disjuncts) const;
-    void prepareNextGreedyStep(ScoreQueue &score_queue, std::set<const typename Types::Single *> &included, std::queue<const typename Types::Single *> &pending) const;
+    void initializeMerging(ScoreQueue &score_queue, Included &included, std::queue<DisjunctRef> &pending, const typename Types::Many &disjuncts) const;
+    ScoreTuple selectMerge(ScoreQueue &score_queue, const Included &included) const;
+    void performMerge(const ScoreTuple &to_merge, ScoreQueue &score_queue, Included &included, std::forward_list<typename Types::Single> &new_disjuncts, unsigned int &next_order) const;
+    void prepareNextGreedyStep(ScoreQueue &score_queue, Included &included, std::queue<DisjunctRef> &pending) const;
 
     unsigned int max_num_disjuncts;
     DisjunctsMergeMode merge_mode;
@@ -93,17 +118,19 @@ typename BoxDisjunctsTypes<T,P,D>::Many BoxBoundedDisjunctsDomainTemplate<T,P,D,
     if(element.size() <= max_num_disjuncts) {
         return element;
     }
+    PROFILE_SCOPE(COMBINED);
 
     ScoreQueue score_queue;
-    // included stores pointers to disjuncts in elements, new_disjuncts, and pending.
-    std::set<const typename Types::Single *> included;
+    // included stores references to disjuncts in elements, new_disjuncts, and pending.
+    Included included;
     // We keep track of pointers to elements in the following container, so we can't use vector,
     // since when the vector is resized etc the memory locations of the objects can change.
     std::forward_list<typename Types::Single> new_disjuncts;
-    // pending contains pointers to elements that are not yet in included.
+    // pending contains references to elements that are not yet in included.
     // Note that this is only non-empty for DisjunctsMergeMode::GREEDY,
     // since with DisjunctsMergeMode::OPTIMAL all of the disjuncts are initially included.
-    std::queue<const typename Types::Single *> pending;
+    std::queue<DisjunctRef> pending;
+    unsigned int next_order = element.size(); // For merged disjuncts
 
     // In general, in DisjunctsMergeMode::OPTIMAL we put all of the disjuncts into included and reduce one-by-one.
     // In DisjunctsMergeMode::GREEDY we put max_num_disjuncts+1 disjuncts into included, the rest into pending,
@@ -111,7 +138,7 @@ typename BoxDisjunctsTypes<T,P,D>::Many BoxBoundedDisjunctsDomainTemplate<T,P,D,
     initializeMerging(score_queue, included, pending, element);
     while(included.size() > max_num_disjuncts) {
         ScoreTuple to_merge = selectMerge(score_queue, included);
-        performMerge(to_merge, score_queue, included, new_disjuncts);
+        performMerge(to_merge, score_queue, included, new_disjuncts, next_order);
         if(merge_mode == DisjunctsMergeMode::GREEDY) {
             prepareNextGreedyStep(score_queue, included, pending);
         }
@@ -119,76 +146,93 @@ typename BoxDisjunctsTypes<T,P,D>::Many BoxBoundedDisjunctsDomainTemplate<T,P,D,
 
     // Finally, we construct the return object from the disjuncts to be included
     typename Types::Many ret;
-    for(auto i = included.begin(); i != included.end(); i++) {
-        ret.push_back(**i);
+    for(auto i = included.refs.cbegin(); i != included.refs.cend(); i++) {
+        ret.push_back(*i->disjunct);
     }
     return ret;
 }
 
 template <typename T, typename P, typename D, typename S>
-void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::initializeMerging(ScoreQueue &score_queue, std::set<const typename Types::Single *> &included, std::queue<const typename Types::Single *> &pending, const typename Types::Many &disjuncts) const {
+inline void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::Included::insert(const DisjunctRef &ref) {
+    refs.insert(std::lower_bound(refs.begin(), refs.end(), ref), ref);
+    if(ref.order >= by_order.size()) {
+        by_order.resize(ref.order + 1, false);
+    }
+    by_order[ref.order] = true;
+}
+
+template <typename T, typename P, typename D, typename S>
+inline void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::Included::erase(const DisjunctRef &ref) {
+    auto found = std::lower_bound(refs.begin(), refs.end(), ref);
+    if(found != refs.end() && found->order == ref.order) {
+        refs.erase(found);
+        by_order[ref.order] = false;
+    }
+}
+
+template <typename T, typename P, typename D, typename S>
+void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::initializeMerging(ScoreQueue &score_queue, Included &included, std::queue<DisjunctRef> &pending, const typename Types::Many &disjuncts) const {
     if(merge_mode == DisjunctsMergeMode::OPTIMAL) {
-        // Initially, included has a pointer to each of the original disjuncts
-        for(auto i = disjuncts.cbegin(); i != disjuncts.cend(); i++) {
-            included.insert(&*i);
+        // Initially, included has a reference to each of the original disjuncts
+        for(unsigned int i = 0; i < disjuncts.size(); i++) {
+            included.insert({i, &disjuncts[i]});
         }
     } else { // i.e. merge_mode == DisjunctsMergeMode::GREEDY
-        // Initially, included has a pointer to only the first max_num_disjuncts+1 elements
-        auto disjuncts_iter = disjuncts.begin();
-        for(unsigned int i = 0; i < max_num_disjuncts + 1; i++, disjuncts_iter++) {
+        // Initially, included has a reference to only the first max_num_disjuncts+1 elements
+        unsigned int i = 0;
+        for(; i < max_num_disjuncts + 1; i++) {
             // Because this whole function is called in the else-branch of a check that disjuncts.size() <= max_num_disjuncts,
-            // we can loop based on numeric values without worrying about the vector iterator being out-of-bounds.
-            included.insert(&*disjuncts_iter);
+            // we can loop based on numeric values without worrying about being out-of-bounds.
+            included.insert({i, &disjuncts[i]});
         }
         // And the remainder are stored in pending
-        for(/*from where disjuncts_iter left off*/; disjuncts_iter != disjuncts.end(); disjuncts_iter++) {
-            pending.push(&*disjuncts_iter);
+        for(/*from where i left off*/; i < disjuncts.size(); i++) {
+            pending.push({i, &disjuncts[i]});
         }
     }
     // In either case, scores for each pair of elements in included are added to the score queue
-    for(auto i = included.cbegin(); i != included.cend(); i++) {
-        for(auto j = i; j != included.cend(); j++) {
-            if(i == j) {
-                continue;
-            }
-            ScoreTuple temp = {*i, *j, joinPrecisionLoss(**i, **j)};
-            score_queue.push(temp);
+    std::vector<ScoreTuple> scores;
+    for(auto i = included.refs.cbegin(); i != included.refs.cend(); i++) {
+        for(auto j = i + 1; j != included.refs.cend(); j++) {
+            scores.push_back({*i, *j, joinPrecisionLoss(*i->disjunct, *j->disjunct)});
         }
     }
+    score_queue = ScoreQueue(GreaterThanForScoreTuple(), std::move(scores)); // Heapifies in linear time
 }
 
 template <typename T, typename P, typename D, typename S>
-typename BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::ScoreTuple BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::selectMerge(ScoreQueue &score_queue, const std::set<const typename Types::Single *> &included) const {
+typename BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::ScoreTuple BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::selectMerge(ScoreQueue &score_queue, const Included &included) const {
     ScoreTuple ret;
     do {
         ret = score_queue.top();
         score_queue.pop();
-    } while(included.find(ret.e1) == included.end() || included.find(ret.e2) == included.end());
+    } while(!included.contains(ret.e1) || !included.contains(ret.e2));
     // XXX it should be an invariant that this loop always terminates in a correct fashion, but could be cleaner
     return ret;
 }
 
 template <typename T, typename P, typename D, typename S>
-void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::performMerge(const ScoreTuple &to_merge, ScoreQueue &score_queue, std::set<const typename Types::Single *> &included, std::forward_list<typename Types::Single> &new_disjuncts) const {
+void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::performMerge(const ScoreTuple &to_merge, ScoreQueue &score_queue, Included &included, std::forward_list<typename Types::Single> &new_disjuncts, unsigned int &next_order) const {
     included.erase(to_merge.e1);
     included.erase(to_merge.e2);
-    new_disjuncts.push_front(disjuncts_domain->box_domain->binary_join(*to_merge.e1, *to_merge.e2));
+    new_disjuncts.push_front(disjuncts_domain->box_domain->binary_join(*to_merge.e1.disjunct, *to_merge.e2.disjunct));
+    DisjunctRef merged = {next_order++, &new_disjuncts.front()};
     // We first compute the relevant scores to add to the priority queue
     // before adding the new disjunct to included.
-    for(auto i = included.begin(); i != included.end(); i++) {
-        ScoreTuple temp = {*i, &new_disjuncts.front(), joinPrecisionLoss(**i, new_disjuncts.front())};
+    for(auto i = included.refs.cbegin(); i != included.refs.cend(); i++) {
+        ScoreTuple temp = {*i, merged, joinPrecisionLoss(*i->disjunct, *merged.disjunct)};
         score_queue.push(temp);
     }
-    included.insert(&new_disjuncts.front());
+    included.insert(merged);
 }
 
 template <typename T, typename P, typename D, typename S>
-void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::prepareNextGreedyStep(ScoreQueue &score_queue, std::set<const typename Types::Single *> &included, std::queue<const typename Types::Single *> &pending) const {
+void BoxBoundedDisjunctsDomainTemplate<T,P,D,S>::prepareNextGreedyStep(ScoreQueue &score_queue, Included &included, std::queue<DisjunctRef> &pending) const {
     // For DisjunctsMergeMode::GREEDY, we have to move something from pending to included and add relevant scores to the ScoreQueue.
     // Note that in DisjunctsMergeMode::OPTIMAL pending is always empty.
     if(pending.size() > 0) {
-        for(auto i = included.begin(); i != included.end(); i++) {
-            ScoreTuple temp = {*i, pending.front(), joinPrecisionLoss(**i, *pending.front())};
+        for(auto i = included.refs.cbegin(); i != included.refs.cend(); i++) {
+            ScoreTuple temp = {*i, pending.front(), joinPrecisionLoss(*i->disjunct, *pending.front().disjunct)};
             score_queue.push(temp);
         }
         included.insert(pending.front());
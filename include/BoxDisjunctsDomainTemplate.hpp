@@ -4,16 +4,13 @@
 #include "BoxStateDomainTemplate.hpp"
 #include "Feature.hpp"
 #include "StateDomainTemplate.hpp"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <optional>
 #include <utility>
 #include <vector>
 #include <iostream>
 
-// We'll output some information about the number of disjuncts
-// when -DDEBUG is given as a g++ argument
-#ifdef DEBUG
-#include <iostream>
-#endif
-
 template <typename T, typename P, typename D>
 struct BoxDisjunctsTypes {
     typedef BoxStateDomainTemplate<T,P,D> SingleDomain;
@@ -37,10 +34,20 @@ private:
     // The filter cases are slightly different
     typename Types::Many filterAndUnion(const typename Types::Many &element, bool negated) const;
 
+    // Disjuncts are transformed independently, so with a pool they are farmed out to it;
+    // each result lands in its disjunct's slot, so the order of the result doesn't depend on scheduling
+    ThreadPool *pool = NULL; // Optional; not owned
+    template <typename F>
+    void forEachDisjunct(std::size_t num_disjuncts, const F &f) const;
+
 public:
     const typename Types::SingleDomain *box_domain;
+    // With fewer disjuncts than this, parallelizing costs more than it saves
+    static const std::size_t PARALLEL_GRAIN_SIZE = 4;
 
     BoxDisjunctsDomainTemplate(const typename Types::SingleDomain *box_domain) { this->box_domain = box_domain; }
+    // The box domain must then be safe to use from several threads at once (BoxDropoutDomain is)
+    void setThreadPool(ThreadPool *pool) { this->pool = pool; }
 
     virtual std::vector<std::pair<T, P>> filter(const T &training_set_abstraction, const P &predicate_abstraction) const = 0;
     virtual std::vector<std::pair<T, P>> filterNegated(const T &training_set_abstraction, const P &predicate_abstraction) const = 0;
@@ -69,13 +76,31 @@ public:
  * BoxDisjunctsDomain member functions.
  */
 
+template <typename T, typename P, typename D>
+template <typename F>
+inline void BoxDisjunctsDomainTemplate<T,P,D>::forEachDisjunct(std::size_t num_disjuncts, const F &f) const {
+    if(pool == NULL || num_disjuncts < PARALLEL_GRAIN_SIZE) {
+        for(std::size_t i = 0; i < num_disjuncts; i++) {
+            f(i);
+        }
+        return;
+    }
+    parallelFor(pool, 0, num_disjuncts, 1, f);
+}
+
 template <typename T, typename P, typename D>
 inline typename BoxDisjunctsTypes<T,P,D>::Many BoxDisjunctsDomainTemplate<T,P,D>::transformEachDisjunct(const typename Types::Many &element, typename Types::Single (Types::SingleDomain::*fptr)(const typename Types::Single&) const) const {
-    typename Types::Many ret;
-    for(auto i = element.cbegin(); i != element.cend(); i++) {
-        typename Types::Single temp = (box_domain->*fptr)(*i);
+    std::vector<std::optional<typename Types::Single>> results(element.size());
+    forEachDisjunct(element.size(), [this, &element, &results, fptr](std::size_t i) {
+        typename Types::Single temp = (box_domain->*fptr)(element[i]);
         if(!box_domain->isBottomElement(temp)) {
-            ret.push_back(temp);
+            results[i] = std::move(temp);
+        }
+    });
+    typename Types::Many ret;
+    for(auto i = results.begin(); i != results.end(); i++) {
+        if(i->has_value()) {
+            ret.push_back(std::move(i->value()));
         }
     }
     return ret;
@@ -83,11 +108,17 @@ inline typename BoxDisjunctsTypes<T,P,D>::Many BoxDisjunctsDomainTemplate<T,P,D>
 
 template <typename T, typename P, typename D>
 inline typename BoxDisjunctsTypes<T,P,D>::Many BoxDisjunctsDomainTemplate<T,P,D>::transformEachDisjunct(const typename Types::Many &element, typename Types::Single (Types::SingleDomain::*fptr)(const typename Types::Single&, const FeatureVector&) const, const FeatureVector &x) const {
-    typename Types::Many ret;
-    for(auto i = element.cbegin(); i != element.cend(); i++) {
-        typename Types::Single temp = (box_domain->*fptr)(*i, x);
+    std::vector<std::optional<typename Types::Single>> results(element.size());
+    forEachDisjunct(element.size(), [this, &element, &results, fptr, &x](std::size_t i) {
+        typename Types::Single temp = (box_domain->*fptr)(element[i], x);
         if(!box_domain->isBottomElement(temp)) {
-            ret.push_back(temp);
+            results[i] = std::move(temp);
+        }
+    });
+    typename Types::Many ret;
+    for(auto i = results.begin(); i != results.end(); i++) {
+        if(i->has_value()) {
+            ret.push_back(std::move(i->value()));
         }
     }
     return ret;
@@ -95,29 +126,25 @@ inline typename BoxDisjunctsTypes<T,P,D>::Many BoxDisjunctsDomainTemplate<T,P,D>
 
 template <typename T, typename P, typename D>
 typename BoxDisjunctsTypes<T,P,D>::Many BoxDisjunctsDomainTemplate<T,P,D>::filterAndUnion(const typename Types::Many &element, bool negated) const {
-    typename Types::Many ret;
-    // For each disjunct
-    for(auto i = element.cbegin(); i != element.cend(); i++) {
+    // For each disjunct, its own results
+    std::vector<typename Types::Many> results(element.size());
+    forEachDisjunct(element.size(), [this, &element, &results, negated](std::size_t i) {
         // We get some number of <T,P> disjuncts back
         std::vector<std::pair<T, P>> temp;
         if(!negated) {
-            temp = filter(i->training_set_abstraction, i->predicate_abstraction);
+            temp = filter(element[i].training_set_abstraction, element[i].predicate_abstraction);
         } else {
-            temp = filterNegated(i->training_set_abstraction, i->predicate_abstraction);
+            temp = filterNegated(element[i].training_set_abstraction, element[i].predicate_abstraction);
         }
         // Put all of them (with the appropriate posterior distribution abstract added) into the to-be-returned
         for(auto j = temp.cbegin(); j != temp.cend(); j++) {
-            typename Types::Single temp_box = {j->first, j->second, i->posterior_distribution_abstraction};
+            typename Types::Single temp_box = {j->first, j->second, element[i].posterior_distribution_abstraction};
             if(!box_domain->isBottomElement(temp_box)) {
-                ret.push_back(temp_box);
+                results[i].push_back(temp_box);
             }
         }
-    }
-
-#ifdef DEBUG
-    std::cout << "exiting filterAndUnion with " << ret.size() << " disjuncts" << std::endl;
-#endif
-    return ret;
+    });
+    return join(results);
 }
 
 template <typename T, typename P, typename D>
@@ -0,0 +1,72 @@
+#ifndef BOXDISJUNCTSDROPOUTTRACE_H
+#define BOXDISJUNCTSDROPOUTTRACE_H
+
+#include "BoxStateDomainDropoutInstantiation.h"
+#include "DropoutDomains.hpp"
+#include "Feature.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Running the (unbounded) disjuncts domain over buildTree(depth) for a test input
+ * mostly redoes work that has nothing to do with the test input:
+ * every disjunct's training set is the initial one filtered along a path of predicates,
+ * and bestSplit, filtering, and summary only ever look at training sets.
+ * The test input just decides, at each ITEModelsNode,
+ * which predicates survive meetXModelsPhi and meetXNotModelsPhi.
+ *
+ * A BoxDisjunctsDropoutTrace is the tree of disjuncts that the program can reach
+ * from a fixed initial state, shared by every test input.
+ * Each node is one disjunct at the start of a buildTreeUnit, and holds
+ *   - the posteriors of the x-independent branches (impurity zero, no predicate), already summarized;
+ *   - the (non-bottom) predicates bestSplit gives it; and
+ *   - per predicate, the disjuncts that filtering (and filtering negated) by it produces.
+ * This relies on the disjuncts domain filtering by a set of predicates one predicate at a time,
+ * i.e. filter(T, P) being the concatenation of filter(T, {phi}) over phi in P, which it does.
+ * Replaying a test input walks down the nodes whose predicate the input could (not) model,
+ * collecting the posteriors of the disjuncts that reach the return statement;
+ * their join is exactly what BoxDisjunctsDropoutSemantics::execute would have produced.
+ *
+ * Nodes are built lazily, by the first replay to reach them,
+ * so building a trace never costs more than the runs it replaces.
+ * Replays may run concurrently.
+ */
+
+
+class BoxDisjunctsDropoutTrace {
+public:
+    typedef BoxDropoutDomain::AbstractionType Single;
+
+private:
+    struct Node;
+    // Some disjuncts a transformer produces, built by whichever replay needs them first
+    struct Successors {
+        std::once_flag built;
+        std::vector<std::unique_ptr<Node>> nodes;
+    };
+    struct Node {
+        Single state;
+        int depth; // How many buildTreeUnit's are left to run from here
+        std::vector<PosteriorDistributionAbstraction> posteriors; // Of the branches that don't consult the test input
+        PredicateAbstraction predicates; // Non-bottom, so only for depth > 0
+        std::vector<Successors> models, not_models; // Indexed like predicates; filtered by phi and by !phi resp.
+    };
+
+    DropoutDomains domains;
+    Single initial_state;
+    int depth;
+    Successors root;
+
+    std::unique_ptr<Node> buildNode(const Single &state, int depth) const;
+    const std::vector<std::unique_ptr<Node>>& successors(Node &node, unsigned int predicate_index, bool positive_flag);
+    void replay(Node &node, const FeatureVector &x, std::vector<PosteriorDistributionAbstraction> &posteriors);
+
+public:
+    BoxDisjunctsDropoutTrace(const Single &initial_state, int depth, BoxDropoutMemo *memo);
+
+    PosteriorDistributionAbstraction run(const FeatureVector &x);
+};
+
+
+#endif
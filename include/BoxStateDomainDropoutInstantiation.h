@@ -6,10 +6,15 @@
 #include "DataReferences.h"
 #include "Feature.hpp"
 #include "Interval.h"
+#include "LRUCache.hpp"
+#include "PredicateAbstraction.h"
+#include "RowBitset.hpp"
 #include "SymbolicPredicate.hpp"
+#include <cstddef>
 #include <list>
 #include <optional>
 #include <utility>
+#include <variant>
 #include <vector>
 
 
@@ -48,7 +53,9 @@ public:
     int feature_flip_index;
     float feature_flip_amt;
 
-    TrainingReferencesWithDropout() {} // Constructed like this should be a bottom element
+    // Constructed like this should be a bottom element
+    TrainingReferencesWithDropout() : num_dropout(0), num_add(0), add_sens_info(-1, 0), num_labels_flip(0), label_sens_info(-1, 0),
+                                      num_features_flip(0), feature_flip_index(-1), feature_flip_amt(0) {}
     TrainingReferencesWithDropout(DataReferences training_references, int num_dropout, int num_add, std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info, int num_features_flip, int feature_flip_index, float feature_flip_amt);
 
     std::vector<int> baseCounts() const;
@@ -58,7 +65,27 @@ public:
 };
 
 
-typedef std::vector<std::optional<SymbolicPredicate>> PredicateAbstraction;
+// TrainingReferencesWithDropout::splitCounts for many thresholds on one numeric feature:
+// with per-class prefix counts over the rows sorted by that feature, each threshold costs two binary searches,
+// and thresholds can be asked for in any order. first is what filter(phi, true) keeps, and second what filter(phi, false) keeps.
+class SortedSplitCounts {
+private:
+    const TrainingReferencesWithDropout *training_set_abstraction;
+    unsigned int num_categories;
+    float feature_flip_band; // feature_flip_amt if the feature can be flipped, else 0
+    std::vector<float> sorted_values;
+    std::vector<int> prefix_counts; // Row i (of size() + 1, num_categories wide) counts the labels of the first i sorted rows
+    std::vector<int> prefix_sensitive; // How many of the first i sorted rows are label-flipping targets (one-sided only)
+
+    // The rows in [begin, end) of the sorted order, num_maybes of which could be on either side
+    void countSide(TrainingReferencesWithDropout::DropoutCounts &ret, unsigned int begin, unsigned int end, int num_maybes) const;
+
+public:
+    SortedSplitCounts(const TrainingReferencesWithDropout &training_set_abstraction, int feature_index); // Keeps a pointer
+
+    std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDropout::DropoutCounts> operator()(const SymbolicPredicate &phi) const;
+};
+
 
 typedef CategoricalDistribution<Interval<double>> PosteriorDistributionAbstraction;
 
@@ -97,6 +124,60 @@ public:
 };
 
 
+/**
+ * Neither bestSplit nor filtering by a predicate look at the test input,
+ * yet the same training set abstraction reaches them over and over
+ * (from different disjuncts, and from every test point that shares the top of the tree).
+ * A BoxDropoutMemo remembers their results, keyed by the whole training set abstraction
+ * (its rows and all of its budgets) plus, for filtering, the predicate.
+ * It is shared between runs (see ExperimentBackend) and is thread-safe.
+ * Not everything is worth remembering: summary just counts labels, which is cheaper than a lookup,
+ * and the disjuncts domain's per-disjunct filters rarely repeat once disjuncts multiply.
+ */
+
+
+// A TrainingReferencesWithDropout stored as a row bitset (rather than a list of indices): cheap to copy, hash, and compare
+struct PackedTrainingReferencesWithDropout {
+    const DataSet *data_set; // NULL for the bottom element
+    RowBitset rows;
+    int num_dropout;
+    int num_add;
+    std::pair<int, int> add_sens_info;
+    int num_labels_flip;
+    std::pair<int, int> label_sens_info;
+    int num_features_flip;
+    int feature_flip_index;
+    float feature_flip_amt;
+
+    PackedTrainingReferencesWithDropout(const TrainingReferencesWithDropout &element);
+    TrainingReferencesWithDropout unpack() const;
+
+    bool operator ==(const PackedTrainingReferencesWithDropout &right) const;
+    size_t hash() const;
+    size_t memoryUsage() const; // Roughly, in bytes
+};
+
+struct BoxDropoutMemoKey {
+    enum class Operation { BEST_SPLIT, FILTER, FILTER_NEGATED };
+    Operation operation;
+    PackedTrainingReferencesWithDropout training_set_abstraction;
+    std::optional<SymbolicPredicate> predicate; // Only for FILTER and FILTER_NEGATED
+
+    bool operator ==(const BoxDropoutMemoKey &right) const;
+};
+
+struct hash_BoxDropoutMemoKey {
+    size_t operator()(const BoxDropoutMemoKey &key) const;
+};
+
+typedef std::variant<PredicateAbstraction, PackedTrainingReferencesWithDropout> BoxDropoutMemoValue;
+
+class BoxDropoutMemo : public LRUCache<BoxDropoutMemoKey, BoxDropoutMemoValue, hash_BoxDropoutMemoKey> {
+public:
+    using LRUCache::LRUCache;
+};
+
+
 /**
  * Finally, the remaining box domain subclass
  */
@@ -105,19 +186,27 @@ public:
 class BoxDropoutDomain : public BoxStateDomainTemplate<TrainingReferencesWithDropout, PredicateAbstraction, PosteriorDistributionAbstraction> {
 private:
     typedef std::pair<SymbolicPredicate, Interval<double>> ScoreEntry;
+    // bestSplit's candidates, gathered in one pass: a predicate is exists-nontrivial if some perturbation of the training set
+    // splits it nontrivially, and forall-nontrivial if every one does. bestSplit keeps the exists-nontrivial predicates
+    // whose score could beat the least upper bound among the forall-nontrivial ones,
+    // so with that bound kept as we go, anything whose lower bound is already above it can be dropped on the spot
+    struct SplitCandidates {
+        std::vector<ScoreEntry> kept; // In the order they were scored
+        std::optional<double> min_upper_bound; // Over the forall-nontrivial candidates so far
+        size_t compact_at = 64; // kept.size() at which to drop what the bound has since overtaken
+
+        void add(const SymbolicPredicate &phi, const Interval<double> &score, bool forall_nontrivial);
+    };
     void computePredicatesAndScores(
-            std::list<ScoreEntry> &exists_nontrivial,
-            std::list<const ScoreEntry *> &forall_nontrivial,
+            SplitCandidates &candidates,
             const TrainingReferencesWithDropout &training_set_abstraction,
             int feature_index ) const;
     void computeBooleanFeaturePredicateAndScore(
-            std::list<ScoreEntry> &exists_nontrivial,
-            std::list<const ScoreEntry *> &forall_nontrivial,
+            SplitCandidates &candidates,
             const TrainingReferencesWithDropout &training_set_abstraction,
             int feature_index ) const;
     void computeNumericFeaturePredicatesAndScores(
-            std::list<ScoreEntry> &exists_nontrivial,
-            std::list<const ScoreEntry *> &forall_nontrivial,
+            SplitCandidates &candidates,
             const TrainingReferencesWithDropout &training_set_abstraction,
             int feature_index ) const;
     /*void updateSplitCountsDropout(
@@ -130,9 +219,15 @@ private:
          std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDropout::DropoutCounts> &split_counts
     ) const;*/
 
+    BoxDropoutMemo *memo = NULL; // Optional; not owned
+    PredicateAbstraction computeBestSplit(const TrainingReferencesWithDropout &training_set_abstraction) const;
+    TrainingReferencesWithDropout filterAndJoin(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction, bool positive_flag) const;
+
 public:
     using BoxStateDomainTemplate::BoxStateDomainTemplate; // Inherit the constructor
 
+    void setMemo(BoxDropoutMemo *memo) { this->memo = memo; } // NULL turns memoization off
+
     PredicateAbstraction bestSplit(const TrainingReferencesWithDropout &training_set_abstraction) const;
     TrainingReferencesWithDropout filter(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction) const;
     TrainingReferencesWithDropout filterNegated(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction) const;
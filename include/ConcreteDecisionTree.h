@@ -0,0 +1,44 @@
+#ifndef CONCRETEDECISIONTREE_H
+#define CONCRETEDECISIONTREE_H
+
+#include "CategoricalDistribution.hpp"
+#include "ConcreteTrainingReferences.h"
+#include "DataReferences.h"
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include "Predicate.hpp"
+#include <optional>
+#include <vector>
+
+/**
+ * ConcreteSemantics runs buildTree(depth) for a single test input,
+ * so it only ever learns the one path of the tree that input takes.
+ * ConcreteDecisionTree learns every path of the same program at once
+ * (with the same isPure/bestSplit/filter/summary of ConcreteTrainingReferences),
+ * after which it classifies any number of inputs without retraining:
+ * classify(x) is exactly what ConcreteSemantics::execute(x, ...) would return.
+ */
+
+
+class ConcreteDecisionTree {
+public:
+    struct Node {
+        std::optional<Predicate> phi; // Internal nodes only
+        unsigned int satisfied, unsatisfied; // For internal nodes, the children (as indices into the nodes) for x models phi, and not
+        CategoricalDistribution<double> posterior; // Leaves only
+    };
+
+private:
+    std::vector<Node> nodes; // The root is nodes[0]
+    unsigned int grow(ConcreteTrainingReferences training_references, int depth); // Returns the new node's index
+
+public:
+    ConcreteDecisionTree(const DataSet *training_set, int depth);
+    ConcreteDecisionTree(const DataReferences &training_references, int depth);
+
+    const CategoricalDistribution<double>& classify(const FeatureVector &x) const;
+    const std::vector<Node>& getNodes() const { return nodes; }
+};
+
+
+#endif
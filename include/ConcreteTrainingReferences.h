@@ -20,10 +20,21 @@ private:
     std::vector<int> sampleCounts() const;
     std::pair<std::vector<int>, std::vector<int>> splitCounts(const Predicate &phi) const;
 
+    // bestSplit's running minimum: the first predicate (in feature order, then threshold order) with the least joint impurity
+    struct SplitSearch {
+        std::optional<Predicate> best_predicate;
+        double best_score;
+
+        bool improvedBy(double score) const { return !best_predicate.has_value() || score < best_score; }
+        void update(const Predicate &phi, double score) { best_predicate = phi; best_score = score; }
+        // Joint impurities are never negative, so nothing scored later can replace a 0
+        bool done() const { return best_predicate.has_value() && best_score == 0; }
+    };
+
     std::list<Predicate> gatherPredicates() const;
-    void computePredicatesAndScores(std::list<std::pair<Predicate, double>> &store, int feature_index) const;
-    void computeBooleanFeaturePredicateAndScore(std::list<std::pair<Predicate, double>> &store, int feature_index) const;
-    void computeNumericFeaturePredicatesAndScores(std::list<std::pair<Predicate, double>> &store, int feature_index) const;
+    void computePredicatesAndScores(SplitSearch &search, int feature_index) const;
+    void computeBooleanFeaturePredicateAndScore(SplitSearch &search, int feature_index) const;
+    void computeNumericFeaturePredicatesAndScores(SplitSearch &search, int feature_index) const;
 
 public:
     ConcreteTrainingReferences() {}
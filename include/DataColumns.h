@@ -0,0 +1,165 @@
+#ifndef DATACOLUMNS_H
+#define DATACOLUMNS_H
+
+/**
+ * DataSet.hpp stores a data set row by row,
+ * which is the convenient shape for loading files and for handing around a single test input.
+ * Training, on the other hand, mostly asks about one feature across many rows
+ * (e.g. scoring every threshold of a numeric feature),
+ * and reading x[feature_index] out of a row means chasing the row's heap-allocated FeatureVector.
+ * This file provides a column-major (structure-of-arrays) copy of the same data,
+ * typed by the FeatureVectorHeader alone (a cell doesn't carry its type, as a Feature does):
+ * a numeric feature is a dense float array, a boolean feature is a bitmap of the rows where it is true
+ * (a bit per row, so e.g. booleanized MNIST takes a few MB), and the labels are one int array.
+ * Each numeric column also carries its rows presorted by value,
+ * so that split search never has to sort (see DataReferences::sortedRows),
+ * and each label has a bitmap of the rows carrying it, so that counting is by popcount.
+ *
+ * The arrays are either owned (filled by setRow or the bulk setters)
+ * or viewed in place in a mapped snapshot (see DataSetCache.h), so that a training set bigger than memory
+ * is paged in from disk as it is scanned instead of being resident; only the bitmaps (a bit per row) are held in memory.
+ * Scans over many rows go a chunk of CHUNK_ROWS rows at a time and call willNeed on the next chunk,
+ * which asks the kernel to start reading it in (and does nothing for owned arrays).
+ */
+
+#include "Feature.hpp"
+#include "RowBitset.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+// A read-only run of row indices (what std::span<const int> would be);
+// it points into a vector or a mapping that must outlive it
+class RowSpan {
+private:
+    const int *first;
+    const int *last;
+
+public:
+    RowSpan() : first(NULL), last(NULL) {}
+    RowSpan(const int *first, std::size_t length) : first(first), last(first + length) {}
+    RowSpan(const std::vector<int> &rows) : first(rows.data()), last(rows.data() + rows.size()) {}
+
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    const int* cbegin() const { return first; }
+    const int* cend() const { return last; }
+    const int* data() const { return first; }
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    int operator [](std::size_t i) const { return first[i]; }
+
+    bool operator ==(const RowSpan &right) const { return size() == right.size() && std::equal(first, last, right.first); }
+    bool operator !=(const RowSpan &right) const { return !(*this == right); }
+};
+
+
+class DataColumns {
+private:
+    FeatureVectorHeader feature_types;
+    unsigned int num_rows;
+    // Owned storage, indexed by feature; only populated for numeric features (and not for columns viewed in place)
+    std::vector<std::vector<float>> numeric_columns;
+    std::vector<int> labels;
+    std::vector<std::vector<int>> sorted_rows; // Indexed by feature; only populated for numeric features
+    // What the accessors read: the owned storage above, or the mapping
+    std::vector<const float*> numeric_data;
+    const int *label_data;
+    std::vector<RowSpan> sorted_data;
+    std::shared_ptr<const void> mapping; // Keeps viewed arrays alive; NULL when everything is owned
+
+    std::vector<RowBitset> label_rows; // Indexed by label
+    std::vector<RowBitset> boolean_rows; // Indexed by feature; only populated for boolean features (this is their storage)
+
+public:
+    static const unsigned int CHUNK_ROWS = 1 << 16;
+
+    DataColumns(const FeatureVectorHeader &feature_types, unsigned int num_rows);
+    // For columns to be viewed in place in mapping (with the view* members below); allocates nothing per row
+    DataColumns(const FeatureVectorHeader &feature_types, unsigned int num_rows, std::shared_ptr<const void> mapping);
+    DataColumns(const DataColumns &) = delete; // The views point into this object's own storage
+    DataColumns& operator=(const DataColumns &) = delete;
+
+    // Copies one row into the columns (by the header's types; missing trailing features are left as 0)
+    void setRow(unsigned int row, const FeatureVector &x, int y);
+    // Bulk alternatives to setRow, for columns that were built before (see DataSetCache.h).
+    // A numeric column may come with its sortedRows order, which finalize() then trusts rather than sorting.
+    void setNumericColumn(unsigned int feature_index, const float *values, const int *sorted = NULL);
+    void setBooleanColumn(unsigned int feature_index, const uint64_t *words); // Laid out as RowBitset::data()
+    void setLabels(const int *labels);
+    // As the setters, but the arrays (inside the mapping) are used where they are rather than copied.
+    // A viewed numeric column must come with its order.
+    void viewNumericColumn(unsigned int feature_index, const float *values, const int *sorted);
+    void viewLabels(const int *labels);
+    // (Boolean columns are always copied: at a bit per row they are small.)
+    // Builds sortedRows and labelRows; must be called once all rows are set (and before either is used)
+    void finalize();
+
+    unsigned int size() const { return num_rows; }
+    const FeatureVectorHeader& getFeatureTypes() const { return feature_types; }
+    bool isMapped() const { return mapping != NULL; }
+    // A hint that the rows [first_row, last_row) of the feature (and their labels) are about to be scanned
+    void willNeed(unsigned int feature_index, unsigned int first_row, unsigned int last_row) const;
+
+    // Raw column access for scans; no check that feature_index has the matching type
+    const float* numericColumn(unsigned int feature_index) const { return numeric_data[feature_index]; }
+    const int* labelColumn() const { return label_data; }
+
+    float getNumericValue(unsigned int row, unsigned int feature_index) const { return numeric_data[feature_index][row]; }
+    bool getBooleanValue(unsigned int row, unsigned int feature_index) const { return boolean_rows[feature_index].test(row); }
+    int getLabel(unsigned int row) const { return label_data[row]; }
+
+    // Every row, in nondecreasing order of the numeric feature's value (ties by row)
+    RowSpan sortedRows(unsigned int feature_index) const { return sorted_data[feature_index]; }
+    // The rows with the given label (empty beyond the largest label seen)
+    const std::vector<RowBitset>& labelRows() const { return label_rows; }
+    // The rows where the boolean feature is true (the column itself; raw access for scans)
+    const RowBitset& booleanRows(unsigned int feature_index) const { return boolean_rows[feature_index]; }
+};
+
+
+/**
+ * Holds a lazily-built DataColumns for a DataSet.
+ * Building is thread-safe (the batch mode constructs DataReferences concurrently),
+ * and copying a DataSet does not copy its columns: the copy builds its own on demand.
+ */
+class DataColumnsCache {
+private:
+    mutable std::atomic<const DataColumns*> columns;
+    mutable std::mutex build_mutex;
+
+public:
+    DataColumnsCache() : columns(NULL) {}
+    DataColumnsCache(const DataColumnsCache &) : columns(NULL) {}
+    DataColumnsCache& operator=(const DataColumnsCache &) { reset(); return *this; }
+    ~DataColumnsCache() { delete columns.load(); }
+
+    void reset() { delete columns.exchange(NULL); }
+
+    // build() should return a newly allocated DataColumns; the cache takes ownership
+    template <typename Builder>
+    const DataColumns& get(const Builder &build) const;
+};
+
+
+template <typename Builder>
+inline const DataColumns& DataColumnsCache::get(const Builder &build) const {
+    const DataColumns *ret = columns.load(std::memory_order_acquire);
+    if(ret == NULL) {
+        std::lock_guard<std::mutex> lock(build_mutex);
+        ret = columns.load(std::memory_order_relaxed);
+        if(ret == NULL) {
+            ret = build();
+            columns.store(ret, std::memory_order_release);
+        }
+    }
+    return *ret;
+}
+
+
+#endif
@@ -7,31 +7,73 @@
  * Its much more efficient to introduce a single level of indirection:
  * accordingly, this file defines a data set interface that keeps track of
  * element addresses from a single, read-only DataSet.
+ *
+ * Scans over the referenced elements should prefer the column accessors
+ * (getColumns() with getIndex(i), or getLabel(i)) to operator [],
+ * which hands back a whole row.
+ * For numeric features, sortedRows() gives the referenced rows already in order of value:
+ * it is derived (lazily, in linear time) by stably filtering the order of a set we were cut down from,
+ * bottoming out at the order DataColumns presorted at load time.
+ *
+ * Alongside the (positional) list of indices, membership is kept as a RowBitset over the data set's rows,
+ * so that union, intersection, and label counts work a machine word at a time.
+ *
+ * The abstract transformers copy training sets (inside every state they return) far more often than they change them,
+ * so the indices and bitset are shared, read-only, between copies: copying a DataReferences is a reference count bump,
+ * and remove/filter build fresh ones (copy-on-write). The last copy to go frees them.
  */
 
+#include "DataColumns.h"
 #include "DataSet.hpp"
+#include "RowBitset.hpp"
+#include <cstddef> // for NULL
+#include <memory>
 #include <vector>
 
 
 class DataReferences {
 private:
     const DataSet *data_set; // Does not handle deallocation
-    std::vector<int> indices; // Invariant: this is kept sorted
+    const DataColumns *columns; // data_set->columns(), looked up once
+    struct Rows {
+        std::vector<int> indices; // Invariant: this is kept sorted
+        RowBitset members; // Invariant: exactly the rows in indices
+    };
+    std::shared_ptr<const Rows> rows; // Never NULL; shared between copies, so never modified in place
+    static const std::shared_ptr<const Rows>& emptyRows(); // Shared by every default-constructed object
+    struct SortedRowsCache; // Defined in DataReferences.cpp
+    std::shared_ptr<const SortedRowsCache> sorted_rows; // NULL when indices is every row of data_set
+    void deriveSortedRows(); // Called after indices shrinks
 
 public:
-    DataReferences() { data_set = NULL; indices = {}; }
+    DataReferences() { data_set = NULL; columns = NULL; rows = emptyRows(); sorted_rows = NULL; }
     DataReferences(const DataSet *data_set);
     DataReferences(const DataSet *data_set, const std::vector<int> &indices);
+    DataReferences(const DataSet *data_set, const RowBitset &members);
 
     // Some accessors for the underlying DataSet fields
     const FeatureVectorHeader& getFeatureTypes() const { return data_set->feature_types; }
     int getNumCategories() const { return data_set->num_categories; }
+    const DataSet* getDataSet() const { return data_set; }
+    const RowBitset& getMembers() const { return rows->members; } // Enough to rebuild this object (see the RowBitset constructor)
+    const DataColumns& getColumns() const { return *columns; }
 
-    const DataRow& operator [](unsigned int i) const { return data_set->rows[indices[i]]; }
-    void remove(int index) { indices.erase(indices.begin() + index); }
-    unsigned int size() const { return indices.size(); }
+    const DataRow& operator [](unsigned int i) const { return data_set->rows[rows->indices[i]]; } // Not for column-only data sets
+    int getIndex(unsigned int i) const { return rows->indices[i]; } // The row of the i-th element in getColumns()
+    const std::vector<int>& getIndices() const { return rows->indices; } // Every getIndex(i), in order
+    int getLabel(unsigned int i) const { return columns->getLabel(rows->indices[i]); }
+    void remove(int index);
+    void filter(const std::vector<bool> &keep); // Keeps the i-th element iff keep[i]; much cheaper than repeated remove
+    unsigned int size() const { return rows->indices.size(); }
+    bool contains(int row) const { return rows->members.test(row); } // row as in getIndex
+
+    std::vector<int> labelCounts() const; // Indexed by category
+    // The rows (as in getIndex) of every element, in nondecreasing order of the numeric feature (ties by row)
+    RowSpan sortedRows(unsigned int feature_index) const;
 
     static DataReferences set_union(const DataReferences &e1, const DataReferences &e2);
+    static DataReferences set_intersection(const DataReferences &e1, const DataReferences &e2);
+    static unsigned int union_size(const DataReferences &e1, const DataReferences &e2); // Without building the union
 };
 
 
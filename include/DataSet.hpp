@@ -7,6 +7,7 @@
  * This file defines the general object for representing such a dataset.
  */
 
+#include "DataColumns.h"
 #include "Feature.hpp"
 #include <vector>
 
@@ -20,6 +21,33 @@ struct DataSet {
     FeatureVectorHeader feature_types; // Data about the X columns
     int num_categories; // Size of Y
     std::vector<DataRow> rows;
+    // A column-major copy of rows (see DataColumns.h), built the first time columns() is called.
+    // Loaders are free to edit rows until then, but not afterwards.
+    // A loader may instead install columns with no rows at all (a column-only training set, see DataSetCache.h),
+    // so training code goes by columns().size() and never reads rows.
+    DataColumnsCache column_cache;
+
+    const DataColumns& columns() const;
+    // Builds the columns and frees the rows, leaving a column-only data set
+    // (a FeatureVector row costs 8 bytes a feature, where a column costs 4, or a bit for booleans)
+    void dropRows();
 };
 
+
+inline const DataColumns& DataSet::columns() const {
+    return column_cache.get([this]() {
+        DataColumns *ret = new DataColumns(feature_types, rows.size());
+        for(unsigned int i = 0; i < rows.size(); i++) {
+            ret->setRow(i, rows[i].x, rows[i].y);
+        }
+        ret->finalize();
+        return ret;
+    });
+}
+
+inline void DataSet::dropRows() {
+    columns();
+    std::vector<DataRow>().swap(rows);
+}
+
 #endif
@@ -0,0 +1,45 @@
+#ifndef DATASETCACHE_H
+#define DATASETCACHE_H
+
+/**
+ * Parsing a data set from CSV, ARFF, or the MNIST files costs every bin/main invocation the same work,
+ * and sweep scripts start thousands of them.
+ * This file provides a binary snapshot of a fully loaded ExperimentData
+ * (what ExperimentDataWrangler hands out), written after the first parse and read on later runs.
+ *
+ * A snapshot is laid out the way DataColumns keeps the data, so loading it is bulk copies out of an mmap:
+ *     - a versioned header: magic, format version, a byte-order mark, and the key it was saved under
+ *       (which says how the sources were interpreted, e.g. the ARFF label index);
+ *     - the size and modification time of every source file, so edited sources invalidate the snapshot;
+ *     - the label table;
+ *     - for the training and then the test set: the feature types, the labels column,
+ *       and each feature's column (a boolean one as its bitmap's words),
+ *       with each numeric column's presorted row order (DataColumns::sortedRows), so loading doesn't sort either.
+ * Arrays are padded to 8 bytes so they can be read in place.
+ * A snapshot that doesn't match (or is truncated, or whose orders don't check out) is ignored, and the caller parses.
+ *
+ * The training set comes back column-only (no rows: only the test set's rows are ever read).
+ * It can also stay mapped: its DataColumns then view the snapshot in place,
+ * so the OS pages it in as training scans it and a training set bigger than memory still loads.
+ */
+
+#include "ExperimentDataWrangler.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+class DataSetCache {
+public:
+    static constexpr uint32_t VERSION = 3; // Bump whenever the layout (or what loaders produce) changes
+
+    // Returns NULL unless path holds a snapshot saved under key from sources as they are now.
+    // The training set is column-only; with map_training, it keeps the file mapped for as long as it lives.
+    static ExperimentData* load(const std::string &path, const std::string &key, const std::vector<std::string> &sources, bool map_training = false);
+    // Best effort (the data directory may be read-only): returns whether the snapshot was written.
+    // Writes a temporary file and renames it, so concurrent runs never see half a snapshot.
+    static bool save(const std::string &path, const std::string &key, const std::vector<std::string> &sources, const ExperimentData &data);
+};
+
+
+#endif
@@ -12,7 +12,10 @@ public:
     Error(); 
     void fatal(const std::string msg); 
     void fatal(int lineNum, const std::string msg); 
+    void fatal(int lineNum, int colNum, const std::string msg); 
     void warning(const std::string msg); 
+    void warning(int lineNum, const std::string msg); 
+    void warning(int lineNum, int colNum, const std::string msg); 
     bool isFatal(); 
     bool isWarning(); 
     void resetFatal(); 
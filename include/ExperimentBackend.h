@@ -1,18 +1,46 @@
 #ifndef EXPERIMENTBACKEND_H
 #define EXPERIMENTBACKEND_H
 
+#include "BoxDisjunctsDropoutTrace.h"
+#include "BoxStateDomainDropoutInstantiation.h"
 #include "CategoricalDistribution.hpp"
 #include "CommonEnums.h"
 #include "DataSet.hpp"
+#include "FlatDecisionTree.h"
 #include "Interval.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 
 class ExperimentBackend {
 private:
     const DataSet *training;
     const DataSet *test;
+    BoxDropoutMemo memo; // Shared by every abstract run (and thread) on this training set
+    bool use_memo;
+    // With use_trace, disjuncts runs replay a trace shared by every test index
+    // with the same depth and initial training set abstraction (the key's remaining fields)
+    typedef std::tuple<int, int, int, std::pair<int, int>, int, std::pair<int, int>, int, int, float> TraceKey;
+    std::map<TraceKey, std::shared_ptr<BoxDisjunctsDropoutTrace>> traces;
+    std::mutex traces_mutex;
+    bool use_trace;
+    ThreadPool *pool; // Optional; not owned
+    bool decision_only;
+    // Concrete runs learn the whole tree once per depth and classify every test index with it
+    std::map<int, std::unique_ptr<FlatDecisionTree>> concrete_trees;
+    std::mutex concrete_trees_mutex;
+
+    std::shared_ptr<BoxDisjunctsDropoutTrace> getTrace(int depth, const TrainingReferencesWithDropout &initial_training_set);
+    const FlatDecisionTree& getConcreteTree(int depth);
 
 public:
     template <typename T>
@@ -20,20 +48,47 @@ public:
         CategoricalDistribution<T> posterior;
         std::set<int> possible_classifications;
         int ground_truth;
+        bool cut_short = false; // Decision-only runs: stopped once more than one classification was possible
+    };
+    struct RadiusResult {
+        int radius; // The largest certified budget, or -1 when not even a budget of 0 is certified
+        Result<Interval<double>> at_radius; // The run at radius (at 0 when radius is -1)
+        int num_runs;
     };
    // bool use_label_flipping;
 
     ExperimentBackend(const DataSet *training, const DataSet *test);
 
+    static const size_t DEFAULT_MEMO_BYTES = (size_t)256 << 20;
+    void setMemoCapacity(size_t bytes) { memo.setCapacity(bytes); use_memo = (bytes > 0); } // 0 disables memoization
+    BoxDropoutMemo::Stats memoStats() const { return memo.stats(); }
+    void setUseTrace(bool use_trace) { this->use_trace = use_trace; } // Only affects run_abstract_disjuncts
+    // Abstract runs (other than trace replays) stop as soon as the point can't be certified,
+    // reporting only what they had joined by then
+    void setDecisionOnly(bool decision_only) { this->decision_only = decision_only; }
+    void setThreadPool(ThreadPool *pool) { this->pool = pool; } // Abstract runs fork branches (and transform disjuncts) on it
+
     int test_size() { return test->rows.size(); }
+    int training_size() const { return training->columns().size(); }
     int groundTruth(int test_index) const { return test->rows[test_index].y; }
 
     Result<double> run_concrete(int depth, int test_index);
+    // The fraction of the test indices whose concrete classification is just their ground truth
+    double concrete_accuracy(int depth, const std::vector<int> &test_indices);
+    bool save_concrete_tree(int depth, const std::string &path) { return getConcreteTree(depth).save(path); }
     Result<Interval<double>> run_abstract(int depth, int test_index, int num_dropout, int num_add, std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info, int num_features_flip, int feature_flip_index, float feature_flip_amt);
     Result<Interval<double>> run_abstract_disjuncts(int depth, int test_index, int num_dropout, int num_add, std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info, int num_features_flip, int feature_flip_index, float feature_flip_amt);
     Result<Interval<double>> run_abstract_bounded_disjuncts(int depth, int test_index, int num_dropout, int num_add, std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info, int num_features_flip, int feature_flip_index, float feature_flip_amt, int disjunct_bound, const DisjunctsMergeMode &merge_mode);
 
-    std::map<int,int> run_test(int depth, int test_index, int num_dropout, int num_trials, unsigned int seed);
+    // Finds the largest budget in [0, limit] that run certifies (a single possible classification),
+    // galloping through 1, 2, 4, ... until a budget isn't certified, then bisecting.
+    // Certification must be monotone in the budget (certifying a budget means certifying every smaller one).
+    static RadiusResult search_max_radius(int limit, const std::function<Result<Interval<double>>(int budget)> &run);
+
+    // For each test index, how often each class was predicted by concrete trees learned on num_trials random subsets,
+    // each without num_dropout rows (a tie counts for every tied class). Each subset's tree is learned once for all the
+    // test indices, and the trials run on the thread pool; the counts depend only on seed, not the number of threads.
+    std::vector<std::map<int,int>> run_test(int depth, const std::vector<int> &test_indices, int num_dropout, int num_trials, unsigned int seed);
 };
 
 
@@ -4,9 +4,11 @@
 #include "CommonEnums.h"
 #include "DataSet.hpp"
 #include "UCI.h"
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 /**
  * Since we have datasets from different kinds of sources,
@@ -15,6 +17,8 @@
  *     - training/test set division
  *     - conversion between CategoricalDistribution int indices and string names
  *     - loads from any of the different dataset sources
+ *     - keeps a binary snapshot of each loaded dataset next to its sources (see DataSetCache.h),
+ *       so later runs skip parsing, and (optionally) trains from it mapped in place
  */
 
 // Fetches return this structure. Note that they still need a DataReferences wrapper.
@@ -29,17 +33,32 @@ class ExperimentDataWrangler {
 private:
     std::map<ExperimentDataEnum, const ExperimentData*> cache;
     std::string path_prefix;
+    bool use_dataset_cache;
+    bool map_training_set;
 
+    std::vector<std::string> sourceFiles(const ExperimentDataEnum &dataset) const;
     void loadData(const ExperimentDataEnum &dataset);
+    ExperimentData* parseData(const ExperimentDataEnum &dataset); // NULL for USE_ARFF (see fetchArff)
     ExperimentData* loadSimplifiedMNIST(const std::pair<int, int> &classes, bool booleanized);
     ExperimentData* loadFullMNIST(bool booleanized);
     ExperimentData* loadUCI(const UCINames &dataset);
+    // Loads the snapshot if it is current, or else calls parse (NULL on failure) and saves one
+    ExperimentData* loadThroughSnapshot(const std::string &cache_path, const std::string &key, const std::vector<std::string> &sources,
+                                        const std::function<ExperimentData*()> &parse);
 
 public:
     ExperimentDataWrangler(const std::string &path_prefix);
     ~ExperimentDataWrangler(); // When destructed, deallocates all the fetch()'d data
 
+    void setUseDataSetCache(bool use_dataset_cache) { this->use_dataset_cache = use_dataset_cache; }
+    // Training sets then come back column-only, viewing their snapshot in place (see DataSetCache::load);
+    // a freshly parsed one is saved and then mapped back in, so that it doesn't stay resident.
+    // Has no effect without the snapshot cache.
+    void setMapTrainingSet(bool map_training_set) { this->map_training_set = map_training_set; }
+
     const ExperimentData* fetch(const ExperimentDataEnum &dataset);
+    // Through ArffParser::loadArff (with the same arguments); NULL if the files don't parse
+    const ExperimentData* fetchArff(const std::string &train_path, const std::string &test_path, bool booleanized, float thres, int label_ind);
 };
 
 
@@ -4,6 +4,11 @@
 #include "ArgParse.h"
 #include "ExperimentBackend.h"
 #include "ExperimentDataWrangler.h"
+#include "RunProfile.h"
+#include "ThreadPool.h"
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <string>
@@ -42,6 +47,9 @@ private:
         float feature_flip_amt;
         std::optional<int> disjunct_bound; // Optionally, has_value only when with_disjuncts is true
         DisjunctsMergeMode merge_mode; // For when disjunct_bound.has_value()
+        bool use_trace; // For when with_disjuncts and !disjunct_bound.has_value(): replay a trace shared by the test indices
+        bool decision_only; // Abstract runs stop once the test input can't be certified
+        std::optional<std::string> max_radius; // "n", "m" or "l": search for the largest certified budget of that kind (abstract only)
         struct RandomTest {
             bool flag; // Whether to do a random test
             int num_dropout;
@@ -55,6 +63,14 @@ private:
             int num_trials;
             unsigned int seed;
         } random_test;
+        unsigned int num_threads; // Test indices are run concurrently when this isn't 1 (0 means one per core)
+        bool use_dataset_cache; // Whether the wrangler may load (and save) binary snapshots of the dataset
+        bool out_of_core; // Whether the training set is used straight from its (mapped) snapshot
+        size_t memo_bytes; // Budget for ExperimentBackend's memo of abstract transformer results (0 disables it)
+        bool accuracy; // With concrete semantics, report accuracy per depth rather than results per test index
+        std::optional<std::string> save_tree_prefix; // With concrete semantics, where to save each depth's learned tree
+        bool profile; // Abstract runs (other than radius searches) report a RunProfile with their result
+        std::optional<std::string> chrome_trace_path; // Where to write the Chrome trace of those runs
     } params;
 
     bool verbose;
@@ -62,14 +78,25 @@ private:
     ExperimentBackend *e;
     ExperimentDataWrangler *wrangler;
     const ExperimentData *current_data; // the wrangler handles this deallocation
+    std::mutex output_mutex; // Batch mode has worker threads reporting progress
+    std::mutex traced_runs_mutex;
+    std::vector<std::pair<std::pair<int, int>, std::shared_ptr<RunProfile>>> traced_runs; // By (depth, test index), for params.chrome_trace_path
 
     void createCommandLineArguments();
-    void performSingleTest(int depth, int test_index);
-    void performAbstractTests(int depth, int test_index);
+    // These return the JSON result line (or {} when the test index is skipped)
+    std::optional<std::string> performSingleTest(int depth, int test_index);
+    std::string performAbstractTests(int depth, int test_index);
+    std::string performMaxRadiusTests(int depth, int test_index);
+    void performRandomTests(int depth, const std::vector<int> &test_indices); // Prints its results
+    // Runs the abstract semantics chosen by params, with these budgets in place of params' own
+    ExperimentBackend::Result<Interval<double>> runAbstract(int depth, int test_index, int num_dropout, int num_add, int num_labels_flip);
+    void performBatch(const std::vector<std::pair<int, int>> &jobs, ThreadPool &pool);
+    void writeChromeTrace();
 
     std::string output_to_json(int depth, int test_index, const ExperimentBackend::Result<double> &result);
-    std::string output_to_json(int depth, int test_index, const ExperimentBackend::Result<Interval<double>> &result);
+    std::string output_to_json(int depth, int test_index, const ExperimentBackend::Result<Interval<double>> &result, const RunProfile *profile = NULL);
     std::string output_to_json(int depth, int test_index, const std::map<int,int> &result);
+    std::string output_to_json(int depth, int test_index, const ExperimentBackend::RadiusResult &result);
 
     void output(const std::string &message, bool force=false);
 
@@ -19,11 +19,12 @@
  *   5) Ensuring Predicate.hpp supports it
  */
 
+#include <cstdint>
 #include <vector>
 
 
 // Each feature type needs an entry in the following enum:
-enum class FeatureType {
+enum class FeatureType : uint8_t {
     BOOLEAN,
     NUMERIC, // Any continuous-valued feature; internally, we'll use floats.
 };
@@ -58,6 +59,10 @@ public:
     const float& getNumericValue() const { return value.numeric_value; }
 };
 
+// A one-byte tag next to a four-byte union: test rows cost 8 bytes a feature.
+// (Training data lives in DataColumns, which keeps the type once per column instead.)
+static_assert(sizeof(Feature) == 8, "Feature should stay 8 bytes");
+
 
 // The intention is for a FeatureVectorHeader to specify the FeatureTypes
 // used in parallel FeatureVector instances.
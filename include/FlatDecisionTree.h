@@ -0,0 +1,80 @@
+#ifndef FLATDECISIONTREE_H
+#define FLATDECISIONTREE_H
+
+/**
+ * A learned ConcreteDecisionTree, flattened for evaluation and storage.
+ *
+ * The internal nodes are numbered in preorder, in parallel arrays: node i's predicate is
+ *     (x[features[i]] <= thresholds[i]) != negated[i]
+ * on the input as floats (a boolean feature is 1 for true and 0 for false, with threshold 0.5, negated),
+ * and children[2i] and children[2i + 1] are its children for x models phi and not.
+ * A child (or the root) is either an internal node, which always comes after its parent,
+ * or a leaf, tagged with the LEAF bit; leaves are numbered left to right, and their posteriors stored leaf by leaf.
+ * So the arrays grow with the number of nodes, not with 2^depth, however lopsided the learned tree is,
+ * and classifying an input is one step of index arithmetic per level it passes through.
+ *
+ * save/load write and read the same arrays, after a versioned header
+ * (magic, format version, byte-order mark, and the shape: depth, number of features, of categories and of internal nodes).
+ */
+
+#include "CategoricalDistribution.hpp"
+#include "ConcreteDecisionTree.h"
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+class FlatDecisionTree {
+private:
+    uint32_t depth;
+    uint32_t num_features;
+    uint32_t num_categories;
+    uint32_t root; // A child reference, as in children
+    std::vector<uint32_t> features; // Per internal node
+    std::vector<float> thresholds;
+    std::vector<uint8_t> negated;
+    std::vector<uint32_t> children; // Two per internal node
+    std::vector<double> posteriors; // num_categories per leaf (one more leaf than internal nodes), leaf by leaf
+
+    FlatDecisionTree() {}
+    uint32_t place(const ConcreteDecisionTree &tree, unsigned int node, unsigned int &num_leaves); // Returns the child reference
+
+public:
+    static constexpr uint32_t VERSION = 1; // Bump whenever the file layout changes
+    static constexpr uint32_t LEAF = 0x80000000u; // Tags a child reference as a leaf number
+
+    FlatDecisionTree(const ConcreteDecisionTree &tree, const FeatureVectorHeader &feature_types, unsigned int num_categories);
+
+    unsigned int getDepth() const { return depth; }
+    unsigned int numLeaves() const { return features.size() + 1; }
+
+    // The leaf (in [0, numLeaves())) that x, as floats (see above), ends up in
+    unsigned int leafOf(const float *x) const;
+    static void toFloats(const FeatureVector &x, std::vector<float> &out); // Resizes out
+    CategoricalDistribution<double> posterior(unsigned int leaf) const;
+
+    CategoricalDistribution<double> classify(const FeatureVector &x) const;
+    // The leaf of each of the given rows of data_set (which must have rows)
+    std::vector<unsigned int> leavesOf(const DataSet &data_set, const std::vector<int> &rows) const;
+
+    bool save(const std::string &path) const; // Returns whether the file was written
+    static std::optional<FlatDecisionTree> load(const std::string &path); // Empty if path doesn't hold a tree
+};
+
+
+/**
+ * FlatDecisionTree inline members
+ */
+
+inline unsigned int FlatDecisionTree::leafOf(const float *x) const {
+    uint32_t i = root;
+    while(!(i & LEAF)) {
+        i = children[2 * i + 1 - ((x[features[i]] <= thresholds[i]) != negated[i])];
+    }
+    return i & ~LEAF;
+}
+
+#endif
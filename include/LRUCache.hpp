@@ -0,0 +1,113 @@
+#ifndef LRUCACHE_HPP
+#define LRUCACHE_HPP
+
+/**
+ * A thread-safe memo table with a memory budget.
+ * Each entry is inserted along with (an estimate of) the bytes it occupies;
+ * once the total exceeds the budget, the least recently used entries are evicted.
+ * Lookups are counted as hits or misses so callers can report how useful the cache was.
+ *
+ * K needs operator== and a hash functor H; V is returned by copy.
+ */
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+
+template <typename K, typename V, typename H = std::hash<K>>
+class LRUCache {
+private:
+    struct Entry {
+        V value;
+        size_t bytes;
+        typename std::list<const K *>::iterator position; // In recency
+    };
+    std::unordered_map<K, Entry, H> entries;
+    std::list<const K *> recency; // Keys of entries, most recently used first (unordered_map never moves its keys)
+    size_t capacity_bytes;
+    size_t used_bytes;
+    unsigned long hits, misses, evictions;
+    mutable std::mutex mutex;
+
+    void evictDownTo(size_t bytes);
+
+public:
+    LRUCache(size_t capacity_bytes) : capacity_bytes(capacity_bytes), used_bytes(0), hits(0), misses(0), evictions(0) {}
+
+    std::optional<V> lookup(const K &key);
+    void insert(const K &key, const V &value, size_t bytes); // Not kept if bytes alone exceeds the budget
+    void setCapacity(size_t capacity_bytes);
+    void clear();
+
+    struct Stats {
+        unsigned long hits, misses, evictions;
+        size_t num_entries, used_bytes, capacity_bytes;
+    };
+    Stats stats() const;
+};
+
+
+template <typename K, typename V, typename H>
+void LRUCache<K,V,H>::evictDownTo(size_t bytes) {
+    while(used_bytes > bytes && !recency.empty()) {
+        auto entry = entries.find(*recency.back());
+        used_bytes -= entry->second.bytes;
+        recency.pop_back();
+        entries.erase(entry);
+        evictions++;
+    }
+}
+
+template <typename K, typename V, typename H>
+std::optional<V> LRUCache<K,V,H>::lookup(const K &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = entries.find(key);
+    if(entry == entries.end()) {
+        misses++;
+        return {};
+    }
+    hits++;
+    recency.splice(recency.begin(), recency, entry->second.position);
+    return entry->second.value;
+}
+
+template <typename K, typename V, typename H>
+void LRUCache<K,V,H>::insert(const K &key, const V &value, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(bytes > capacity_bytes || entries.find(key) != entries.end()) {
+        // Too big to keep, or another thread computed the same entry first
+        return;
+    }
+    evictDownTo(capacity_bytes - bytes);
+    auto inserted = entries.emplace(key, Entry{value, bytes, recency.end()}).first;
+    recency.push_front(&inserted->first);
+    inserted->second.position = recency.begin();
+    used_bytes += bytes;
+}
+
+template <typename K, typename V, typename H>
+void LRUCache<K,V,H>::setCapacity(size_t capacity_bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->capacity_bytes = capacity_bytes;
+    evictDownTo(capacity_bytes);
+}
+
+template <typename K, typename V, typename H>
+void LRUCache<K,V,H>::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    recency.clear();
+    used_bytes = 0;
+}
+
+template <typename K, typename V, typename H>
+typename LRUCache<K,V,H>::Stats LRUCache<K,V,H>::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return { hits, misses, evictions, entries.size(), used_bytes, capacity_bytes };
+}
+
+#endif
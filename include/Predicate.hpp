@@ -9,6 +9,7 @@
  * this file provides the general data type for such predicates.
  */
 
+#include "DataColumns.h"
 #include "Feature.hpp"
 
 
@@ -23,6 +24,15 @@ public:
     Predicate(int feature_index, float threshold); // Sets feature_Type = FeatureType::NUMERIC
 
     bool evaluate(const FeatureVector &x) const; // Does not check bounds
+    bool evaluate(const DataColumns &columns, unsigned int row) const; // Same, reading from the row-th entry of the columns
+    // Typed versions of the above for loops that have already switched on get_feature_type(),
+    // so that they don't switch again per row
+    bool evaluateBoolean(const DataColumns &columns, unsigned int row) const { return columns.getBooleanValue(row, feature_index); }
+    bool evaluateNumeric(const DataColumns &columns, unsigned int row) const { return columns.getNumericValue(row, feature_index) <= threshold; }
+
+    unsigned int get_feature_index() const { return feature_index; }
+    FeatureType get_feature_type() const { return feature_type; }
+    float get_threshold() const { return threshold; } // Only meaningful for FeatureType::NUMERIC
 };
 
 
@@ -55,4 +65,16 @@ inline bool Predicate::evaluate(const FeatureVector &x) const {
     }
 }
 
+inline bool Predicate::evaluate(const DataColumns &columns, unsigned int row) const {
+    switch(feature_type) {
+        case FeatureType::BOOLEAN:
+            return evaluateBoolean(columns, row);
+        case FeatureType::NUMERIC:
+            return evaluateNumeric(columns, row);
+        default:
+            // XXX see evaluate(const FeatureVector &)
+            return false;
+    }
+}
+
 #endif
@@ -0,0 +1,54 @@
+#ifndef PREDICATEABSTRACTION_H
+#define PREDICATEABSTRACTION_H
+
+#include "SymbolicPredicate.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * The abstract value of phi in the box domain: the predicates bestSplit could have chosen,
+ * and whether it could have found no split at all (phi == bot).
+ *
+ * The predicates are kept sorted (by SymbolicPredicate::operator<) and without duplicates,
+ * so equal sets have equal representations and joining two of them is a linear merge.
+ * bestSplit already produces its predicates in that order (by feature, then threshold),
+ * so sorting what it returns costs a single pass.
+ *
+ * Default constructed, this is the bottom element: no predicates, and no bot either.
+ */
+
+
+class PredicateAbstraction {
+private:
+    std::vector<SymbolicPredicate> predicates;
+    bool contains_bottom;
+
+public:
+    typedef std::vector<SymbolicPredicate>::const_iterator const_iterator;
+
+    PredicateAbstraction() : contains_bottom(false) {}
+    explicit PredicateAbstraction(const SymbolicPredicate &phi) : predicates(1, phi), contains_bottom(false) {}
+    explicit PredicateAbstraction(std::vector<SymbolicPredicate> predicates, bool contains_bottom = false); // In any order
+    static PredicateAbstraction onlyBottom() { return PredicateAbstraction({}, true); } // phi == bot, and nothing else
+
+    bool isBottomElement() const { return predicates.empty() && !contains_bottom; }
+    bool containsBottom() const { return contains_bottom; }
+    PredicateAbstraction withoutBottom() const;
+
+    // These only see the predicates (never bot)
+    unsigned int size() const { return predicates.size(); }
+    const SymbolicPredicate& operator [](unsigned int i) const { return predicates[i]; } // Note: no bounds check.
+    const SymbolicPredicate& back() const { return predicates.back(); }
+    const_iterator begin() const { return predicates.begin(); }
+    const_iterator end() const { return predicates.end(); }
+    const_iterator cbegin() const { return predicates.cbegin(); }
+    const_iterator cend() const { return predicates.cend(); }
+
+    static PredicateAbstraction join(const PredicateAbstraction &e1, const PredicateAbstraction &e2);
+
+    bool operator ==(const PredicateAbstraction &right) const;
+    size_t memoryUsage() const; // Roughly, in bytes
+};
+
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef ROWBITSET_HPP
+#define ROWBITSET_HPP
+
+/**
+ * A dense set of row numbers (of some DataSet), one bit per row.
+ * Set operations and counting work a 64-bit word at a time,
+ * which is what DataReferences uses to make union, intersection, and label counts cheap.
+ * Operations on two bitsets assume both were made for the same number of rows.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+class RowBitset {
+private:
+    std::vector<uint64_t> words;
+
+    static unsigned int popcount(uint64_t word) { return __builtin_popcountll(word); }
+    static unsigned int lowestBit(uint64_t word) { return __builtin_ctzll(word); } // word must be nonzero
+
+public:
+    RowBitset() {}
+    RowBitset(unsigned int num_rows) : words((num_rows + 63) / 64, 0) {}
+
+    void set(unsigned int row) { words[row / 64] |= (uint64_t)1 << (row % 64); }
+    void reset(unsigned int row) { words[row / 64] &= ~((uint64_t)1 << (row % 64)); }
+    void assign(unsigned int row, bool value) { if(value) { set(row); } else { reset(row); } }
+    bool test(unsigned int row) const { return (words[row / 64] >> (row % 64)) & 1; }
+    unsigned int numWords() const { return words.size(); }
+    const uint64_t* data() const { return words.data(); } // Row r is bit r % 64 of word r / 64
+    bool operator ==(const RowBitset &right) const { return words == right.words; }
+    size_t hash() const;
+
+    unsigned int count() const;
+    unsigned int countIntersection(const RowBitset &other) const; // |this & other|, without building it
+    void appendRows(std::vector<int> &out) const; // Appends the set rows in increasing order
+
+    static RowBitset fromWords(const uint64_t *words, unsigned int num_rows); // words laid out as data()
+    static RowBitset set_union(const RowBitset &b1, const RowBitset &b2);
+    static RowBitset set_intersection(const RowBitset &b1, const RowBitset &b2);
+};
+
+
+inline unsigned int RowBitset::count() const {
+    unsigned int ret = 0;
+    for(auto i = words.cbegin(); i != words.cend(); i++) {
+        ret += popcount(*i);
+    }
+    return ret;
+}
+
+inline unsigned int RowBitset::countIntersection(const RowBitset &other) const {
+    unsigned int ret = 0;
+    for(unsigned int i = 0; i < words.size(); i++) {
+        ret += popcount(words[i] & other.words[i]);
+    }
+    return ret;
+}
+
+inline size_t RowBitset::hash() const {
+    // FNV-1a over the words
+    uint64_t ret = 14695981039346656037ull;
+    for(auto i = words.cbegin(); i != words.cend(); i++) {
+        ret = (ret ^ *i) * 1099511628211ull;
+    }
+    return ret;
+}
+
+inline void RowBitset::appendRows(std::vector<int> &out) const {
+    for(unsigned int i = 0; i < words.size(); i++) {
+        for(uint64_t word = words[i]; word != 0; word &= word - 1) {
+            out.push_back(i * 64 + lowestBit(word));
+        }
+    }
+}
+
+inline RowBitset RowBitset::fromWords(const uint64_t *words, unsigned int num_rows) {
+    RowBitset ret;
+    ret.words.assign(words, words + (num_rows + 63) / 64);
+    return ret;
+}
+
+inline RowBitset RowBitset::set_union(const RowBitset &b1, const RowBitset &b2) {
+    RowBitset ret(b1);
+    for(unsigned int i = 0; i < ret.words.size(); i++) {
+        ret.words[i] |= b2.words[i];
+    }
+    return ret;
+}
+
+inline RowBitset RowBitset::set_intersection(const RowBitset &b1, const RowBitset &b2) {
+    RowBitset ret(b1);
+    for(unsigned int i = 0; i < ret.words.size(); i++) {
+        ret.words[i] &= b2.words[i];
+    }
+    return ret;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef RUNPROFILE_H
+#define RUNPROFILE_H
+
+/**
+ * Instrumentation for abstract runs, to see where one run's time (and memory) goes.
+ *
+ * A RunProfile collects, for one run:
+ *   - each abstract transformer's number of calls, wall time and bytes allocated
+ *     (on the calling thread, including any probes nested inside it,
+ *     and any task the thread ran while waiting on a TaskGroup);
+ *   - counts of intervals that came out backwards (lower bound above upper bound);
+ *   - for each level of the tree, a histogram of how many disjuncts reached it;
+ *   - the bytes allocated by every thread while working on the run;
+ *   - optionally, every timed call as an event, for a Chrome trace (chrome://tracing or Perfetto).
+ *
+ * Work is attributed through RunProfile::current(), a per-thread pointer that a RunProfile::Scope sets
+ * (and that TaskGroup hands on to the tasks it queues), so the domains need no plumbing
+ * and a thread without a profile pays one thread-local load per probe.
+ * The probes are the PROFILE_* macros below; building with -DNO_PROFILING compiles them
+ * (and the allocation counting) out altogether.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+class RunProfile {
+public:
+    enum class Probe : unsigned int {
+        // Timed
+        BEST_SPLIT, FILTER, FILTER_NEGATED, SUMMARY, JOIN, COMBINED,
+        // Counted
+        BACKWARDS_POSTERIOR, BACKWARDS_IMPURITY,
+        NUM_PROBES
+    };
+    static constexpr unsigned int NUM_PROBES = (unsigned int)Probe::NUM_PROBES;
+    static constexpr unsigned int MAX_DEPTH = 32; // Deeper levels are counted with the last one
+    static constexpr unsigned int NUM_BUCKETS = 16; // Bucket b holds sizes in [2^b, 2^(b+1)); the last also holds anything bigger
+    typedef std::chrono::steady_clock Clock;
+
+    // Makes profile (which may be NULL) the calling thread's current profile until destroyed,
+    // charging it with whatever the thread allocates meanwhile. Scopes nest.
+    class Scope {
+    private:
+        RunProfile *previous;
+    public:
+        explicit Scope(RunProfile *profile);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope& operator =(const Scope &) = delete;
+    };
+
+    // Records probe's call with the current profile (if any) when destroyed
+    class Timer {
+    private:
+        RunProfile *profile;
+        Probe probe;
+        Clock::time_point start;
+        uint64_t start_bytes;
+    public:
+        explicit Timer(Probe probe);
+        ~Timer();
+        Timer(const Timer &) = delete;
+        Timer& operator =(const Timer &) = delete;
+    };
+
+private:
+    struct Counter {
+        std::atomic<uint64_t> calls{0}, nanoseconds{0}, bytes{0};
+    };
+    struct Event {
+        Probe probe;
+        unsigned int thread;
+        Clock::time_point start, end;
+    };
+
+    std::array<Counter, NUM_PROBES> counters;
+    std::array<std::array<std::atomic<uint64_t>, NUM_BUCKETS>, MAX_DEPTH> disjunct_counts;
+    std::atomic<uint64_t> allocated_bytes;
+    Clock::time_point start, end;
+    unsigned int thread; // The one that started the run
+    bool record_events;
+    std::mutex events_mutex;
+    std::vector<Event> events;
+
+    static thread_local RunProfile *current_profile;
+    static thread_local uint64_t charged_bytes; // thread_allocated_bytes when current_profile was last charged
+
+    static void charge(); // Charges current_profile with what this thread allocated since it last was
+
+public:
+    static thread_local uint64_t thread_allocated_bytes; // Everything this thread has allocated (with operator new)
+
+    // The wall clock starts now; record_events keeps every timed call for appendChromeTraceEvents
+    explicit RunProfile(bool record_events = false);
+
+    static RunProfile* current() { return current_profile; }
+    static const char* probeName(Probe probe);
+
+    void count(Probe probe) { counters[(unsigned int)probe].calls.fetch_add(1, std::memory_order_relaxed); }
+    void record(Probe probe, Clock::time_point start, Clock::time_point end, uint64_t bytes);
+    void recordDisjuncts(int depth, std::size_t num_disjuncts);
+    void finish() { end = Clock::now(); } // Stops the wall clock
+
+    uint64_t numCalls(Probe probe) const { return counters[(unsigned int)probe].calls; }
+    uint64_t numReaching(int depth) const; // How many times the tree was entered at this level (over all sizes)
+    uint64_t allocatedBytes() const { return allocated_bytes; }
+
+    std::string toJson() const;
+    // Appends this run's events as comma-separated Chrome trace events under process pid, named process_name
+    void appendChromeTraceEvents(std::string &out, int pid, const std::string &process_name);
+};
+
+
+#ifndef NO_PROFILING
+// Times the rest of the enclosing block as probe (one per block)
+#define PROFILE_SCOPE(probe) RunProfile::Timer profile_timer(RunProfile::Probe::probe)
+// The value of expr, timed as probe
+#define PROFILED(probe, expr) ([&]() { PROFILE_SCOPE(probe); return (expr); }())
+#define PROFILE_COUNT(probe) do { if(RunProfile *p_ = RunProfile::current()) { p_->count(RunProfile::Probe::probe); } } while(0)
+#define PROFILE_DISJUNCTS(depth, num_disjuncts) do { if(RunProfile *p_ = RunProfile::current()) { p_->recordDisjuncts((depth), (num_disjuncts)); } } while(0)
+#else
+#define PROFILE_SCOPE(probe) ((void)0)
+#define PROFILED(probe, expr) (expr)
+#define PROFILE_COUNT(probe) ((void)0)
+#define PROFILE_DISJUNCTS(depth, num_disjuncts) ((void)0)
+#endif
+
+
+#endif
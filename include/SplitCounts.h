@@ -0,0 +1,41 @@
+#ifndef SPLITCOUNTS_H
+#define SPLITCOUNTS_H
+
+/**
+ * Splitting a training set by a candidate predicate and counting each side by label
+ * is the innermost step of scoring predicates, concrete or abstract.
+ * This file provides kernels that do it for a whole column in one pass,
+ * rather than evaluating a Predicate (with its switch on the feature type) row by row:
+ *   - boolean features intersect the set's RowBitset with the feature's and each label's row bitmaps,
+ *     so counting is a popcount a machine word at a time
+ *     (when the set is sparse relative to the data set, it walks the rows instead);
+ *   - numeric thresholds gather the set's values and labels and compare them eight at a time,
+ *     with a third, "maybe" side for values in a band (e.g. the threshold range of a SymbolicPredicate,
+ *     widened by feature flipping).
+ *
+ * Both have AVX2 versions, used when the CPU supports them (the build doesn't assume it),
+ * and portable scalar versions, which give identical counts.
+ */
+
+#include "DataReferences.h"
+#include <vector>
+
+
+struct SplitCounts {
+    // Each indexed by label
+    std::vector<int> unsatisfied; // The first of the usual (doesn't satisfy, satisfies) pair of counts
+    std::vector<int> satisfied;
+    std::vector<int> maybe; // Could land on either side
+};
+
+// Satisfied means the feature is true; nothing is maybe
+SplitCounts countBooleanSplit(const DataReferences &references, unsigned int feature_index);
+// Satisfied means value <= lb, maybe means lb < value < ub, and unsatisfied means value >= ub (or NaN)
+SplitCounts countThresholdSplit(const DataReferences &references, unsigned int feature_index, float lb, float ub);
+
+// For tests and benchmarks: turns the AVX2 kernels off (or back on, where supported).
+// Returns whether they are in use afterwards.
+bool setSplitCountsVectorized(bool enabled);
+
+
+#endif
@@ -10,6 +10,7 @@
  * We use optional<bool> for three-valued logic.
  */
 
+#include "DataColumns.h"
 #include "Feature.hpp"
 #include <functional> // for std::hash
 #include <optional>
@@ -24,19 +25,32 @@ private:
     // Checks lb <= x < ub
     float threshold_lb, threshold_ub;
 
+    // The FeatureType::NUMERIC case of evaluate, given x[feature_index]
+    std::optional<bool> evaluateNumericValue(float value, bool feature_poisoning, float feature_flip_amt) const;
+
 public:
     SymbolicPredicate(int feature_index); // Sets feature_type = FeatureType::BOOLEAN
     SymbolicPredicate(int feature_index, float threshold_lb, float threshold_ub); // Sets feature_Type = FeatureType::NUMERIC
 
     // Takes the feature vector, and two bools (feature poisoning for satisfies, feature poisoning for doesn't satisfy)
     // Returns true if unambigously satisfies, false if doesn't satisfy, and {} if satisfy depends on feature poisoning
-    std::optional<bool> evaluate(const FeatureVector &x, bool feature_poisoning, float feature_flip_amt) const; // Does not check bounds
+    std::optional<bool> evaluate(const FeatureVector &x, bool feature_poisoning = false, float feature_flip_amt = 0) const; // Does not check bounds
+    // Same, reading the row-th entry of the columns
+    std::optional<bool> evaluate(const DataColumns &columns, unsigned int row, bool feature_poisoning = false, float feature_flip_amt = 0) const;
+    // Typed versions of the above for loops that have already switched on get_feature_type(),
+    // so that they don't switch again per row (feature poisoning doesn't affect boolean features)
+    bool evaluateBoolean(const DataColumns &columns, unsigned int row) const { return columns.getBooleanValue(row, feature_index); }
+    std::optional<bool> evaluateNumeric(const DataColumns &columns, unsigned int row, bool feature_poisoning = false, float feature_flip_amt = 0) const {
+        return evaluateNumericValue(columns.getNumericValue(row, feature_index), feature_poisoning, feature_flip_amt);
+    }
 
     // Our abstract transformers would like to be able to hash these objects, etc
     bool operator ==(const SymbolicPredicate &right) const;
+    bool operator <(const SymbolicPredicate &right) const; // By feature, then thresholds; consistent with ==
     size_t hash() const;
 
     unsigned int get_feature_index() const;
+    FeatureType get_feature_type() const { return feature_type; }
     float get_lb() const;
     float get_ub() const;
 };
@@ -66,35 +80,13 @@ inline SymbolicPredicate::SymbolicPredicate(int feature_index, float threshold_l
     feature_type = FeatureType::NUMERIC;
 }
 
-inline std::optional<bool> SymbolicPredicate::evaluate(const FeatureVector &x, bool feature_poisoning, float feature_flip_amt = 0) const {
+inline std::optional<bool> SymbolicPredicate::evaluate(const FeatureVector &x, bool feature_poisoning, float feature_flip_amt) const {
     // feature_poisoning is true if the feature poisoning index is the same value that phi considers
     switch(feature_type) {
         case FeatureType::BOOLEAN:
             return x[feature_index].getBooleanValue();
         case FeatureType::NUMERIC:
-            // given range [lb, ub] the predicate is x<=B for some B in [lb,ub] (we just don't know exactly what B is)
-            // return true if x<=B, return false if x>B and return {} if we don't know
-            if (feature_poisoning) {
-                // In this case, we definitely include x in the filtering
-                if (x[feature_index].getNumericValue() <= (threshold_lb - feature_flip_amt)) {
-                    return true;
-                } else if (x[feature_index].getNumericValue() < threshold_ub + feature_flip_amt) {
-                    // Now, x is near the border: could go either way so we have to include it but also will need to increment num_dropout
-                    return {};
-                } else {
-                    return false;
-                }
-            } else {
-                if(x[feature_index].getNumericValue() <= threshold_lb) {
-                    return true;
-                } else if(x[feature_index].getNumericValue() < threshold_ub) {
-                    // In theory this shouldn't happen: the ub is the lb of the next phi, defined to be the next value > lb
-                    return {}; // x in [lb,ub] means we don't know whether it'll be included
-                } else {
-                    return false;
-                }
-            }
-            
+            return evaluateNumericValue(x[feature_index].getNumericValue(), feature_poisoning, feature_flip_amt);
         default:
             // XXX this shouldn't happen---it's here to suppress a warning.
             // If adding new FeatureTypes, make sure to add remaining cases.
@@ -102,6 +94,43 @@ inline std::optional<bool> SymbolicPredicate::evaluate(const FeatureVector &x, b
     }
 }
 
+inline std::optional<bool> SymbolicPredicate::evaluate(const DataColumns &columns, unsigned int row, bool feature_poisoning, float feature_flip_amt) const {
+    switch(feature_type) {
+        case FeatureType::BOOLEAN:
+            return evaluateBoolean(columns, row);
+        case FeatureType::NUMERIC:
+            return evaluateNumeric(columns, row, feature_poisoning, feature_flip_amt);
+        default:
+            // XXX see evaluate(const FeatureVector &, ...)
+            return false;
+    }
+}
+
+inline std::optional<bool> SymbolicPredicate::evaluateNumericValue(float value, bool feature_poisoning, float feature_flip_amt) const {
+    // given range [lb, ub] the predicate is x<=B for some B in [lb,ub] (we just don't know exactly what B is)
+    // return true if x<=B, return false if x>B and return {} if we don't know
+    if (feature_poisoning) {
+        // In this case, we definitely include x in the filtering
+        if (value <= (threshold_lb - feature_flip_amt)) {
+            return true;
+        } else if (value < threshold_ub + feature_flip_amt) {
+            // Now, x is near the border: could go either way so we have to include it but also will need to increment num_dropout
+            return {};
+        } else {
+            return false;
+        }
+    } else {
+        if(value <= threshold_lb) {
+            return true;
+        } else if(value < threshold_ub) {
+            // In theory this shouldn't happen: the ub is the lb of the next phi, defined to be the next value > lb
+            return {}; // x in [lb,ub] means we don't know whether it'll be included
+        } else {
+            return false;
+        }
+    }
+}
+
 inline unsigned int SymbolicPredicate::get_feature_index() const {
     return this->feature_index;
 }
@@ -131,6 +160,22 @@ inline bool SymbolicPredicate::operator ==(const SymbolicPredicate &right) const
     return true;
 }
 
+inline bool SymbolicPredicate::operator <(const SymbolicPredicate &right) const {
+    if(this->feature_index != right.feature_index) {
+        return this->feature_index < right.feature_index;
+    }
+    if(this->feature_type != right.feature_type) {
+        return this->feature_type < right.feature_type;
+    }
+    if(this->feature_type == FeatureType::NUMERIC) {
+        if(this->threshold_lb != right.threshold_lb) {
+            return this->threshold_lb < right.threshold_lb;
+        }
+        return this->threshold_ub < right.threshold_ub;
+    }
+    return false; // Boolean predicates on the same feature are equal
+}
+
 inline size_t SymbolicPredicate::hash() const {
     if(feature_type == FeatureType::NUMERIC) {
         return std::hash<unsigned int>{}(feature_index)
@@ -0,0 +1,130 @@
+#ifndef TEXTTOKENIZER_H
+#define TEXTTOKENIZER_H
+
+/**
+ * In-place tokenizing of the delimited text our data sets come in
+ * (the UCI csv files and the @DATA section of ARFF files).
+ * A file is read into one buffer and split into lines,
+ * and each line's fields are visited as [begin, end) ranges of that buffer,
+ * so nothing is copied into temporary strings;
+ * numbers are parsed with std::from_chars (no streams, no locale, no exceptions).
+ *
+ * Large inputs are parsed in chunks of lines on a thread pool.
+ * Problems are collected per chunk as TextIssues (with line and column)
+ * and only reported through Error afterwards, in file order,
+ * so what gets printed doesn't depend on scheduling.
+ */
+
+#include "Error.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+struct TextLine {
+    const char *begin;
+    const char *end; // Excludes the line break
+    unsigned int number; // Counting from 1
+};
+
+struct TextIssue {
+    unsigned int line;
+    unsigned int column; // The field, counting from 1 (0 for the whole line)
+    std::string message;
+};
+
+
+// Returns false if the file can't be read
+bool readWholeFile(const std::string &path, std::string &contents);
+// Splits [begin, end) at '\n' (dropping a '\r' before it), skipping lines that are empty or all whitespace
+std::vector<TextLine> splitLines(const char *begin, const char *end, unsigned int first_line_number = 1);
+// Narrows [begin, end) past leading and trailing spaces, tabs, and '\r'
+void trimField(const char *&begin, const char *&end);
+// Parses the whole of the (trimmed) field as a float;
+// unlike std::from_chars alone, accepts a leading '+'
+bool parseFloatField(const char *begin, const char *end, float &value);
+// Reports each issue through err_handler, as a warning or as fatal
+void reportIssues(const std::vector<TextIssue> &issues, Error *err_handler, bool fatal);
+
+/**
+ * Calls f(column, begin, end) for each field of the line (column counting from 0),
+ * stopping early if f returns false; returns the number of fields visited.
+ * As with std::getline, a trailing delimiter doesn't start an empty last field.
+ */
+template <typename F>
+unsigned int forEachField(const TextLine &line, char delimiter, const F &f);
+
+/**
+ * Runs parse_line(line, row, issues) over every line, appending the rows it accepts (returns true for) to rows
+ * and whatever it records to issues, both in line order.
+ * parse_line must be safe to call concurrently; once there are at least PARALLEL_MIN_LINES lines
+ * the lines are parsed in chunks on a temporary pool (one thread per core).
+ */
+static const std::size_t PARALLEL_MIN_LINES = 1 << 15;
+static const std::size_t LINES_PER_CHUNK = 1 << 13;
+template <typename Row, typename ParseLine>
+void parseLines(const std::vector<TextLine> &lines, const ParseLine &parse_line, std::vector<Row> &rows, std::vector<TextIssue> &issues);
+
+
+/**
+ * Template definitions
+ */
+
+template <typename F>
+inline unsigned int forEachField(const TextLine &line, char delimiter, const F &f) {
+    unsigned int column = 0;
+    const char *field_begin = line.begin;
+    while(field_begin < line.end) {
+        const char *field_end = field_begin;
+        while(field_end < line.end && *field_end != delimiter) {
+            field_end++;
+        }
+        if(!f(column, field_begin, field_end)) {
+            return column + 1;
+        }
+        column++;
+        field_begin = field_end + 1;
+    }
+    return column;
+}
+
+template <typename Row, typename ParseLine>
+void parseLines(const std::vector<TextLine> &lines, const ParseLine &parse_line, std::vector<Row> &rows, std::vector<TextIssue> &issues) {
+    std::size_t num_chunks = (lines.size() + LINES_PER_CHUNK - 1) / LINES_PER_CHUNK;
+    std::vector<std::vector<Row>> chunk_rows(num_chunks);
+    std::vector<std::vector<TextIssue>> chunk_issues(num_chunks);
+    auto parse_chunk = [&](std::size_t chunk) {
+        std::size_t end = std::min(lines.size(), (chunk + 1) * LINES_PER_CHUNK);
+        chunk_rows[chunk].reserve(end - chunk * LINES_PER_CHUNK);
+        for(std::size_t i = chunk * LINES_PER_CHUNK; i < end; i++) {
+            Row row;
+            if(parse_line(lines[i], row, chunk_issues[chunk])) {
+                chunk_rows[chunk].push_back(std::move(row));
+            }
+        }
+    };
+
+    std::unique_ptr<ThreadPool> pool;
+    if(lines.size() >= PARALLEL_MIN_LINES) {
+        pool.reset(new ThreadPool(0));
+    }
+    parallelFor(pool.get(), 0, num_chunks, 1, parse_chunk);
+
+    std::size_t num_rows = rows.size();
+    for(auto i = chunk_rows.cbegin(); i != chunk_rows.cend(); i++) {
+        num_rows += i->size();
+    }
+    rows.reserve(num_rows);
+    for(std::size_t chunk = 0; chunk < num_chunks; chunk++) {
+        std::move(chunk_rows[chunk].begin(), chunk_rows[chunk].end(), std::back_inserter(rows));
+        std::move(chunk_issues[chunk].begin(), chunk_issues[chunk].end(), std::back_inserter(issues));
+    }
+}
+
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/**
+ * A small work-stealing thread pool.
+ * Each worker owns a deque of tasks: it pushes and pops its own work at the back
+ * (so nested tasks run depth-first and stay cache-warm),
+ * and when it runs dry it steals from the front of the other workers' deques.
+ * Tasks submitted from outside the pool are dealt round-robin onto the workers' deques.
+ *
+ * TaskGroup provides fork-join on top of the pool:
+ * a thread waiting on a group keeps executing pending tasks instead of blocking,
+ * so groups may be nested inside tasks without deadlocking the pool.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // One per worker
+    std::vector<std::thread> workers;
+    std::atomic<unsigned int> next_queue; // Round-robin target for external submissions
+    std::atomic<int> num_queued; // Tasks sitting in some queue (not yet started)
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    bool stopping; // Guarded by sleep_mutex
+
+    void workerLoop(unsigned int index);
+    bool popOwn(unsigned int index, Task &task);
+    bool steal(unsigned int thief, Task &task);
+
+public:
+    // num_threads == 0 picks std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned int num_threads);
+    ~ThreadPool(); // Finishes all queued tasks before joining
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const { return workers.size(); }
+
+    void submit(Task task);
+    // Runs one queued task on the calling thread, if there is one.
+    // This is how waiting threads help out rather than blocking.
+    bool tryRunPendingTask();
+
+    // Whether the calling thread is one of this pool's workers
+    bool inWorkerThread() const;
+};
+
+
+class TaskGroup {
+private:
+    ThreadPool *pool; // Does not handle deallocation
+    std::atomic<int> pending;
+    std::mutex exception_mutex;
+    std::exception_ptr first_exception;
+
+    void drain();
+
+public:
+    explicit TaskGroup(ThreadPool *pool);
+    ~TaskGroup() { drain(); } // Never leaves tasks referencing a dead group
+
+    void run(ThreadPool::Task task);
+    // Returns once every task run() through this group has finished;
+    // rethrows the first exception (if any) that one of them raised.
+    void wait();
+};
+
+
+/**
+ * Runs f(i) for each i in [begin, end), handing out chunks of at least grain_size indices.
+ * With a NULL pool (or a range no bigger than one grain) this is just a serial loop.
+ */
+void parallelFor(ThreadPool *pool, std::size_t begin, std::size_t end, std::size_t grain_size,
+                 const std::function<void(std::size_t)> &f);
+
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef UCI_H
 #define UCI_H
 
+#include "Error.h"
+#include "TextTokenizer.h"
 #include <set>
 #include <string>
 #include <vector>
@@ -8,8 +10,8 @@
 /**
  * Support for reading in the UCI csv data files.
  * For now we assume no missing values, all-float features, and string labels.
- * The file reading functions make strong assumptions
- * that the files look as expected.
+ * Each file is tokenized in place (see TextTokenizer.h);
+ * rows with too few columns or unparseable numbers are skipped with a warning giving their line and column.
  */
 
 enum class UCINames { IRIS, CANCER, WINE, YEAST, RETINOPATHY, MAMMOGRAPHY, ADULT_INCOME, GERMAN_LOAN, COMPAS, DRUG_CONSUMPTION };
@@ -46,14 +48,25 @@ private:
     std::vector<CSVRow> training_data;
     std::vector<CSVRow> test_data;
     std::set<std::string> labels;
+    Error err_handler;
+
+    // What each column of the file is for, worked out once from the details:
+    // an index into CSVRow::x, or one of the two markers below
+    static constexpr int LABEL_COLUMN = -1;
+    static constexpr int IGNORED_COLUMN = -2;
+    std::vector<int> column_targets;
+    int num_features;
 
     void setDetails(const UCINames &name);
     void loadFromFile(const std::string &filepath, std::vector<CSVRow> *data);
-    void parseLine(CSVRow &csv_row, const std::string &comma_separated_line);
+    // Safe to call concurrently; records problems in issues rather than reporting them
+    bool parseLine(const TextLine &line, CSVRow &csv_row, std::vector<TextIssue> &issues) const;
     
 public:
     UCI(const UCINames &name, const std::string &prefix);
+    static const UCIDetails& getDetails(const UCINames &name);
 
+    bool isFatal() { return err_handler.isFatal(); }
     const std::set<std::string>& getLabels() { return labels; }
     const std::vector<CSVRow>& getTrainingData() { return training_data; }
     const std::vector<CSVRow>& getTestData() { return test_data; }
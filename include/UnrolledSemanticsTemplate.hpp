@@ -0,0 +1,209 @@
+#ifndef UNROLLEDSEMANTICSTEMPLATE_HPP
+#define UNROLLEDSEMANTICSTEMPLATE_HPP
+
+/**
+ * AbstractSemanticsTemplate interprets any program of the DSL (see ASTNode.h),
+ * paying a virtual accept/visit per node and a virtual call per abstract transformer.
+ * The only programs we actually run, though, are buildTree(depth)'s, and their shape is fixed:
+ *     tree(0) := p <- summary(T)
+ *     tree(d) := if impurity(T) = 0 then p <- summary(T)
+ *                else phi <- bestsplit(T) ;
+ *                     if phi == bot then p <- summary(T)
+ *                     else (if x models phi then T <- filter(T, phi) else T <- filter(T, not phi)) ; tree(d-1)
+ *
+ * UnrolledSemanticsTemplate runs that program without building it.
+ * tree(d) is a template instantiation for every d up to MAX_UNROLLED_DEPTH
+ * (deeper trees recurse at runtime until they get there),
+ * and every transformer is called on the concrete domain class StateDomain with a qualified (non-virtual) call,
+ * so the compiler is free to inline the domain into the interpreter.
+ *
+ * There is no shared current state: every step takes a state and returns one.
+ * So with a thread pool, the two live branches of an if-then-else are forked and joined:
+ * the then branch runs as a task (which idle workers steal) while the calling thread runs the else branch.
+ * The branches are still joined in then-else order, so the result doesn't depend on the schedule
+ * (the domain must be safe to use from several threads, as the dropout domains are).
+ *
+ * A run can also be cut short. Every path through the program ends in summary,
+ * and nothing after it changes the posterior, so each summary result is a finished piece of the final state.
+ * An optional cutoff sees each of them as they are produced (possibly from several threads at once);
+ * once it returns true, the remaining work is abandoned and execute's result is meaningless (see wasCutShort).
+ *
+ * StateDomain must be the dynamic type of the domain it is given (as with the classes in DropoutDomains.hpp).
+ * The result is exactly what AbstractSemanticsTemplate computes on buildTree(depth):
+ * the same transformers, with the branches of each if-then-else
+ * joined by AbstractDomainTemplate::join (not any aggregate join a domain overrides it with).
+ *
+ * The transformers are probed for the current RunProfile (see RunProfile.h),
+ * as is the number of disjuncts that reaches each level of the tree (1 if A has no size()).
+ */
+
+#include "AbstractDomainTemplate.hpp"
+#include "Feature.hpp"
+#include "RunProfile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+template <typename StateDomain>
+class UnrolledSemanticsTemplate {
+public:
+    typedef typename StateDomain::AbstractionType A;
+    static constexpr int MAX_UNROLLED_DEPTH = 8;
+
+private:
+    const StateDomain *state_domain;
+    const FeatureVector *test_input;
+    ThreadPool *pool; // Optional; not owned
+    std::function<bool(const A &)> cutoff; // Optional
+    mutable std::atomic<bool> cut_short;
+    int root_depth; // Of the last execute
+
+    template <typename T>
+    static auto numDisjuncts(const T &element, int) -> decltype(element.size()) { return element.size(); }
+    template <typename T>
+    static std::size_t numDisjuncts(const T &, long) { return 1; }
+
+    bool isBottom(const A &element) const { return state_domain->StateDomain::isBottomElement(element); }
+    A join(const std::vector<A> &elements) const { return PROFILED(JOIN, state_domain->AbstractDomainTemplate<A>::join(elements)); }
+    A summary(const A &element) const;
+
+    // Runs then_branch on pass_to_then and else_branch on pass_to_else, skipping either if it's bottom, and joins the results
+    template <typename Then, typename Else>
+    A ifThenElse(const A &pass_to_then, const Then &then_branch, const A &pass_to_else, const Else &else_branch) const;
+
+    // if x models phi then T <- filter(T, phi) else T <- filter(T, not phi)
+    A filterByTestInput(const A &element) const;
+    // if impurity(T) = 0 then p <- summary(T) else (phi <- bestsplit(T) ; if phi == bot then p <- summary(T) else (filter ; rest))
+    template <typename Rest>
+    A treeUnit(const A &element, const Rest &rest) const;
+
+    template <int depth>
+    A tree(const A &element) const;
+    A tree(const A &element, int depth) const;
+    template <int... depths>
+    A unrolledTree(const A &element, int depth, std::integer_sequence<int, depths...>) const;
+
+public:
+    UnrolledSemanticsTemplate(const StateDomain *state_domain) : cut_short(false) { this->state_domain = state_domain; test_input = NULL; pool = NULL; root_depth = 0; }
+
+    void setThreadPool(ThreadPool *pool) { this->pool = pool; } // NULL runs branches one after the other
+    // cutoff(leaf) is called with each summary result; returning true abandons the run
+    void setCutoff(const std::function<bool(const A &)> &cutoff) { this->cutoff = cutoff; }
+    bool wasCutShort() const { return cut_short; } // For the last execute
+
+    // Returns the whole abstract state that reaches the return statement of buildTree(depth)
+    A execute(const FeatureVector &test_input, const A &initial_state, int depth);
+};
+
+
+/**
+ * UnrolledSemanticsTemplate member function templates
+ */
+
+template <typename StateDomain>
+typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::execute(const FeatureVector &test_input, const A &initial_state, int depth) {
+    this->test_input = &test_input;
+    cut_short = false;
+    root_depth = std::max(depth, 0); // buildTree treats a negative depth as 0
+    A ret = tree(initial_state, root_depth);
+    this->test_input = NULL;
+    return ret;
+}
+
+template <typename StateDomain>
+inline typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::summary(const A &element) const {
+    A ret = PROFILED(SUMMARY, state_domain->StateDomain::applySummary(element));
+    if(cutoff && cutoff(ret)) {
+        cut_short = true;
+    }
+    return ret;
+}
+
+template <typename StateDomain>
+template <typename Then, typename Else>
+inline typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::ifThenElse(const A &pass_to_then, const Then &then_branch, const A &pass_to_else, const Else &else_branch) const {
+    if(cut_short) {
+        return A();
+    }
+    bool run_then = !isBottom(pass_to_then), run_else = !isBottom(pass_to_else);
+    std::vector<A> joins;
+    if(run_then && run_else && pool != NULL) {
+        joins.resize(2);
+        TaskGroup group(pool);
+        group.run([&then_branch, &pass_to_then, &joins]() { joins[0] = then_branch(pass_to_then); });
+        joins[1] = else_branch(pass_to_else);
+        group.wait();
+    } else {
+        if(run_then) {
+            joins.push_back(then_branch(pass_to_then));
+        }
+        if(run_else) {
+            joins.push_back(else_branch(pass_to_else));
+        }
+    }
+    return join(joins);
+}
+
+template <typename StateDomain>
+inline typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::filterByTestInput(const A &element) const {
+    return ifThenElse(
+        state_domain->StateDomain::meetXModelsPhi(element, *test_input),
+        [this](const A &models) { return PROFILED(FILTER, state_domain->StateDomain::applyFilter(models)); },
+        state_domain->StateDomain::meetXNotModelsPhi(element, *test_input),
+        [this](const A &not_models) { return PROFILED(FILTER_NEGATED, state_domain->StateDomain::applyFilterNegated(not_models)); });
+}
+
+template <typename StateDomain>
+template <typename Rest>
+inline typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::treeUnit(const A &element, const Rest &rest) const {
+    return ifThenElse(
+        state_domain->StateDomain::meetImpurityEqualsZero(element),
+        [this](const A &pure) { return summary(pure); },
+        state_domain->StateDomain::meetImpurityNotEqualsZero(element),
+        [this, &rest](const A &impure) {
+            if(cut_short) {
+                return A();
+            }
+            A split = PROFILED(BEST_SPLIT, state_domain->StateDomain::applyBestSplit(impure));
+            return ifThenElse(
+                state_domain->StateDomain::meetPhiIsBottom(split),
+                [this](const A &no_split) { return summary(no_split); },
+                state_domain->StateDomain::meetPhiIsNotBottom(split),
+                [this, &rest](const A &has_split) { return rest(filterByTestInput(has_split)); });
+        });
+}
+
+template <typename StateDomain>
+template <int depth>
+typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::tree(const A &element) const {
+    PROFILE_DISJUNCTS(root_depth - depth, numDisjuncts(element, 0));
+    if constexpr (depth == 0) {
+        return summary(element);
+    } else {
+        return treeUnit(element, [this](const A &filtered) { return tree<depth - 1>(filtered); });
+    }
+}
+
+template <typename StateDomain>
+template <int... depths>
+inline typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::unrolledTree(const A &element, int depth, std::integer_sequence<int, depths...>) const {
+    A ret;
+    ((depth == depths && (ret = tree<depths>(element), true)) || ...);
+    return ret;
+}
+
+template <typename StateDomain>
+typename UnrolledSemanticsTemplate<StateDomain>::A UnrolledSemanticsTemplate<StateDomain>::tree(const A &element, int depth) const {
+    if(depth <= MAX_UNROLLED_DEPTH) {
+        return unrolledTree(element, depth, std::make_integer_sequence<int, MAX_UNROLLED_DEPTH + 1>());
+    }
+    PROFILE_DISJUNCTS(root_depth - depth, numDisjuncts(element, 0));
+    return treeUnit(element, [this, depth](const A &filtered) { return tree(filtered, depth - 1); });
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "Interval.h"
 #include "CategoricalDistribution.hpp"
+#include <array>
+#include <cstddef>
 #include <vector>
 
 
@@ -43,4 +45,64 @@ Interval<double> jointImpurity(const std::vector<int> &counts1, int num_dropout1
                                std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info);
 
 
+/**
+ * Fixed-arity kernels
+ *
+ * The split scorers evaluate a joint impurity for every candidate threshold,
+ * and the std::vector versions above allocate a distribution for each side of each one.
+ * These take counts with the number of categories K fixed at compile time and keep everything on the stack.
+ * They do the same floating point operations in the same order, so the results are bit-identical.
+ * (Callers dispatch on num_categories and fall back to the std::vector versions for other K.)
+ */
+
+template <std::size_t K>
+using CategoryCounts = std::array<int, K>;
+template <typename T, std::size_t K>
+using FixedCategoricalDistribution = std::array<T, K>;
+
+template <std::size_t K>
+inline int countTotal(const CategoryCounts<K> &counts) {
+    int total = 0;
+    for(std::size_t i = 0; i < K; i++) {
+        total += counts[i];
+    }
+    return total;
+}
+
+template <std::size_t K>
+inline FixedCategoricalDistribution<double, K> estimateCategorical(const CategoryCounts<K> &counts) {
+    FixedCategoricalDistribution<double, K> ret;
+    int total = countTotal(counts);
+    for(std::size_t i = 0; i < K; i++) {
+        ret[i] = (double)counts[i] / total;
+    }
+    return ret;
+}
+
+template <std::size_t K>
+inline double impurity(const CategoryCounts<K> &counts) {
+    FixedCategoricalDistribution<double, K> p = estimateCategorical(counts);
+    double total = 0;
+    for(std::size_t i = 0; i < K; i++) {
+        total += p[i] * (1 - p[i]);
+    }
+    return total;
+}
+
+template <std::size_t K>
+inline double jointImpurity(const CategoryCounts<K> &counts1, const CategoryCounts<K> &counts2) {
+    return countTotal(counts1) * impurity(counts1) + countTotal(counts2) * impurity(counts2);
+}
+
+// The abstract estimate only handles binary labels, so only K = 2 gets an abstract kernel
+FixedCategoricalDistribution<Interval<double>, 2> estimateCategorical(const CategoryCounts<2> &counts, int num_dropout, int num_add,
+                                                int num_labels_flip, int num_features_flip,
+                                                std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info);
+Interval<double> impurity(const CategoryCounts<2> &counts, int num_dropout, int num_add, int num_labels_flip, int num_features_flip,
+                        std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info);
+Interval<double> jointImpurity(const CategoryCounts<2> &counts1, int num_dropout1, int num_add1, int num_labels_flip1, int num_features_flip1,
+                               const CategoryCounts<2> &counts2, int num_dropout2, int num_add2, int num_labels_flip2, int num_features_flip2,
+                               std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info);
+
+
 #endif
@@ -1,8 +1,10 @@
 #!/bin/bash
 
-# first argument is the memory limit in MB
-# second argument is the initcommands_* file, whose directory
-# we will use to store all of the subsequent experiment .jsonl files
+# Runs the disjuncts domain on a contiguous range of test indices.
+# Arguments: dataset, depth, l, m, n, start index, number of indices,
+# and optionally the number of threads (defaults to one per core).
+# Everything runs inside a single bin/main process, so the dataset is loaded once
+# and the indices are spread over the thread pool; output is still in index order.
 DATA=$1
 DEPTH=$2
 L=$3
@@ -10,9 +12,8 @@ M=$4
 N=$5
 START=$6
 NUM=$7
+THREADS=${8:-0}
 END=$(($NUM+$START-1))
 
-for I in $(seq $START $END)
-do
-    bin/main -data data $DATA -t $I -d $DEPTH -V -l $L -m $M -n $N
-done
\ No newline at end of file
+INDICES=$(seq -s ' ' $START $END)
+bin/main -data data $DATA -t "$INDICES" -d $DEPTH -V -l $L -m $M -n $N --threads $THREADS
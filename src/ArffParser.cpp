@@ -40,23 +40,6 @@ map<string, int> ArffParser::makeNominalMap(vector<string> tags) {
     return tag_map; 
 }
 
-/**
- * converts string to float
- * (added customized error checking and trimming compared to stock stof)
- */
-float ArffParser::stofloat(string s) {
-    std::istringstream iss(s);
-    float f;
-    iss >> noskipws >> f; // noskipws considers leading whitespace invalid
-    // Check the entire string was consumed and if either failbit or badbit is set
-    if (iss.eof() && !iss.fail()) {
-        return f;
-    } else {
-        err_handler->warning("Invalid number: " + s);
-        return f;
-    }
-}
-
 /**
  * trims brackets from nominal attribute declaration 
  */
@@ -79,6 +62,7 @@ string ArffParser::trimBrackets(string s) {
 
 ArffParser::ArffParser(const string& _file) {
     label_id = 0;
+    num_attributes = 0;
     scanner = new ArffScanner(_file);
     err_handler = new Error(); 
 }
@@ -93,6 +77,9 @@ ArffParser::~ArffParser() {
  * parse a arff file passed as constructor parameter, returns NULL on fail 
  */
 DataSet* ArffParser::parse(float thres, int label_ind) {
+    if (scanner->isFatal()) {
+        return NULL;
+    }
     DataSet* data = new DataSet();
     parseRelation(data, thres > 0, label_ind);
     if (isFatal()) {
@@ -161,66 +148,96 @@ void ArffParser::parseRelation(DataSet *data, bool booleanized, int label_ind) {
         }
         attrNum++;
     }
+    num_attributes = attrNum;
     data->num_categories = labels.size();
 }
 
 /**
  * parse the @DATA section of the arff file, ignores lines with error 
+ * (the lines are tokenized in place, in parallel for large files; see TextTokenizer.h)
  * 
  * @param data pointer to the output dataset
  * @param thres threshold to booleanize numeric attributes 
  */ 
 void ArffParser::parseData(DataSet *data, float thres) {
-    while (!scanner->nextLine()) {
-        DataRow curRow; 
-        FeatureVector vals(data->feature_types.size()); 
-        string val; 
-        int attrNum = 0; // index of current reading attribute (DOES NOT INCLUDE LABEL!)
-        int read_label = 0;
-        int ignored_attrs = 0; // number of ignored nominal attributes 
-        while (getline(scanner->iss, val, ',')) {
-            if ((attrNum == data->feature_types.size()) && (attrNum != label_id)) {
-                // reaches the end but do not have label 
-                err_handler->warning("Incorrect data line"); 
-                break;
+    // What each attribute (column) of a data line holds, worked out once from the header
+    enum class ColumnKind { LABEL, IGNORED, BOOLEAN, NUMERIC };
+    vector<ColumnKind> kinds(num_attributes);
+    vector<int> targets(num_attributes, -1); // The index into the feature vector
+    int num_features = 0;
+    for (int i = 0; i < num_attributes; i++) {
+        if (i == label_id) {
+            kinds[i] = ColumnKind::LABEL;
+        } else if (ignored_inds.count(i)) {
+            kinds[i] = ColumnKind::IGNORED;
+        } else {
+            kinds[i] = (boolean_maps.count(i) ? ColumnKind::BOOLEAN : ColumnKind::NUMERIC);
+            targets[i] = num_features++;
+        }
+    }
+    // Lines are parsed concurrently, so they only read the (const) maps
+    const map<int, map<string, int> > &booleans = boolean_maps;
+    const map<string, int> &labels_by_name = label_map;
+
+    auto parse_line = [&](const TextLine &line, DataRow &row, vector<TextIssue> &issues) {
+        row.x = FeatureVector(num_features);
+        row.y = 0;
+        bool ok = true;
+        unsigned int num_fields = forEachField(line, ',', [&](unsigned int column, const char *begin, const char *end) {
+            if (column >= kinds.size()) {
+                return false;
             }
-            if (attrNum == label_id && (!read_label)) {
-                // read label info 
-                if (label_map.count(val) == 0) {
-                    err_handler->warning("Invalid label: " + val);
-                } else {
-                    curRow.y = label_map[val];
+            trimField(begin, end);
+            switch (kinds[column]) {
+                case ColumnKind::LABEL: {
+                    auto found = labels_by_name.find(string(begin, end));
+                    if (found == labels_by_name.end()) {
+                        issues.push_back({ line.number, column + 1, "Invalid label: " + string(begin, end) });
+                        ok = false;
+                    } else {
+                        row.y = found->second;
+                    }
+                    break;
                 }
-                read_label = 1;
-            } else {
-                // reading attribute 
-                if (ignored_inds.count(attrNum + read_label)) {
-                    // ignored (undefined nominal attribute)
-                    ignored_attrs++;
-                } else if (boolean_maps.count(attrNum)) {    // interpret as boolean
-                    if (!boolean_maps[attrNum].count(val)) {
-                        err_handler->warning("invalid binary value: " + val);
+                case ColumnKind::IGNORED:
+                    break;
+                case ColumnKind::BOOLEAN: {
+                    const map<string, int> &values = booleans.at(column);
+                    auto found = values.find(string(begin, end));
+                    if (found == values.end()) {
+                        issues.push_back({ line.number, column + 1, "invalid binary value: " + string(begin, end) });
+                        ok = false;
+                    } else {
+                        row.x[targets[column]] = (bool)found->second;
                     }
-                    vals[attrNum - ignored_attrs] = (bool)boolean_maps[attrNum][val];
-                } else {    // interpret as float 
-                    vals[attrNum - ignored_attrs] = stofloat(val);
-                    if (thres) { // booleanize data
-                        vals[attrNum - ignored_attrs] = vals[attrNum - ignored_attrs].getNumericValue() > thres;
+                    break;
+                }
+                case ColumnKind::NUMERIC: {
+                    float value;
+                    if (!parseFloatField(begin, end, value)) {
+                        issues.push_back({ line.number, column + 1, "Invalid number: " + string(begin, end) });
+                        ok = false;
+                    } else if (thres) { // booleanize data
+                        row.x[targets[column]] = value > thres;
+                    } else {
+                        row.x[targets[column]] = value;
                     }
+                    break;
                 }
-                attrNum++;
             }
+            return ok;
+        });
+        if (ok && num_fields != (unsigned int)num_attributes) { // too few, or (having stopped one past the end) too many
+            issues.push_back({ line.number, 0, "Incorrect data line, should have " + to_string(num_attributes) + " attributes" });
+            ok = false;
         }
-        if (attrNum - ignored_attrs != data->feature_types.size()) { // insufficient attributes read 
-            err_handler->warning("Incorrect data line, should have " + to_string(data->feature_types.size()) + " attributes, but only read " + to_string(attrNum - ignored_attrs));
-        }
-        curRow.x = vals;
-        if (err_handler->isWarning()) { // ignore problematic data row 
-            err_handler->resetWarning(); 
-        } else {
-            data->rows.push_back(curRow);
-        }
-    }
+        return ok;
+    };
+
+    vector<TextIssue> issues;
+    parseLines(scanner->remainingLines(), parse_line, data->rows, issues);
+    reportIssues(issues, err_handler, false);
+    err_handler->resetWarning(); // problematic data rows are ignored
 }
 
 /**
@@ -247,6 +264,12 @@ ExperimentData* ArffParser::loadArff(std::string train_path, std::string test_pa
     DataSet *train_dat, *test_dat;
     train_dat = train_parser.parse(booleanized ? thres : 0, label_ind);
     test_dat = test_parser.parse(booleanized ? thres : 0, label_ind);
+    if (train_dat == NULL || test_dat == NULL) {
+        delete train_dat;
+        delete test_dat;
+        delete err_handler;
+        return NULL;
+    }
     // checks for label consistency 
     std::vector<std::string> train_label = train_parser.getLabels(); 
     std::vector<std::string> test_label = test_parser.getLabels(); 
@@ -298,19 +321,21 @@ void ArffParser::writeArff(DataSet *data, string output_path, const vector<strin
 
     // write @DATA part 
     of << "\n@DATA\n"; 
-    for (int i = 0; i < data->rows.size(); i++) {
-        for (int j = 0; j < data->rows[i].x.size(); j++) {
+    // Written from the columns, so column-only (e.g. training) sets can be written too
+    const DataColumns &columns = data->columns();
+    for (unsigned int i = 0; i < columns.size(); i++) {
+        for (unsigned int j = 0; j < data->feature_types.size(); j++) {
             if (data->feature_types[j] == FeatureType::NUMERIC) {
-                of << data->rows[i].x[j].getNumericValue(); 
+                of << columns.getNumericValue(i, j); 
             } else if (data->feature_types[j] == FeatureType::BOOLEAN) {
-                of << (data->rows[i].x[j].getBooleanValue() ? "true" : "false");
+                of << (columns.getBooleanValue(i, j) ? "true" : "false");
             }
             of << ",";
         }
         if(use_label) 
-            of << class_labels->at(data->rows[i].y) << "\n";
+            of << class_labels->at(columns.getLabel(i)) << "\n";
         else 
-            of << data->rows[i].y << "\n"; 
+            of << columns.getLabel(i) << "\n"; 
     }
     of.close(); 
     delete err_handler;
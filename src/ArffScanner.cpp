@@ -25,38 +25,55 @@ static inline void trim(string &s) {
 }
 
 ArffScanner::ArffScanner(const string& _file): file(_file),
-                                            fp(NULL),
+                                            position(0),
                                             lineNum(0),
                                             isEOF(false) {
-    fp = ifstream(file);
     err_handler = new Error(); 
-    if(!fp.is_open()) { 
+    if(!readWholeFile(file, contents)) { 
         err_handler->fatal("Cannot open specified arff file");
     }
 }
 
 ArffScanner::~ArffScanner() {
-    if(fp.is_open()) {
-        fp.close();
-    }
     delete err_handler; 
 }
 
 bool ArffScanner::nextLine() {
-    if(!getline(fp, curLine)) 
-        isEOF = true;
-    else {
+    while(true) {
+        if(position >= contents.size()) {
+            isEOF = true;
+            return isEOF;
+        }
+        size_t line_end = contents.find('\n', position);
+        if(line_end == string::npos) {
+            line_end = contents.size();
+        }
+        curLine = contents.substr(position, line_end - position);
+        position = line_end + 1;
+        lineNum++;
         trim(curLine);
-        if(curLine.length() == 0 || curLine.at(0) == '%') {
-            lineNum++; 
-            nextLine();
+        if(curLine.length() != 0 && curLine.at(0) != '%') {
+            break;
         }
-        iss = istringstream(curLine);
     }
-    lineNum++; 
+    iss = istringstream(curLine);
     return isEOF;
 }
 
+vector<TextLine> ArffScanner::remainingLines() {
+    const char *begin = contents.data() + std::min(position, contents.size());
+    vector<TextLine> lines = splitLines(begin, contents.data() + contents.size(), lineNum + 1);
+    // Drop comments
+    lines.erase(remove_if(lines.begin(), lines.end(), [](const TextLine &line) {
+        const char *first = line.begin;
+        while(first < line.end && isspace(*first)) {
+            first++;
+        }
+        return *first == '%';
+    }), lines.end());
+    return lines;
+}
+
 string ArffScanner::nextWord() {
     string ret; 
     iss >> skipws >> ret;
@@ -1,10 +1,26 @@
 #include "BoxBoundedDisjunctsDomainDropoutInstantiation.h"
-#include <algorithm> // for std::min
+#include "DataReferences.h"
+#include <algorithm> // for std::min, std::max
 
 double BoxBoundedDisjunctsDomainDropoutInstantiation::joinPrecisionLoss(const Types::Single &e1, const Types::Single &e2) const {
-    Types::Single ej = disjuncts_domain->box_domain->binary_join(e1, e2);
     // We'll approximate the raw number of erroneous concrete training sets introduced by the join
-    // by looking at the increase in the num_dropout (relative to the size of the resultant base training set)
-    int dropout_increase = ej.training_set_abstraction.num_dropout - std::min(e1.training_set_abstraction.num_dropout, e2.training_set_abstraction.num_dropout);
-    return (double)dropout_increase / ej.training_set_abstraction.training_references.size();
+    // by looking at the increase in the num_dropout (relative to the size of the resultant base training set).
+    // Both follow from the size of the union (see TrainingSetDropoutDomain::binary_join),
+    // which is counted a word at a time without building the join; combined builds only the joins it picks.
+    const TrainingReferencesWithDropout &t1 = e1.training_set_abstraction, &t2 = e2.training_set_abstraction;
+    int join_size, join_dropout;
+    if(disjuncts_domain->box_domain->isBottomElement(e1)) {
+        join_size = t2.training_references.size();
+        join_dropout = t2.num_dropout;
+    } else if(disjuncts_domain->box_domain->isBottomElement(e2)) {
+        join_size = t1.training_references.size();
+        join_dropout = t1.num_dropout;
+    } else {
+        join_size = DataReferences::union_size(t1.training_references, t2.training_references);
+        int n1 = join_size - t2.training_references.size() + t2.num_dropout; // Note |(T1 U T2) \ T1| = |T2 \ T1|
+        int n2 = join_size - t1.training_references.size() + t1.num_dropout;
+        join_dropout = std::max(n1, n2);
+    }
+    int dropout_increase = join_dropout - std::min(t1.num_dropout, t2.num_dropout);
+    return (double)dropout_increase / join_size;
 }
@@ -7,9 +7,8 @@ std::vector<std::pair<TrainingReferencesWithDropout, PredicateAbstraction>> BoxD
     // The main difference is that we don't actually perform a join over the different predicate outcome possibilities
     std::vector<std::pair<TrainingReferencesWithDropout, PredicateAbstraction>> joins;
     for(auto i = predicate_abstraction.cbegin(); i != predicate_abstraction.cend(); i++) {
-        // The grammar should enforce that each i->has_value()
-        TrainingReferencesWithDropout temp = training_set_abstraction.filter(i->value(), true);
-        joins.push_back(std::make_pair(temp, PredicateAbstraction({*i})));
+        TrainingReferencesWithDropout temp = training_set_abstraction.filter(*i, true);
+        joins.push_back(std::make_pair(temp, PredicateAbstraction(*i)));
     }
     return joins;
 }
@@ -18,8 +17,8 @@ std::vector<std::pair<TrainingReferencesWithDropout, PredicateAbstraction>> BoxD
     // XXX mostly a copy-paste of previous method
     std::vector<std::pair<TrainingReferencesWithDropout, PredicateAbstraction>> joins;
     for(auto i = predicate_abstraction.cbegin(); i != predicate_abstraction.cend(); i++) {
-        TrainingReferencesWithDropout temp = training_set_abstraction.filter(i->value(), false);
-        joins.push_back(std::make_pair(temp, PredicateAbstraction({*i})));
+        TrainingReferencesWithDropout temp = training_set_abstraction.filter(*i, false);
+        joins.push_back(std::make_pair(temp, PredicateAbstraction(*i)));
     }
     return joins;
 }
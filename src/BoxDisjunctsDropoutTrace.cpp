@@ -0,0 +1,118 @@
+#include "BoxDisjunctsDropoutTrace.h"
+#include "BoxStateDomainDropoutInstantiation.h"
+#include "Feature.hpp"
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+BoxDisjunctsDropoutTrace::BoxDisjunctsDropoutTrace(const Single &initial_state, int depth, BoxDropoutMemo *memo) {
+    domains.box_domain.setMemo(memo);
+    this->initial_state = initial_state;
+    this->depth = depth;
+}
+
+// Mirrors what the disjuncts semantics does with a single disjunct in buildTreeUnit
+// (or in the final SummaryNode when depth == 0), up to the ITEModelsNode.
+// As in transformEachDisjunct, a disjunct is dropped as soon as it becomes bottom.
+std::unique_ptr<BoxDisjunctsDropoutTrace::Node> BoxDisjunctsDropoutTrace::buildNode(const Single &state, int depth) const {
+    const BoxDropoutDomain &box_domain = domains.box_domain;
+    std::unique_ptr<Node> node(new Node);
+    node->state = state;
+    node->depth = depth;
+
+    if(depth == 0) {
+        Single summarized = box_domain.applySummary(state);
+        if(!box_domain.isBottomElement(summarized)) {
+            node->posteriors.push_back(summarized.posterior_distribution_abstraction);
+        }
+        return node;
+    }
+
+    // ITEImpurityNode, then branch
+    Single pure = box_domain.meetImpurityEqualsZero(state);
+    if(!box_domain.isBottomElement(pure)) {
+        pure = box_domain.applySummary(pure);
+        if(!box_domain.isBottomElement(pure)) {
+            node->posteriors.push_back(pure.posterior_distribution_abstraction);
+        }
+    }
+
+    // ITEImpurityNode, else branch
+    Single split = box_domain.meetImpurityNotEqualsZero(state);
+    if(box_domain.isBottomElement(split)) {
+        return node;
+    }
+    split = box_domain.applyBestSplit(split);
+    if(box_domain.isBottomElement(split)) {
+        return node;
+    }
+
+    // ITENoPhiNode, then branch
+    Single no_phi = box_domain.meetPhiIsBottom(split);
+    if(!box_domain.isBottomElement(no_phi)) {
+        no_phi = box_domain.applySummary(no_phi);
+        if(!box_domain.isBottomElement(no_phi)) {
+            node->posteriors.push_back(no_phi.posterior_distribution_abstraction);
+        }
+    }
+
+    // ITENoPhiNode, else branch: the ITEModelsNode is left to replay
+    Single phi = box_domain.meetPhiIsNotBottom(split);
+    if(!box_domain.isBottomElement(phi)) {
+        node->predicates = phi.predicate_abstraction;
+        node->models = std::vector<Successors>(node->predicates.size());
+        node->not_models = std::vector<Successors>(node->predicates.size());
+    }
+    return node;
+}
+
+const std::vector<std::unique_ptr<BoxDisjunctsDropoutTrace::Node>>& BoxDisjunctsDropoutTrace::successors(Node &node, unsigned int predicate_index, bool positive_flag) {
+    Successors &ret = (positive_flag ? node.models : node.not_models)[predicate_index];
+    std::call_once(ret.built, [this, &node, &ret, predicate_index, positive_flag]() {
+        PredicateAbstraction phi(node.predicates[predicate_index]);
+        std::vector<std::pair<TrainingReferencesWithDropout, PredicateAbstraction>> filtered;
+        if(positive_flag) {
+            filtered = domains.disjuncts_domain.filter(node.state.training_set_abstraction, phi);
+        } else {
+            filtered = domains.disjuncts_domain.filterNegated(node.state.training_set_abstraction, phi);
+        }
+        for(auto i = filtered.cbegin(); i != filtered.cend(); i++) {
+            Single disjunct = {i->first, i->second, node.state.posterior_distribution_abstraction};
+            if(!domains.box_domain.isBottomElement(disjunct)) {
+                ret.nodes.push_back(buildNode(disjunct, node.depth - 1));
+            }
+        }
+    });
+    return ret.nodes;
+}
+
+void BoxDisjunctsDropoutTrace::replay(Node &node, const FeatureVector &x, std::vector<PosteriorDistributionAbstraction> &posteriors) {
+    posteriors.insert(posteriors.end(), node.posteriors.cbegin(), node.posteriors.cend());
+    for(unsigned int i = 0; i < node.predicates.size(); i++) {
+        PredicateAbstraction phi(node.predicates[i]);
+        if(!domains.Phi_domain.isBottomElement(domains.Phi_domain.meetXModelsPhi(phi, x))) {
+            const std::vector<std::unique_ptr<Node>> &next = successors(node, i, true);
+            for(auto j = next.cbegin(); j != next.cend(); j++) {
+                replay(**j, x, posteriors);
+            }
+        }
+        if(!domains.Phi_domain.isBottomElement(domains.Phi_domain.meetXNotModelsPhi(phi, x))) {
+            const std::vector<std::unique_ptr<Node>> &next = successors(node, i, false);
+            for(auto j = next.cbegin(); j != next.cend(); j++) {
+                replay(**j, x, posteriors);
+            }
+        }
+    }
+}
+
+PosteriorDistributionAbstraction BoxDisjunctsDropoutTrace::run(const FeatureVector &x) {
+    std::call_once(root.built, [this]() {
+        root.nodes.push_back(buildNode(initial_state, depth));
+    });
+    std::vector<PosteriorDistributionAbstraction> posteriors;
+    for(auto i = root.nodes.cbegin(); i != root.nodes.cend(); i++) {
+        replay(**i, x, posteriors);
+    }
+    return domains.D_domain.join(posteriors);
+}
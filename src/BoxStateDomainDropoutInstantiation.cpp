@@ -2,7 +2,9 @@
 #include "Feature.hpp"
 #include "information_math.h"
 #include "Interval.h"
+#include "SplitCounts.h"
 #include <algorithm>
+#include <cstdint>
 #include <list>
 #include <numeric> // for std::accumulate
 #include <set>
@@ -28,45 +30,41 @@ TrainingReferencesWithDropout::TrainingReferencesWithDropout(DataReferences trai
 }
 
 std::vector<int> TrainingReferencesWithDropout::baseCounts() const {
-    std::vector<int> counts(training_references.getNumCategories(), 0);
-    for(unsigned int i = 0; i < training_references.size(); i++) {
-        counts[training_references[i].y]++;
-    }
-    return counts;
+    return training_references.labelCounts();
 }
 
 std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDropout::DropoutCounts> TrainingReferencesWithDropout::splitCounts(const SymbolicPredicate &phi) const {
-    // If we are in this case, the feature type is boolean, therefore, we don't have to worry about feature poisoning uncertainty
     std::pair<DropoutCounts, DropoutCounts> ret;
-    ret.first.counts = std::vector<int>(training_references.getNumCategories(), 0);
-    ret.second.counts = std::vector<int>(training_references.getNumCategories(), 0);
-    DropoutCounts *d_ptr;
-    int maybe_count = 0;
-    for(unsigned int i = 0; i < training_references.size(); i++) {
-        int category = training_references[i].y;
+    int num_maybes = 0;
+    if(phi.get_feature_type() == FeatureType::BOOLEAN) {
         if (feature_flip_index == phi.get_feature_index()) {
             // Boolean feature, no point in evaluating because we can't determine anything given feature poisoning.
-            // Increment both counts.
-            d_ptr = &(ret.second);
-            d_ptr->counts[category]++;
-            d_ptr = &(ret.first);
-            d_ptr->counts[category]++;
+            // Both sides get every element.
+            ret.first.counts = baseCounts();
+            ret.second.counts = ret.first.counts;
+        } else {
+            SplitCounts split = countBooleanSplit(training_references, phi.get_feature_index());
+            ret.first.counts = split.unsatisfied;
+            ret.second.counts = split.satisfied;
         }
-        else {
-            std::optional<bool> result = phi.evaluate(training_references[i].x, false);
-            // Boolean feature always returns true or false from evaluate
-            d_ptr = result.value() ? &(ret.second) : &(ret.first);
-            d_ptr->counts[category]++;
+    } else {
+        // As in filter: an element that could go either way goes both ways, and might have to be dropped from either
+        float feature_flip_band = (feature_flip_index == (int)phi.get_feature_index() ? feature_flip_amt : 0);
+        SplitCounts split = countThresholdSplit(training_references, phi.get_feature_index(), phi.get_lb() - feature_flip_band, phi.get_ub() + feature_flip_band);
+        ret.first.counts = split.unsatisfied;
+        ret.second.counts = split.satisfied;
+        for(unsigned int i = 0; i < split.maybe.size(); i++) {
+            ret.first.counts[i] += split.maybe[i];
+            ret.second.counts[i] += split.maybe[i];
+            num_maybes += split.maybe[i];
         }
     }
 
-    // Ensure num_dropouts are well-defined XXX this is more complicated in the 3-valued case
-    // except that it's not---again, there should be an invariant that we never fall into
-    // maybe cases in this portion of the code
+    // Ensure num_dropouts are well-defined (the maybes, on both sides, might have to be dropped from either)
     std::vector<DropoutCounts*> iters = {&(ret.first), &(ret.second)};
     for(auto i = iters.begin(); i != iters.end(); i++) {
         int total_ct = std::accumulate((*i)->counts.cbegin(), (*i)->counts.cend(), 0);
-        (*i)->num_dropout = std::min(num_dropout, total_ct);
+        (*i)->num_dropout = std::min(num_dropout + num_maybes, total_ct);
         // correct for one-sided cases for extra precision. Not needed for soundness.
         (*i)->num_labels_flip = std::min(num_labels_flip, total_ct);
         (*i)->label_sens_info = label_sens_info;
@@ -82,15 +80,16 @@ std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDr
 TrainingReferencesWithDropout TrainingReferencesWithDropout::pureSetRestriction(std::list<int> pure_possible_classes) const {
     DataReferences training_copy = training_references;
     int num_removed = 0;
+    std::vector<bool> keep(training_copy.size(), true);
     for(unsigned int i = 0; i < training_copy.size(); i++) {
-        const int current_y = training_copy[i].y;
+        const int current_y = training_copy.getLabel(i);
         if(std::none_of(pure_possible_classes.cbegin(), pure_possible_classes.cend(),
                     [&current_y](int y) { return y == current_y; })) {
-            training_copy.remove(i);
+            keep[i] = false;
             num_removed++;
-            i--;
         }
     }
+    training_copy.filter(keep);
     // We will only call this when it's guaranteed to be non-trivial,
     // so we need not check that num_removed <= num_dropout
     return TrainingReferencesWithDropout(training_copy, num_dropout - num_removed, num_add, add_sens_info, num_labels_flip, label_sens_info, num_features_flip, feature_flip_index, feature_flip_amt);
@@ -99,36 +98,31 @@ TrainingReferencesWithDropout TrainingReferencesWithDropout::pureSetRestriction(
 TrainingReferencesWithDropout TrainingReferencesWithDropout::filter(const SymbolicPredicate &phi, bool positive_flag) const {
     // Note: I would expect to end up here only in the abstract (box) case, but we also end up here for -V via filterAndUnion
     TrainingReferencesWithDropout ret(*this);
-    bool remove;
-    std::optional<bool> result;
     int num_maybes = 0;
     int feature_index = phi.get_feature_index();
-    for(unsigned int i = 0; i < ret.training_references.size(); i++) {
-       if (ret.feature_flip_index == feature_index) {
-            result = phi.evaluate(ret.training_references[i].x, true, ret.feature_flip_amt);
-
+    const DataColumns &columns = ret.training_references.getColumns();
+    std::vector<bool> keep(ret.training_references.size(), true);
+    // Under feature flipping, elements near the threshold could go either way
+    bool feature_poisoning = (ret.feature_flip_index == feature_index);
+    float feature_flip_amt = (feature_poisoning ? ret.feature_flip_amt : 0);
+    // The loop is instantiated per feature type, so that evaluating doesn't switch on the type per row
+    auto filter_by = [&](const auto &evaluate) {
+        for(unsigned int i = 0; i < ret.training_references.size(); i++) {
+            std::optional<bool> result = evaluate(ret.training_references.getIndex(i));
             // We return {} when x in [lb-1, ub+1] - we might include it, but might not
             if (!result.has_value()) {
                 num_maybes++;
             } else if (positive_flag != result.value()) {
-                ret.training_references.remove(i);
-                i--;
-            }
-        }
-        else
-        {
-            result = phi.evaluate(ret.training_references[i].x, false, 0);
-            if (!result.has_value()) {
-                num_maybes++;
-            }
-            remove = result.has_value() && (positive_flag != result.value());
-            if (remove) {
-                ret.training_references.remove(i);
-                i--;
+                keep[i] = false;
             }
         }
-        
+    };
+    if(phi.get_feature_type() == FeatureType::BOOLEAN) {
+        filter_by([&phi, &columns](int row) { return std::optional<bool>(phi.evaluateBoolean(columns, row)); });
+    } else {
+        filter_by([&phi, &columns, feature_poisoning, feature_flip_amt](int row) { return phi.evaluateNumeric(columns, row, feature_poisoning, feature_flip_amt); });
     }
+    ret.training_references.filter(keep);
     // We don't know whether the 'maybe' points are in the dataset - so we might have to drop them,
     // which is why we increase n. We don't have to increase # of labels of features to flip.
     ret.num_dropout = std::min(ret.num_dropout + num_maybes, (int)ret.training_references.size());
@@ -137,6 +131,69 @@ TrainingReferencesWithDropout TrainingReferencesWithDropout::filter(const Symbol
     return ret;
 }
 
+/**
+ * SortedSplitCounts members
+ */
+
+SortedSplitCounts::SortedSplitCounts(const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) {
+    this->training_set_abstraction = &training_set_abstraction;
+    const DataReferences &references = training_set_abstraction.training_references;
+    const DataColumns &columns = references.getColumns();
+    const float *values = columns.numericColumn(feature_index);
+    const int *labels = columns.labelColumn();
+    const float *label_sens_values = (training_set_abstraction.label_sens_info.first > -1 ? columns.numericColumn(training_set_abstraction.label_sens_info.first) : NULL);
+    num_categories = references.getNumCategories();
+    feature_flip_band = (training_set_abstraction.feature_flip_index == feature_index ? training_set_abstraction.feature_flip_amt : 0);
+
+    RowSpan sorted_rows = references.sortedRows(feature_index);
+    sorted_values.resize(references.size());
+    prefix_counts.assign(((size_t)references.size() + 1) * num_categories, 0);
+    prefix_sensitive.assign(references.size() + 1, 0);
+    for(unsigned int j = 0; j < references.size(); j++) {
+        int row = sorted_rows[j];
+        sorted_values[j] = values[row];
+        std::copy(prefix_counts.cbegin() + (size_t)j * num_categories, prefix_counts.cbegin() + (size_t)(j + 1) * num_categories,
+                  prefix_counts.begin() + (size_t)(j + 1) * num_categories);
+        prefix_counts[(size_t)(j + 1) * num_categories + labels[row]]++;
+        prefix_sensitive[j + 1] = prefix_sensitive[j] +
+            (label_sens_values != NULL && label_sens_values[row] == training_set_abstraction.label_sens_info.second);
+    }
+}
+
+void SortedSplitCounts::countSide(TrainingReferencesWithDropout::DropoutCounts &ret, unsigned int begin, unsigned int end, int num_maybes) const {
+    const TrainingReferencesWithDropout &t = *training_set_abstraction;
+    ret.counts.resize(num_categories);
+    for(unsigned int k = 0; k < num_categories; k++) {
+        ret.counts[k] = prefix_counts[(size_t)end * num_categories + k] - prefix_counts[(size_t)begin * num_categories + k];
+    }
+    int total_ct = end - begin;
+    // As in filter: the maybes might have to be dropped from either side
+    ret.num_dropout = std::min(t.num_dropout + num_maybes, total_ct);
+    ret.num_labels_flip = std::min(t.num_labels_flip, total_ct);
+    if(t.label_sens_info.first > -1) {
+        // One-sided: only the targets on this side can have their labels flipped
+        ret.num_labels_flip = std::min(ret.num_labels_flip, prefix_sensitive[end] - prefix_sensitive[begin]);
+    }
+    ret.label_sens_info = t.label_sens_info;
+    ret.num_add = t.num_add;
+    ret.add_sens_info = t.add_sens_info;
+    ret.num_features_flip = std::min(t.num_features_flip, total_ct);
+    ret.feature_flip_index = t.feature_flip_index;
+    ret.feature_flip_amt = t.feature_flip_amt;
+}
+
+std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDropout::DropoutCounts> SortedSplitCounts::operator()(const SymbolicPredicate &phi) const {
+    // Same bounds as SymbolicPredicate::evaluate: x <= lb - band satisfies phi, and x < ub + band might
+    unsigned int satisfied_end = std::upper_bound(sorted_values.cbegin(), sorted_values.cend(), phi.get_lb() - feature_flip_band) - sorted_values.cbegin();
+    unsigned int maybe_end = std::lower_bound(sorted_values.cbegin(), sorted_values.cend(), phi.get_ub() + feature_flip_band) - sorted_values.cbegin();
+    maybe_end = std::max(maybe_end, satisfied_end);
+    int num_maybes = maybe_end - satisfied_end;
+    std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDropout::DropoutCounts> ret;
+    countSide(ret.first, 0, maybe_end, num_maybes);
+    countSide(ret.second, satisfied_end, sorted_values.size(), num_maybes);
+    return ret;
+}
+
 /**
  * TrainingSetDropoutDomain members
  */
@@ -196,30 +253,100 @@ TrainingReferencesWithDropout TrainingSetDropoutDomain::binary_join(const Traini
     return TrainingReferencesWithDropout(d, std::max(n1, n2), new_add, e1.add_sens_info, new_labels, e1.label_sens_info,  new_flip, e1.feature_flip_index, e1.feature_flip_amt);
 }
 
+/**
+ * BoxDropoutMemo members
+ */
+
+// The usual boost-style combination
+static void hashCombine(size_t &seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+PackedTrainingReferencesWithDropout::PackedTrainingReferencesWithDropout(const TrainingReferencesWithDropout &element) {
+    data_set = element.training_references.getDataSet();
+    rows = element.training_references.getMembers();
+    num_dropout = element.num_dropout;
+    num_add = element.num_add;
+    add_sens_info = element.add_sens_info;
+    num_labels_flip = element.num_labels_flip;
+    label_sens_info = element.label_sens_info;
+    num_features_flip = element.num_features_flip;
+    feature_flip_index = element.feature_flip_index;
+    feature_flip_amt = element.feature_flip_amt;
+}
+
+TrainingReferencesWithDropout PackedTrainingReferencesWithDropout::unpack() const {
+    DataReferences training_references = (data_set == NULL ? DataReferences() : DataReferences(data_set, rows));
+    return TrainingReferencesWithDropout(training_references, num_dropout, num_add, add_sens_info, num_labels_flip, label_sens_info, num_features_flip, feature_flip_index, feature_flip_amt);
+}
+
+bool PackedTrainingReferencesWithDropout::operator ==(const PackedTrainingReferencesWithDropout &right) const {
+    return data_set == right.data_set && rows == right.rows &&
+        num_dropout == right.num_dropout && num_add == right.num_add && add_sens_info == right.add_sens_info &&
+        num_labels_flip == right.num_labels_flip && label_sens_info == right.label_sens_info &&
+        num_features_flip == right.num_features_flip && feature_flip_index == right.feature_flip_index &&
+        feature_flip_amt == right.feature_flip_amt;
+}
+
+size_t PackedTrainingReferencesWithDropout::hash() const {
+    size_t ret = rows.hash();
+    for(int value : {num_dropout, num_add, add_sens_info.first, add_sens_info.second, num_labels_flip,
+                     label_sens_info.first, label_sens_info.second, num_features_flip, feature_flip_index}) {
+        hashCombine(ret, std::hash<int>{}(value));
+    }
+    hashCombine(ret, std::hash<float>{}(feature_flip_amt));
+    return ret;
+}
+
+size_t PackedTrainingReferencesWithDropout::memoryUsage() const {
+    return sizeof(PackedTrainingReferencesWithDropout) + rows.numWords() * sizeof(uint64_t);
+}
+
+bool BoxDropoutMemoKey::operator ==(const BoxDropoutMemoKey &right) const {
+    return operation == right.operation &&
+        training_set_abstraction == right.training_set_abstraction &&
+        predicate == right.predicate;
+}
+
+size_t hash_BoxDropoutMemoKey::operator()(const BoxDropoutMemoKey &key) const {
+    size_t ret = key.training_set_abstraction.hash();
+    hashCombine(ret, (size_t)key.operation);
+    if(key.predicate.has_value()) {
+        hashCombine(ret, key.predicate.value().hash());
+    }
+    return ret;
+}
+
+// training_set_abstraction.filter(phi, positive_flag), looked up in (and added to) memo unless it is NULL
+static TrainingReferencesWithDropout memoizedFilter(BoxDropoutMemo *memo, const TrainingReferencesWithDropout &training_set_abstraction, const SymbolicPredicate &phi, bool positive_flag) {
+    if(memo == NULL) {
+        return training_set_abstraction.filter(phi, positive_flag);
+    }
+    BoxDropoutMemoKey key = {
+        positive_flag ? BoxDropoutMemoKey::Operation::FILTER : BoxDropoutMemoKey::Operation::FILTER_NEGATED,
+        PackedTrainingReferencesWithDropout(training_set_abstraction),
+        phi
+    };
+    std::optional<BoxDropoutMemoValue> cached = memo->lookup(key);
+    if(cached.has_value()) {
+        return std::get<PackedTrainingReferencesWithDropout>(cached.value()).unpack();
+    }
+    TrainingReferencesWithDropout ret = training_set_abstraction.filter(phi, positive_flag);
+    PackedTrainingReferencesWithDropout stored(ret);
+    memo->insert(key, stored, key.training_set_abstraction.memoryUsage() + stored.memoryUsage());
+    return ret;
+}
+
 /**
  * PredicateSetDomain members
  */
 
 PredicateAbstraction PredicateSetDomain::meetPhiIsBottom(const PredicateAbstraction &element) const {
-    bool contains_bottom = std::any_of(element.cbegin(), element.cend(),
-            [](std::optional<SymbolicPredicate> phi){ return !phi.has_value(); });
-    if(contains_bottom) {
-        std::optional<SymbolicPredicate> bottom = {};
-        return PredicateAbstraction({bottom}); // The vector of a single bottom element.
-    } else {
-        return PredicateAbstraction(); // The empty vector
-    }
+    return element.containsBottom() ? PredicateAbstraction::onlyBottom() : PredicateAbstraction();
 }
 
 PredicateAbstraction PredicateSetDomain::meetPhiIsNotBottom(const PredicateAbstraction &element) const {
-    PredicateAbstraction phis(element); // Make a copy
-    // Iterate over the copy and delete any bottom element
-    for(auto i = phis.begin(); i != phis.end(); i++) {
-        if(!i->has_value()) { // It should be an invariant of the code that this only happens once, but...
-            phis.erase(i--);
-        }
-    }
-    return phis;
+    return element.withoutBottom();
 }
 
 PredicateAbstraction PredicateSetDomain::meetXModelsPhi(const PredicateAbstraction &element, const FeatureVector &x) const {
@@ -228,36 +355,35 @@ PredicateAbstraction PredicateSetDomain::meetXModelsPhi(const PredicateAbstracti
     if(isBottomElement(element)) {
         return element;
     }
-    PredicateAbstraction phis;
+    // The grammar should enforce that element doesn't contain bot here
+    std::vector<SymbolicPredicate> phis;
     for(auto i = element.cbegin(); i != element.cend(); i++) {
-        // The grammar should enforce that we always have i->has_value()
-        std::optional<bool> result = i->value().evaluate(x, false);
+        std::optional<bool> result = i->evaluate(x, false);
         // With three-valued logic, we include "maybe" (!result.has_value())
         if(!result.has_value() || result.value()) {
             phis.push_back(*i);
         }
     }
-    return phis;
+    return PredicateAbstraction(std::move(phis)); // Still in order
 }
 
 PredicateAbstraction PredicateSetDomain::meetXNotModelsPhi(const PredicateAbstraction &element, const FeatureVector &x) const {
     if(isBottomElement(element)) {
         return element;
     }
-    PredicateAbstraction phis;
+    std::vector<SymbolicPredicate> phis;
     for(auto i = element.cbegin(); i != element.cend(); i++) {
-        // The grammar should enforce that we always have i->has_value()
-        std::optional<bool> result = i->value().evaluate(x, false);
+        std::optional<bool> result = i->evaluate(x, false);
         // With three-valued logic, we include "maybe" (!result.has_value())
         if(!result.has_value() || !result.value()) { // This is the only line that differs from meetXModelsPhi
             phis.push_back(*i);
         }
     }
-    return phis;
+    return PredicateAbstraction(std::move(phis));
 }
 
 bool PredicateSetDomain::isBottomElement(const PredicateAbstraction &element) const {
-    return element.size() == 0;
+    return element.isBottomElement();
 }
 
 PredicateAbstraction PredicateSetDomain::binary_join(const PredicateAbstraction &e1, const PredicateAbstraction &e2) const {
@@ -266,15 +392,7 @@ PredicateAbstraction PredicateSetDomain::binary_join(const PredicateAbstraction
     } else if(isBottomElement(e2)) {
         return e1;
     }
-    // TODO take advantage of algorithm's std::set_union
-    PredicateAbstraction phis = e1; // Make a copy
-    for(auto i = e2.cbegin(); i != e2.cend(); i++) {
-        if(std::none_of(phis.cbegin(), phis.cend(),
-                    [&i](std::optional<SymbolicPredicate> j){ return *i == *j; })) {
-            phis.push_back(*i);
-        }
-    }
-    return phis;
+    return PredicateAbstraction::join(e1, e2);
 }
 
 /**
@@ -320,59 +438,74 @@ inline bool mustBeEmpty(const TrainingReferencesWithDropout::DropoutCounts &coun
     return std::accumulate(counts.counts.begin(), counts.counts.end(), 0) == 0;
 }
 
-void BoxDropoutDomain::computePredicatesAndScores(std::list<ScoreEntry> &exists_nontrivial, std::list<const ScoreEntry *> &forall_nontrivial, const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) const {
+// The joint impurity of a split, through the allocation-free binary kernel when there are two categories
+// (the only case the abstract estimate handles precisely; the std::vector version covers the rest)
+inline Interval<double> splitScore(const TrainingReferencesWithDropout::DropoutCounts &first, const TrainingReferencesWithDropout::DropoutCounts &second, const TrainingReferencesWithDropout &training_set_abstraction) {
+    if(training_set_abstraction.training_references.getNumCategories() == 2) {
+        return jointImpurity(CategoryCounts<2>{first.counts[0], first.counts[1]},
+                             first.num_dropout, first.num_add, first.num_labels_flip, first.num_features_flip,
+                             CategoryCounts<2>{second.counts[0], second.counts[1]},
+                             second.num_dropout, second.num_add, second.num_labels_flip, second.num_features_flip,
+                             training_set_abstraction.label_sens_info, training_set_abstraction.add_sens_info);
+    }
+    return jointImpurity(first.counts,
+                         first.num_dropout, first.num_add, first.num_labels_flip, first.num_features_flip,
+                         second.counts,
+                         second.num_dropout, second.num_add, second.num_labels_flip, second.num_features_flip,
+                         training_set_abstraction.label_sens_info, training_set_abstraction.add_sens_info);
+}
+
+void BoxDropoutDomain::computePredicatesAndScores(SplitCandidates &candidates, const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) const {
     switch(training_set_abstraction.training_references.getFeatureTypes()[feature_index]) {
         // XXX need to make changes here if adding new feature types
         case FeatureType::BOOLEAN:
-            computeBooleanFeaturePredicateAndScore(exists_nontrivial, forall_nontrivial, training_set_abstraction, feature_index);
+            computeBooleanFeaturePredicateAndScore(candidates, training_set_abstraction, feature_index);
             break;
         case FeatureType::NUMERIC:
-            computeNumericFeaturePredicatesAndScores(exists_nontrivial, forall_nontrivial, training_set_abstraction, feature_index);
+            computeNumericFeaturePredicatesAndScores(candidates, training_set_abstraction, feature_index);
             break;
     }
 }
 
-void BoxDropoutDomain::computeBooleanFeaturePredicateAndScore(std::list<ScoreEntry> &exists_nontrivial, std::list<const ScoreEntry *> &forall_nontrivial, const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) const {
+void BoxDropoutDomain::computeBooleanFeaturePredicateAndScore(SplitCandidates &candidates, const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) const {
     SymbolicPredicate phi(feature_index);
     // all of our features are numeric, so not applicable, but could improve precision here (not necessary for soundness)
     auto counts = training_set_abstraction.splitCounts(phi);
     // TO DO  - update num_labels_flip here because Joint Impurity expects it to be one-sided up to date
     if(!mustBeEmpty(counts.first) && !mustBeEmpty(counts.second)) {
-        Interval<double> temp = jointImpurity(counts.first.counts,
-                                              counts.first.num_dropout, counts.first.num_add, counts.first.num_labels_flip, counts.first.num_features_flip,
-                                              counts.second.counts,
-                                              counts.second.num_dropout, counts.second.num_add, counts.second.num_labels_flip, counts.second.num_features_flip,
-                                              training_set_abstraction.label_sens_info, training_set_abstraction.add_sens_info);
-        exists_nontrivial.push_back(std::make_pair(phi, temp));
-        if(!couldBeEmpty(counts.first) && !couldBeEmpty(counts.second)) {
-            forall_nontrivial.push_back(&exists_nontrivial.back());
-        }
+        Interval<double> temp = splitScore(counts.first, counts.second, training_set_abstraction);
+        candidates.add(phi, temp, !couldBeEmpty(counts.first) && !couldBeEmpty(counts.second));
     }
 }
 
-void BoxDropoutDomain::computeNumericFeaturePredicatesAndScores(std::list<ScoreEntry> &exists_nontrivial, std::list<const ScoreEntry *> &forall_nontrivial, const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) const {
+void BoxDropoutDomain::computeNumericFeaturePredicatesAndScores(SplitCandidates &candidates, const TrainingReferencesWithDropout &training_set_abstraction, int feature_index) const {
     // 0 is value of item that phi looks at, 1 is label, 2 is value of label-flipping target, 3 is value of adding target
     std::vector<std::tuple<float,int, int, int>> value_class_pairs(training_set_abstraction.training_references.size());
 
-    // Access the data, only looking at the feature that is relevant for this predicate and for one-sided data poisoning
-    for(unsigned int j = 0; j < training_set_abstraction.training_references.size(); j++) {
-        DataRow temp = training_set_abstraction.training_references[j];
-       std:: get<0>(value_class_pairs[j]) = temp.x[feature_index].getNumericValue();
-       std::get<1>(value_class_pairs[j]) = temp.y;
-        if (training_set_abstraction.label_sens_info.first > -1) {
-            std::get<2>(value_class_pairs[j]) = temp.x[training_set_abstraction.label_sens_info.first].getNumericValue();
+    // Access the data, only looking at the columns that are relevant for this predicate and for one-sided data poisoning
+    const DataReferences &references = training_set_abstraction.training_references;
+    const DataColumns &columns = references.getColumns();
+    const float *values = columns.numericColumn(feature_index);
+    const int *labels = columns.labelColumn();
+    const float *label_sens_values = (training_set_abstraction.label_sens_info.first > -1 ? columns.numericColumn(training_set_abstraction.label_sens_info.first) : NULL);
+    const float *add_sens_values = (training_set_abstraction.add_sens_info.first > -1 ? columns.numericColumn(training_set_abstraction.add_sens_info.first) : NULL);
+    // Visiting the rows presorted by this feature leaves value_class_pairs in increasing order (with possible multiplicity)
+    RowSpan sorted_rows = references.sortedRows(feature_index);
+    for(unsigned int j = 0; j < references.size(); j++) {
+        int row = sorted_rows[j];
+        std::get<0>(value_class_pairs[j]) = values[row];
+        std::get<1>(value_class_pairs[j]) = labels[row];
+        if (label_sens_values != NULL) {
+            std::get<2>(value_class_pairs[j]) = label_sens_values[row];
         }
-        if (training_set_abstraction.add_sens_info.first > -1) {
-            std::get<3>(value_class_pairs[j]) = temp.x[training_set_abstraction.add_sens_info.first].getNumericValue();
+        if (add_sens_values != NULL) {
+            std::get<3>(value_class_pairs[j]) = add_sens_values[row];
         }
     }
     if(value_class_pairs.size() < 2) {
         return;
     }
-    
-    std::sort(value_class_pairs.begin(), value_class_pairs.end(),
-              [](const std::tuple<float,int, int, int> &p1, const std::tuple<float,int, int, int> &p2)
-              { return std::get<0>(p1) < std::get<0>(p2); } );
+
     std::pair<TrainingReferencesWithDropout::DropoutCounts, TrainingReferencesWithDropout::DropoutCounts> split_counts = {
             { std::vector<int>(training_set_abstraction.training_references.getNumCategories(), 0), 0 },
             { training_set_abstraction.baseCounts(), training_set_abstraction.num_dropout, training_set_abstraction.num_add,
@@ -389,16 +522,13 @@ void BoxDropoutDomain::computeNumericFeaturePredicatesAndScores(std::list<ScoreE
 
     // iterating through training data elements    
     if (feature_index == training_set_abstraction.feature_flip_index) {
-        std::list<SymbolicPredicate> phis_to_add = {};
+        std::vector<SymbolicPredicate> phis_to_add;
         float feat_flip_amt = training_set_abstraction.feature_flip_amt;
-        std::list<float> vals_of_phi = {};
+        std::vector<float> vals_of_phi;
+        phis_to_add.reserve(4 * value_class_pairs.size());
+        vals_of_phi.reserve(3 * value_class_pairs.size());
 
         for (auto i = value_class_pairs.begin(); i + 1 != value_class_pairs.end(); i++) {
-            if (training_set_abstraction.label_sens_info.first > -1) {
-                if (std::get<2>(*i) == training_set_abstraction.label_sens_info.second) {
-                    num_label_second += 1;
-                }
-            }
             // If value of this and same match, just continue to next one
             if(std::get<0>(*i) == std::get<0>(*(i+1))) {
                 continue;
@@ -417,138 +547,32 @@ void BoxDropoutDomain::computeNumericFeaturePredicatesAndScores(std::list<ScoreE
             phis_to_add.push_back(SymbolicPredicate(feature_index, std::get<0>(*i), std::get<0>(*(i+1))));
         }
 
-        vals_of_phi.push_back(std::get<0>(*(value_class_pairs.end())) - feat_flip_amt);
-        vals_of_phi.push_back(std::get<0>(*(value_class_pairs.end())));
-        vals_of_phi.push_back(std::get<0>(*(value_class_pairs.end())) + feat_flip_amt);
+        // The largest value gets its band too (this used to read one past the end of value_class_pairs,
+        // which put a band around 0 instead and left thresholds in [max, max + f) uncovered)
+        vals_of_phi.push_back(std::get<0>(value_class_pairs.back()) - feat_flip_amt);
+        vals_of_phi.push_back(std::get<0>(value_class_pairs.back()));
+        vals_of_phi.push_back(std::get<0>(value_class_pairs.back()) + feat_flip_amt);
 
-        vals_of_phi.sort([](const float a, const float b) { return a < b; });
+        std::stable_sort(vals_of_phi.begin(), vals_of_phi.end());
 
-        while (vals_of_phi.size() > 1) {
-            float val = vals_of_phi.front();
-            vals_of_phi.pop_front();
-            float val_next = vals_of_phi.front();
-            if (val == val_next) {
+        for (auto i = vals_of_phi.cbegin(); i + 1 < vals_of_phi.cend(); i++) {
+            if (*i == *(i+1)) {
                 continue;
             }
 
-            phis_to_add.push_back(SymbolicPredicate(feature_index, val, val_next));
+            phis_to_add.push_back(SymbolicPredicate(feature_index, *i, *(i+1)));
         }
 
-        int start = 0;
-        int last_removed = 0;
-
-        int lb; int ub; int num_dropout_incr_first; int num_dropout_incr_second;
-
-        while (!phis_to_add.empty()) {
-            int two_less = 0;
-
-            SymbolicPredicate phi = phis_to_add.front();
-            phis_to_add.pop_front();
-            lb = phi.get_lb();
-            ub = phi.get_ub();
-
-            int num_dropout_iffy_first = 0; int num_dropout_iffy_second = 0;
-            int num_dropout_inclusive_first = 0; int num_dropout_inclusive_second = 0;
-
-            // Calculate the number in our iffy range [lb-1, lb+1)
-            for (int i = two_less; i< value_class_pairs.size(); i++) {
-                auto item = value_class_pairs[i];
-                // n will be the total number of superfluous elements
-                // for split_counts.first, all elements in (lb, lb+f] are potentially superfluous and up to f
-                // elements in (B-fa, B] are superfluous. Flipped for split_counts.second.
-                if (std::get<0>(item) < lb - feat_flip_amt) {
-                    two_less += 1; // we won't have to consider this index again, next phi lb will be higher
-                } else if (std::get<0>(item) < lb) {
-                    if (num_dropout_inclusive_first < training_set_abstraction.num_features_flip) {
-                        num_dropout_inclusive_first += 1;
-                    }
-                    num_dropout_iffy_second += 1;
-                }
-                else if (std::get<0>(item) < lb + feat_flip_amt) {
-                    if (num_dropout_inclusive_second < training_set_abstraction.num_features_flip) {
-                        num_dropout_inclusive_second += 1;
-                    }
-                    num_dropout_iffy_first += 1;
-                } else {
-                    break;
-                }
-            }
-            
-            num_dropout_incr_first = num_dropout_iffy_first + num_dropout_inclusive_first;
-            num_dropout_incr_second = num_dropout_iffy_second + num_dropout_inclusive_second;
-
-            // For anything in [start, lb+1), add to split_counts.first
-            for (int i=start; i<value_class_pairs.size(); i++) {
-                auto item = value_class_pairs[i];
-                if (std::get<0>(item) < lb + feat_flip_amt) {
-                    split_counts.first.counts[std::get<1>(item)]++;
-                    start += 1;
-
-                    if (training_set_abstraction.label_sens_info.first > -1) {
-                        if (std::get<2>(item) == training_set_abstraction.label_sens_info.second) {
-                            num_label_first += 1;
-                        }
-                    }
-                } else {
-                    break;
-                }
-            }
-
-            // For anything in [last_removed, lb-1), remove it from split_counts.second
-            for (int i=last_removed; i<start; i++) {
-                auto item = value_class_pairs[i];
-                if (std::get<0>(item) < lb - feat_flip_amt) {
-                    split_counts.second.counts[std::get<1>(item)]--;
-                    last_removed += 1;
-
-                    if (training_set_abstraction.label_sens_info.first > -1) {
-                        if (std::get<2>(item) == training_set_abstraction.label_sens_info.second) {
-                            num_label_second -= 1;
-                        }
-                    }
-                } else {
-                    break;
-                }
-            }
-
-            // update n, l, and f
-            // need to do - special one-sided addition case: if phi looks at feature, should set to 0 on one branch
-            // ^ would add more precision, but not needed for soundness so I'm leaving for now - hard to mesh = with phi's <
-            int remaining = std::accumulate(split_counts.first.counts.cbegin(), split_counts.first.counts.cend(), 0);
-            split_counts.first.num_dropout = std::min(remaining, training_set_abstraction.num_dropout + num_dropout_incr_first);
-            if ((training_set_abstraction.label_sens_info.first > -1) && (split_counts.first.num_labels_flip < num_label_first) && (split_counts.first.num_labels_flip < training_set_abstraction.num_labels_flip)) {
-                split_counts.first.num_labels_flip++;
-            } else if (split_counts.first.num_labels_flip < training_set_abstraction.num_labels_flip) {
-                split_counts.first.num_labels_flip++;
-            }
-
-            if (split_counts.first.num_features_flip < training_set_abstraction.num_features_flip) {
-                split_counts.first.num_features_flip++;
-            }
-
-            remaining = std::accumulate(split_counts.second.counts.cbegin(), split_counts.second.counts.cend(), 0);
-            split_counts.second.num_dropout = std::min(remaining, training_set_abstraction.num_dropout + num_dropout_incr_second);
-            if ((training_set_abstraction.label_sens_info.first > -1 ) && (num_label_second < split_counts.second.num_labels_flip)) {
-                split_counts.second.num_labels_flip = num_label_second;
-            } else if (remaining < split_counts.second.num_labels_flip) {
-                split_counts.second.num_labels_flip = remaining;
-            }
-
-            if (remaining < split_counts.second.num_features_flip) {
-                split_counts.second.num_features_flip = remaining;
-            }
-
-            Interval<double> temp = jointImpurity(split_counts.first.counts,
-                                        split_counts.first.num_dropout, split_counts.first.num_add,
-                                        split_counts.first.num_labels_flip, split_counts.first.num_features_flip,
-                                        split_counts.second.counts,
-                                        split_counts.second.num_dropout, split_counts.second.num_add,
-                                        split_counts.second.num_labels_flip, split_counts.second.num_features_flip,
-                                        training_set_abstraction.label_sens_info, training_set_abstraction.add_sens_info);
-            exists_nontrivial.push_back(std::make_pair(phi, temp));
-            if (!couldBeEmpty(split_counts.first) && !couldBeEmpty(split_counts.second)) {
-                forall_nontrivial.push_back(&exists_nontrivial.back());
+        // The candidates aren't in threshold order, so each one's sides come from prefix counts
+        // (exactly what filter would keep) rather than from counts carried over from the previous candidate
+        SortedSplitCounts split_counts_of(training_set_abstraction, feature_index);
+        for (auto phi_it = phis_to_add.cbegin(); phi_it != phis_to_add.cend(); phi_it++) {
+            auto counts = split_counts_of(*phi_it);
+            if(mustBeEmpty(counts.first) || mustBeEmpty(counts.second)) {
+                continue;
             }
+            Interval<double> temp = splitScore(counts.first, counts.second, training_set_abstraction);
+            candidates.add(*phi_it, temp, !couldBeEmpty(counts.first) && !couldBeEmpty(counts.second));
         }
     }
     else {
@@ -601,76 +625,185 @@ void BoxDropoutDomain::computeNumericFeaturePredicatesAndScores(std::list<ScoreE
                 continue;
             }
 
-            // At this point, the check for if we should include in exists_nontrivial would always pass.
+            // At this point, the check for if we should include in the exists-nontrivial candidates would always pass.
             // For each adjacent pair (l,u) store a symbolic predicate x<=[l,u)
             SymbolicPredicate phi(feature_index, std::get<0>(*i), std::get<0>(*(i+1)));
-            Interval<double> temp = jointImpurity(split_counts.first.counts,
-                                        split_counts.first.num_dropout, split_counts.first.num_add,
-                                        split_counts.first.num_labels_flip, split_counts.first.num_features_flip,
-                                        split_counts.second.counts,
-                                        split_counts.second.num_dropout, split_counts.second.num_add,
-                                        split_counts.second.num_labels_flip, split_counts.second.num_features_flip,
-                                        training_set_abstraction.label_sens_info, training_set_abstraction.add_sens_info);
-            exists_nontrivial.push_back(std::make_pair(phi, temp));
-            if (!couldBeEmpty(split_counts.first) && !couldBeEmpty(split_counts.second)) {
-                forall_nontrivial.push_back(&exists_nontrivial.back());
-            }
+            Interval<double> temp = splitScore(split_counts.first, split_counts.second, training_set_abstraction);
+            candidates.add(phi, temp, !couldBeEmpty(split_counts.first) && !couldBeEmpty(split_counts.second));
         }
     }
 }
 
 PredicateAbstraction BoxDropoutDomain::bestSplit(const TrainingReferencesWithDropout &training_set_abstraction) const {
-    std::list<ScoreEntry> exists_nontrivial;
-    std::list<const ScoreEntry *> forall_nontrivial; // Points to elements in exists_nontrivial
+    if(memo == NULL) {
+        return computeBestSplit(training_set_abstraction);
+    }
+    BoxDropoutMemoKey key = { BoxDropoutMemoKey::Operation::BEST_SPLIT, PackedTrainingReferencesWithDropout(training_set_abstraction), {} };
+    std::optional<BoxDropoutMemoValue> cached = memo->lookup(key);
+    if(cached.has_value()) {
+        return std::get<PredicateAbstraction>(cached.value());
+    }
+    PredicateAbstraction ret = computeBestSplit(training_set_abstraction);
+    memo->insert(key, ret, key.training_set_abstraction.memoryUsage() + ret.memoryUsage());
+    return ret;
+}
+
+void BoxDropoutDomain::SplitCandidates::add(const SymbolicPredicate &phi, const Interval<double> &score, bool forall_nontrivial) {
+    if(forall_nontrivial && (!min_upper_bound.has_value() || min_upper_bound.value() > score.get_upper_bound())) {
+        min_upper_bound = score.get_upper_bound();
+    }
+    // min_upper_bound only ever goes down, so a score that can't beat it now never will
+    if(min_upper_bound.has_value() && !(score.get_lower_bound() <= min_upper_bound.value())) {
+        return;
+    }
+    kept.push_back(std::make_pair(phi, score));
+    if(kept.size() >= compact_at && min_upper_bound.has_value()) {
+        // Drop what the bound has overtaken since they were kept (remove_if keeps the order)
+        double bound = min_upper_bound.value();
+        kept.erase(std::remove_if(kept.begin(), kept.end(), [bound](const ScoreEntry &entry) { return !(entry.second.get_lower_bound() <= bound); }), kept.end());
+        compact_at = std::max(compact_at, 2 * kept.size());
+    }
+}
+
+PredicateAbstraction BoxDropoutDomain::computeBestSplit(const TrainingReferencesWithDropout &training_set_abstraction) const {
+    SplitCandidates candidates;
     for(int i = 0; i < training_set_abstraction.training_references.getFeatureTypes().size(); i++) {
-        computePredicatesAndScores(exists_nontrivial, forall_nontrivial, training_set_abstraction, i);
+        computePredicatesAndScores(candidates, training_set_abstraction, i);
     }
 
-    if(forall_nontrivial.size() == 0) {
-        PredicateAbstraction ret(exists_nontrivial.size() + 1);
-        int index = 0;
-        for(auto i = exists_nontrivial.cbegin(); i != exists_nontrivial.cend(); i++,index++) {
-            ret[index] = i->first;
+    // The candidates are in the order they were scored (by feature, then threshold), so sorting them is a single pass
+    std::vector<SymbolicPredicate> phis;
+    if(!candidates.min_upper_bound.has_value()) {
+        // No predicate is forall-nontrivial, so nothing was dropped: return them all, and bottom
+        phis.reserve(candidates.kept.size());
+        for(auto i = candidates.kept.cbegin(); i != candidates.kept.cend(); i++) {
+            phis.push_back(i->first);
         }
-        ret[exists_nontrivial.size()] = {}; // The non option type value
-        return ret;
+        return PredicateAbstraction(std::move(phis), true);
     } else {
-        // Find the threshold using only predicates from forall_nontrivial
-        double min_upper_bound; // Always gets initialized unless forall_nontrivial.size() == 0,
-                                // and we prior have an if statement to check that
-        for(auto i = forall_nontrivial.cbegin(); i != forall_nontrivial.cend(); i++) {
-            if(i == forall_nontrivial.begin() || min_upper_bound > (*i)->second.get_upper_bound()) {
-                min_upper_bound = (*i)->second.get_upper_bound();
-            }
-        }
-        // Return any predicates in exists_nontrivial whose score could beat the threshold
-        PredicateAbstraction ret;
-        for(auto i = exists_nontrivial.cbegin(); i != exists_nontrivial.cend(); i++) {
-            if(i->second.get_lower_bound() <= min_upper_bound) {
-                ret.push_back(i->first);
+        // Return any predicates whose score could beat the least upper bound of the forall-nontrivial ones
+        for(auto i = candidates.kept.cbegin(); i != candidates.kept.cend(); i++) {
+            if(i->second.get_lower_bound() <= candidates.min_upper_bound.value()) {
+                phis.push_back(i->first);
             }
         }
-        return ret;
+        return PredicateAbstraction(std::move(phis));
     }
 }
 
 TrainingReferencesWithDropout BoxDropoutDomain::filter(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction) const {
-    // We only use filter in the abstract (box) case
-    std::vector<TrainingReferencesWithDropout> joins;
+    return filterAndJoin(training_set_abstraction, predicate_abstraction, true);
+}
+
+TrainingReferencesWithDropout BoxDropoutDomain::filterNegated(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction) const {
+    return filterAndJoin(training_set_abstraction, predicate_abstraction, false);
+}
+
+// filterAndJoin for two or more predicates, without building each filtered set.
+// Filtering by a numeric predicate keeps a prefix (or, negated, a suffix) of the rows in sortedRows order,
+// whose extent and number of maybes are binary searches away, and the join only needs the size of each one
+// and of the running union; so each feature's rows are added to the union at most once, however many thresholds it has.
+// Folds the joins in the same order as TrainingSetDropoutDomain::join, so the result is identical.
+// Returns false (leaving ret alone) if every filtered set is empty.
+static bool sweepFilterAndJoin(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction, bool positive_flag, TrainingReferencesWithDropout &ret) {
+    const DataReferences &references = training_set_abstraction.training_references;
+    const DataColumns &columns = references.getColumns();
+    const int size = references.size();
+    const int num_features = references.getFeatureTypes().size();
+
+    RowBitset joined(references.getColumns().size());
+    int joined_size = 0;
+    // Per feature, how much of the sortedRows order is already in joined
+    std::vector<int> prefix_end(num_features, 0), suffix_start(num_features, size);
+    auto add = [&joined, &joined_size](int row) {
+        if(!joined.test(row)) {
+            joined.set(row);
+            joined_size++;
+        }
+    };
+
+    bool any_nonempty = false;
+    int num_dropout = 0, num_labels_flip = 0, num_features_flip = 0;
     for(auto i = predicate_abstraction.cbegin(); i != predicate_abstraction.cend(); i++) {
-        // The grammar should enforce that each i->has_value()
-        TrainingReferencesWithDropout temp = training_set_abstraction.filter(i->value(), true);
-        joins.push_back(temp);
+        const SymbolicPredicate &phi = *i;
+        const int feature_index = phi.get_feature_index();
+        const int previous_size = joined_size;
+        int filtered_size, num_maybes = 0;
+        if(phi.get_feature_type() == FeatureType::BOOLEAN) {
+            // As in TrainingReferencesWithDropout::filter, feature flipping doesn't come into it
+            const RowBitset &true_rows = columns.booleanRows(feature_index);
+            const std::vector<int> &rows = references.getIndices();
+            filtered_size = 0;
+            for(auto j = rows.cbegin(); j != rows.cend(); j++) {
+                if(true_rows.test(*j) == positive_flag) {
+                    filtered_size++;
+                    add(*j);
+                }
+            }
+        } else {
+            // The same comparisons as SymbolicPredicate::evaluateNumeric
+            const float *values = columns.numericColumn(feature_index);
+            RowSpan rows = references.sortedRows(feature_index);
+            float feature_flip_band = (training_set_abstraction.feature_flip_index == feature_index ? training_set_abstraction.feature_flip_amt : 0);
+            float lb = phi.get_lb() - feature_flip_band;
+            float ub = phi.get_ub() + feature_flip_band;
+            int num_true = std::partition_point(rows.cbegin(), rows.cend(), [values, lb](int row) { return values[row] <= lb; }) - rows.cbegin();
+            int num_not_false = std::partition_point(rows.cbegin() + num_true, rows.cend(), [values, ub](int row) { return values[row] < ub; }) - rows.cbegin();
+            num_maybes = num_not_false - num_true;
+            if(positive_flag) {
+                filtered_size = num_not_false;
+                for(; prefix_end[feature_index] < num_not_false; prefix_end[feature_index]++) {
+                    add(rows[prefix_end[feature_index]]);
+                }
+            } else {
+                filtered_size = size - num_true;
+                for(; suffix_start[feature_index] > num_true; suffix_start[feature_index]--) {
+                    add(rows[suffix_start[feature_index] - 1]);
+                }
+            }
+        }
+        if(filtered_size == 0) {
+            continue; // Joining with bottom
+        }
+
+        // The fields TrainingReferencesWithDropout::filter would give this filtered set,
+        // joined as in TrainingSetDropoutDomain::binary_join
+        int filtered_num_dropout = std::min(training_set_abstraction.num_dropout + num_maybes, filtered_size);
+        int filtered_num_labels_flip = std::min(training_set_abstraction.num_labels_flip, filtered_size);
+        int filtered_num_features_flip = std::min(training_set_abstraction.num_features_flip, filtered_size);
+        if(!any_nonempty) {
+            any_nonempty = true;
+            num_dropout = filtered_num_dropout;
+            num_labels_flip = filtered_num_labels_flip;
+            num_features_flip = filtered_num_features_flip;
+        } else {
+            num_dropout = std::max(joined_size - filtered_size + filtered_num_dropout, joined_size - previous_size + num_dropout);
+            num_labels_flip = std::max(num_labels_flip, filtered_num_labels_flip);
+            num_features_flip = std::max(num_features_flip, filtered_num_features_flip);
+        }
     }
-    return training_set_domain->join(joins);
+    if(!any_nonempty) {
+        return false;
+    }
+    ret = TrainingReferencesWithDropout(DataReferences(references.getDataSet(), joined), num_dropout, training_set_abstraction.num_add, training_set_abstraction.add_sens_info,
+                                        num_labels_flip, training_set_abstraction.label_sens_info, num_features_flip,
+                                        training_set_abstraction.feature_flip_index, training_set_abstraction.feature_flip_amt);
+    return true;
 }
 
-TrainingReferencesWithDropout BoxDropoutDomain::filterNegated(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction) const {
-    // XXX copy and pasted previous method with one change; refactor with common method
+TrainingReferencesWithDropout BoxDropoutDomain::filterAndJoin(const TrainingReferencesWithDropout &training_set_abstraction, const PredicateAbstraction &predicate_abstraction, bool positive_flag) const {
+    // We only use filter in the abstract (box) case
+    if(predicate_abstraction.size() > 1 && !training_set_domain->isBottomElement(training_set_abstraction)) {
+        TrainingReferencesWithDropout ret;
+        if(sweepFilterAndJoin(training_set_abstraction, predicate_abstraction, positive_flag, ret)) {
+            return ret;
+        }
+        // Every filtered set is bottom, and the join is the last of them
+        return memoizedFilter(memo, training_set_abstraction, predicate_abstraction.back(), positive_flag);
+    }
     std::vector<TrainingReferencesWithDropout> joins;
     for(auto i = predicate_abstraction.cbegin(); i != predicate_abstraction.cend(); i++) {
-        // The grammar should enforce that each i->has_value()
-        TrainingReferencesWithDropout temp = training_set_abstraction.filter(i->value(), false);
+        TrainingReferencesWithDropout temp = memoizedFilter(memo, training_set_abstraction, *i, positive_flag);
         joins.push_back(temp);
     }
     return training_set_domain->join(joins);
@@ -0,0 +1,50 @@
+#include "ConcreteDecisionTree.h"
+#include "CategoricalDistribution.hpp"
+#include "ConcreteTrainingReferences.h"
+#include "DataReferences.h"
+#include "Feature.hpp"
+#include "Predicate.hpp"
+#include <optional>
+#include <vector>
+using namespace std;
+
+ConcreteDecisionTree::ConcreteDecisionTree(const DataSet *training_set, int depth) {
+    grow(ConcreteTrainingReferences(training_set), depth);
+}
+
+ConcreteDecisionTree::ConcreteDecisionTree(const DataReferences &training_references, int depth) {
+    grow(ConcreteTrainingReferences(&training_references), depth);
+}
+
+// Mirrors buildTree's unit: if impurity(T) = 0 then summary, else phi <- bestsplit(T) and summary if phi is bot,
+// except that both filters (and their subtrees) are kept rather than the one a test input picks
+unsigned int ConcreteDecisionTree::grow(ConcreteTrainingReferences training_references, int depth) {
+    unsigned int index = nodes.size();
+    nodes.emplace_back();
+    optional<Predicate> phi = {};
+    if(depth > 0 && !training_references.isPure()) {
+        phi = training_references.bestSplit();
+    }
+    if(!phi.has_value()) {
+        nodes[index].posterior = training_references.summary();
+        return index;
+    }
+    ConcreteTrainingReferences satisfying = training_references;
+    satisfying.filter(phi.value(), true);
+    training_references.filter(phi.value(), false);
+    // nodes may be reallocated while growing the children, so index it afresh afterwards
+    unsigned int satisfied = grow(satisfying, depth - 1);
+    unsigned int unsatisfied = grow(training_references, depth - 1);
+    nodes[index].phi = phi;
+    nodes[index].satisfied = satisfied;
+    nodes[index].unsatisfied = unsatisfied;
+    return index;
+}
+
+const CategoricalDistribution<double>& ConcreteDecisionTree::classify(const FeatureVector &x) const {
+    const Node *node = &nodes[0];
+    while(node->phi.has_value()) {
+        node = &nodes[node->phi.value().evaluate(x) ? node->satisfied : node->unsatisfied];
+    }
+    return node->posterior;
+}
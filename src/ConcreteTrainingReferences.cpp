@@ -4,6 +4,7 @@
 #include "Feature.hpp"
 #include "information_math.h"
 #include "Predicate.hpp"
+#include "SplitCounts.h"
 #include <algorithm> // for std::all_of, std::sort, ...
 #include <list>
 #include <optional>
@@ -21,79 +22,120 @@ inline bool emptyCount(const vector<int> &counts) {
     return all_of(counts.cbegin(), counts.cend(), [](int i){return i == 0;});
 }
 
+// Scores a threshold between each pair of distinct adjacent values of value_class_pairs (which is sorted).
+// Counts is std::vector<int> or, when the number of categories is known at compile time, CategoryCounts<K>,
+// so the jointImpurity in the loop doesn't allocate; both start out holding the counts of the whole set.
+// A Predicate is only built for a threshold that improves on the best so far
+template <typename Search, typename Counts>
+static void scoreThresholds(Search &search, int feature_index, const vector<pair<float,int>> &value_class_pairs, const Counts &all_counts) {
+    Counts smaller = all_counts, larger = all_counts;
+    fill(smaller.begin(), smaller.end(), 0);
+    for(auto i = value_class_pairs.begin(); i + 1 != value_class_pairs.end(); i++) {
+        // We will consider a threshold between i and i+1.
+        // Here, i is crossing to the smaller side of the treshold
+        // and we make an update to the count of classes accordingly.
+        smaller[i->second]++;
+        larger[i->second]--;
+        // Next, if i and i+1 have distinct float values, we'll consider a predicate here
+        if(i->first == (i+1)->first) {
+            continue;
+        }
+        double score = jointImpurity(smaller, larger);
+        if(search.improvedBy(score)) {
+            float threshold = (i->first + (i+1)->first) / 2;
+            search.update(Predicate(feature_index, threshold), score);
+            if(search.done()) {
+                return;
+            }
+        }
+    }
+}
+
+template <size_t K>
+static CategoryCounts<K> toFixedCounts(const vector<int> &counts) {
+    CategoryCounts<K> ret;
+    copy(counts.cbegin(), counts.cend(), ret.begin());
+    return ret;
+}
+
 
 /**
  * Private member functions
  */
 
 vector<int> ConcreteTrainingReferences::sampleCounts() const {
-    vector<int> ret(training_references.getNumCategories(), 0);
-    for(unsigned int i = 0; i < training_references.size(); i++) {
-        ret[training_references[i].y] += 1;
-    }
-    return ret;
+    return training_references.labelCounts();
 }
 
 pair<vector<int>, vector<int>> ConcreteTrainingReferences::splitCounts(const Predicate &phi) const {
-    pair<vector<int>, vector<int>> ret(vector<int>(training_references.getNumCategories(), 0),
-                                       vector<int>(training_references.getNumCategories(), 0));
-    vector<int> *samples_ptr;
-    for(unsigned int i = 0; i < training_references.size(); i++) {
-        // Convention here is that satisfying the predicate corresponds to the second pair element
-        samples_ptr = phi.evaluate(training_references[i].x) ? &(ret.second) : &(ret.first);
-        (*samples_ptr)[training_references[i].y] += 1;
+    // Convention here is that satisfying the predicate corresponds to the second pair element
+    SplitCounts split;
+    switch(phi.get_feature_type()) {
+        // XXX need to make changes here if adding new feature types
+        case FeatureType::BOOLEAN:
+            split = countBooleanSplit(training_references, phi.get_feature_index());
+            break;
+        case FeatureType::NUMERIC:
+            split = countThresholdSplit(training_references, phi.get_feature_index(), phi.get_threshold(), phi.get_threshold());
+            break;
     }
-    return ret;
+    return make_pair(split.unsatisfied, split.satisfied);
 }
 
-void ConcreteTrainingReferences::computePredicatesAndScores(list<pair<Predicate, double>> &store, int feature_index) const {
+void ConcreteTrainingReferences::computePredicatesAndScores(SplitSearch &search, int feature_index) const {
     switch(training_references.getFeatureTypes()[feature_index]) {
         // XXX need to make changes here if adding new feature types
         case FeatureType::BOOLEAN:
-            computeBooleanFeaturePredicateAndScore(store, feature_index);
+            computeBooleanFeaturePredicateAndScore(search, feature_index);
             break;
         case FeatureType::NUMERIC:
-            computeNumericFeaturePredicatesAndScores(store, feature_index);
+            computeNumericFeaturePredicatesAndScores(search, feature_index);
             break;
     }
 }
 
-void ConcreteTrainingReferences::computeBooleanFeaturePredicateAndScore(list<pair<Predicate, double>> &store, int feature_index) const {
+void ConcreteTrainingReferences::computeBooleanFeaturePredicateAndScore(SplitSearch &search, int feature_index) const {
     Predicate phi(feature_index);
     auto counts = splitCounts(phi);
     if(!emptyCount(counts.first) && !emptyCount(counts.second)) {
-        store.push_back(make_pair(phi, jointImpurity(counts.first, counts.second)));
+        double score = jointImpurity(counts.first, counts.second);
+        if(search.improvedBy(score)) {
+            search.update(phi, score);
+        }
     }
 }
 
-void ConcreteTrainingReferences::computeNumericFeaturePredicatesAndScores(list<pair<Predicate, double>> &store, int feature_index) const {
+void ConcreteTrainingReferences::computeNumericFeaturePredicatesAndScores(SplitSearch &search, int feature_index) const {
     vector<pair<float,int>> value_class_pairs(training_references.size());
+    const DataColumns &columns = training_references.getColumns();
+    const float *values = columns.numericColumn(feature_index);
+    const int *labels = columns.labelColumn();
+    // Visiting the rows presorted by this feature leaves value_class_pairs in increasing order
+    RowSpan sorted_rows = training_references.sortedRows(feature_index);
     for(unsigned int j = 0; j < training_references.size(); j++) {
-        value_class_pairs[j].first = training_references[j].x[feature_index].getNumericValue();
-        value_class_pairs[j].second = training_references[j].y;
+        int row = sorted_rows[j];
+        value_class_pairs[j].first = values[row];
+        value_class_pairs[j].second = labels[row];
     }
     if(value_class_pairs.size() < 2) {
         // We do this check so we can safely do a pairwise iteration later
         return;
     }
-    std::sort(value_class_pairs.begin(), value_class_pairs.end(),
-              [](const pair<float,int> &p1, const pair<float,int> &p2)
-              { return p1.first < p2.first; } );
-    // value_class_pairs is now in increasing order (with possible multiplicity)
-    pair<vector<int>, vector<int>> split_counts = make_pair(vector<int>(training_references.getNumCategories(), 0), sampleCounts());
-    for(auto i = value_class_pairs.begin(); i + 1 != value_class_pairs.end(); i++) {
-        // We will consider a threshold between i and i+1.
-        // Here, i is crossing to the smaller side of the treshold (split_counts.first)
-        // and we make an update to the count of classes accordingly.
-        split_counts.first[i->second]++;
-        split_counts.second[i->second]--;
-        // Next, if i and i+1 have distinct float values, we'll consider a predicate here
-        if(i->first == (i+1)->first) {
-            continue;
-        }
-        float threshold = (i->first + (i+1)->first) / 2;
-        Predicate phi(feature_index, threshold);
-        store.push_back(make_pair(phi, jointImpurity(split_counts.first, split_counts.second)));
+    // value_class_pairs is in increasing order (with possible multiplicity)
+    vector<int> counts = sampleCounts();
+    switch(training_references.getNumCategories()) {
+        case 2:
+            scoreThresholds(search, feature_index, value_class_pairs, toFixedCounts<2>(counts));
+            break;
+        case 3:
+            scoreThresholds(search, feature_index, value_class_pairs, toFixedCounts<3>(counts));
+            break;
+        case 4:
+            scoreThresholds(search, feature_index, value_class_pairs, toFixedCounts<4>(counts));
+            break;
+        default:
+            scoreThresholds(search, feature_index, value_class_pairs, counts);
+            break;
     }
 }
 
@@ -103,9 +145,9 @@ void ConcreteTrainingReferences::computeNumericFeaturePredicatesAndScores(list<p
 
 bool ConcreteTrainingReferences::isPure() const {
     // XXX What if training set is empty?
-    int category = training_references[0].y;
+    int category = training_references.getLabel(0);
     for(unsigned int i = 1; i < training_references.size(); i++) {
-        if(category != training_references[i].y) {
+        if(category != training_references.getLabel(i)) {
             return false;
         }
     }
@@ -113,16 +155,23 @@ bool ConcreteTrainingReferences::isPure() const {
 };
 
 void ConcreteTrainingReferences::filter(const Predicate &phi, bool mode) {
-    bool remove, result;
-    // TODO this iterative removal is potentially inefficient; consider a linked list?
-    for(unsigned int i = 0; i < training_references.size(); i++) {
-        result = phi.evaluate(training_references[i].x);
-        remove = (mode != result);
-        if(remove) {
-            training_references.remove(i);
-            i--;
-        }
+    const DataColumns &columns = training_references.getColumns();
+    vector<bool> keep(training_references.size());
+    // Switching on the type once, rather than per row
+    switch(phi.get_feature_type()) {
+        // XXX need to make changes here if adding new feature types
+        case FeatureType::BOOLEAN:
+            for(unsigned int i = 0; i < training_references.size(); i++) {
+                keep[i] = (mode == phi.evaluateBoolean(columns, training_references.getIndex(i)));
+            }
+            break;
+        case FeatureType::NUMERIC:
+            for(unsigned int i = 0; i < training_references.size(); i++) {
+                keep[i] = (mode == phi.evaluateNumeric(columns, training_references.getIndex(i)));
+            }
+            break;
     }
+    training_references.filter(keep);
 }
 
 CategoricalDistribution<double> ConcreteTrainingReferences::summary() const {
@@ -131,21 +180,11 @@ CategoricalDistribution<double> ConcreteTrainingReferences::summary() const {
 }
 
 optional<Predicate> ConcreteTrainingReferences::bestSplit() const {
-    double best_score;
-    optional<Predicate> best_predicate = {};
-    // For each feature index, we'll have a list of the scores for each gathered predicate
-    vector<list<pair<Predicate, double>>> feature_scores(training_references.getFeatureTypes().size());
-    for(int i = 0; i < training_references.getFeatureTypes().size(); i++) {
-        computePredicatesAndScores(feature_scores[i], i); // Only populates with non-trivial splits
-    }
-
-    for(auto i = feature_scores.cbegin(); i != feature_scores.cend(); i++) {
-        for(auto j = i->cbegin(); j != i->cend(); j++) {
-            if(!best_predicate.has_value() || j->second < best_score) { // Minimize joint Impurity
-                best_score = j->second;
-                best_predicate = j->first;
-            }
-        }
+    // One pass over the features, scoring each predicate as it's gathered (only non-trivial splits are scored),
+    // and stopping early once no later one could win
+    SplitSearch search;
+    for(int i = 0; i < training_references.getFeatureTypes().size() && !search.done(); i++) {
+        computePredicatesAndScores(search, i);
     }
-    return best_predicate;
+    return search.best_predicate;
 }
@@ -0,0 +1,138 @@
+#include "DataColumns.h"
+#include "Feature.hpp"
+#include <algorithm> // for std::min, std::stable_sort
+#include <cstddef> // for NULL
+#include <cstdint>
+#include <numeric> // for std::iota
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+DataColumns::DataColumns(const FeatureVectorHeader &feature_types, unsigned int num_rows) {
+    this->feature_types = feature_types;
+    this->num_rows = num_rows;
+    numeric_columns = std::vector<std::vector<float>>(feature_types.size());
+    numeric_data = std::vector<const float*>(feature_types.size(), NULL);
+    boolean_rows = std::vector<RowBitset>(feature_types.size());
+    for(unsigned int i = 0; i < feature_types.size(); i++) {
+        switch(feature_types[i]) {
+            // XXX need to make changes here if adding new feature types
+            case FeatureType::BOOLEAN:
+                boolean_rows[i] = RowBitset(num_rows);
+                break;
+            case FeatureType::NUMERIC:
+                numeric_columns[i] = std::vector<float>(num_rows, 0);
+                numeric_data[i] = numeric_columns[i].data();
+                break;
+        }
+    }
+    labels = std::vector<int>(num_rows, 0);
+    label_data = labels.data();
+    sorted_rows = std::vector<std::vector<int>>(feature_types.size());
+    sorted_data = std::vector<RowSpan>(feature_types.size());
+}
+
+DataColumns::DataColumns(const FeatureVectorHeader &feature_types, unsigned int num_rows, std::shared_ptr<const void> mapping) {
+    this->feature_types = feature_types;
+    this->num_rows = num_rows;
+    this->mapping = mapping;
+    numeric_columns = std::vector<std::vector<float>>(feature_types.size());
+    numeric_data = std::vector<const float*>(feature_types.size(), NULL);
+    boolean_rows = std::vector<RowBitset>(feature_types.size());
+    for(unsigned int i = 0; i < feature_types.size(); i++) {
+        if(feature_types[i] == FeatureType::BOOLEAN) {
+            boolean_rows[i] = RowBitset(num_rows);
+        }
+    }
+    label_data = NULL;
+    sorted_rows = std::vector<std::vector<int>>(feature_types.size());
+    sorted_data = std::vector<RowSpan>(feature_types.size());
+}
+
+void DataColumns::setRow(unsigned int row, const FeatureVector &x, int y) {
+    unsigned int num_features = std::min(x.size(), feature_types.size());
+    for(unsigned int i = 0; i < num_features; i++) {
+        // The header decides the column type; a cell of the other type is converted
+        switch(feature_types[i]) {
+            case FeatureType::BOOLEAN:
+                boolean_rows[i].assign(row, x[i].getType() == FeatureType::BOOLEAN ? x[i].getBooleanValue() : x[i].getNumericValue() != 0);
+                break;
+            case FeatureType::NUMERIC:
+                numeric_columns[i][row] = (x[i].getType() == FeatureType::NUMERIC ? x[i].getNumericValue() : (float)x[i].getBooleanValue());
+                break;
+        }
+    }
+    labels[row] = y;
+}
+
+void DataColumns::setNumericColumn(unsigned int feature_index, const float *values, const int *sorted) {
+    numeric_columns[feature_index].assign(values, values + num_rows);
+    numeric_data[feature_index] = numeric_columns[feature_index].data();
+    if(sorted != NULL) {
+        sorted_rows[feature_index].assign(sorted, sorted + num_rows);
+    }
+}
+
+void DataColumns::setBooleanColumn(unsigned int feature_index, const uint64_t *words) {
+    boolean_rows[feature_index] = RowBitset::fromWords(words, num_rows);
+}
+
+void DataColumns::setLabels(const int *labels) {
+    this->labels.assign(labels, labels + num_rows);
+    label_data = this->labels.data();
+}
+
+void DataColumns::viewNumericColumn(unsigned int feature_index, const float *values, const int *sorted) {
+    numeric_data[feature_index] = values;
+    sorted_data[feature_index] = RowSpan(sorted, num_rows);
+}
+
+void DataColumns::viewLabels(const int *labels) {
+    label_data = labels;
+}
+
+void DataColumns::finalize() {
+    for(unsigned int i = 0; i < feature_types.size(); i++) {
+        if(feature_types[i] != FeatureType::NUMERIC || sorted_data[i].size() == num_rows) {
+            continue; // Not numeric, or viewed in place
+        }
+        if(sorted_rows[i].size() != num_rows) { // Not given by setNumericColumn either
+            const float *values = numeric_data[i];
+            sorted_rows[i] = std::vector<int>(num_rows);
+            std::iota(sorted_rows[i].begin(), sorted_rows[i].end(), 0);
+            std::stable_sort(sorted_rows[i].begin(), sorted_rows[i].end(),
+                             [values](int r1, int r2) { return values[r1] < values[r2]; });
+        }
+        sorted_data[i] = RowSpan(sorted_rows[i]);
+    }
+
+    label_rows.clear();
+    for(unsigned int row = 0; row < num_rows; row++) {
+        if(label_data[row] < 0) { // XXX not expected, but don't index with it
+            continue;
+        }
+        while(label_rows.size() <= (unsigned int)label_data[row]) {
+            label_rows.push_back(RowBitset(num_rows));
+        }
+        label_rows[label_data[row]].set(row);
+    }
+}
+
+// madvise wants a page-aligned start, so this widens the range down to one
+static void adviseWillNeed(const void *begin, std::size_t length) {
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t)begin & ~(page_size - 1);
+    madvise((void *)first, (uintptr_t)begin + length - first, MADV_WILLNEED);
+}
+
+void DataColumns::willNeed(unsigned int feature_index, unsigned int first_row, unsigned int last_row) const {
+    last_row = std::min(last_row, num_rows);
+    // A wide range means a sparse scan, which would only touch some of its pages; those are left to fault in
+    if(mapping == NULL || first_row >= last_row || last_row - first_row > 4 * CHUNK_ROWS) {
+        return;
+    }
+    if(numeric_data[feature_index] != NULL) { // Boolean columns are never mapped
+        adviseWillNeed(numeric_data[feature_index] + first_row, (last_row - first_row) * sizeof(float));
+    }
+    adviseWillNeed(label_data + first_row, (last_row - first_row) * sizeof(int));
+}
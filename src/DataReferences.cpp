@@ -1,44 +1,177 @@
 #include "DataReferences.h"
-#include <algorithm> // for std::min_element
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+/**
+ * Per-feature sorted orders for one particular set of indices
+ * (every DataReferences sharing a cache has the same indices; changing them means a new cache).
+ * Every element of ours is also an element of parent's (or, for a NULL parent, of the whole data set),
+ * so any order that an ancestor has built can be filtered down to ours without sorting.
+ */
+struct DataReferences::SortedRowsCache {
+    std::shared_ptr<const SortedRowsCache> parent;
+    mutable std::mutex mutex;
+    mutable std::vector<std::unique_ptr<std::vector<int>>> orders; // Indexed by feature; NULL until built
+    mutable bool any_built;
+
+    SortedRowsCache(const std::shared_ptr<const SortedRowsCache> &parent, unsigned int num_features)
+        : parent(parent), orders(num_features), any_built(false) {}
+
+    const std::vector<int>* lookup(unsigned int feature_index) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return orders[feature_index].get();
+    }
+
+    bool anyBuilt() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return any_built;
+    }
+};
+
+const std::shared_ptr<const DataReferences::Rows>& DataReferences::emptyRows() {
+    static const std::shared_ptr<const Rows> empty = std::make_shared<const Rows>();
+    return empty;
+}
+
 DataReferences::DataReferences(const DataSet *data_set) {
     this->data_set = data_set;
-    indices.reserve(data_set->rows.size());
-    for(unsigned int i = 0; i < data_set->rows.size(); i++) {
-        indices.push_back(i);
+    this->columns = &data_set->columns();
+    std::shared_ptr<Rows> all = std::make_shared<Rows>();
+    all->indices.reserve(columns->size());
+    all->members = RowBitset(columns->size());
+    for(unsigned int i = 0; i < columns->size(); i++) {
+        all->indices.push_back(i);
+        all->members.set(i);
     }
+    rows = all;
+    sorted_rows = NULL;
 }
 
 DataReferences::DataReferences(const DataSet *data_set, const std::vector<int> &indices) {
     this->data_set = data_set;
-    this->indices = indices;
+    this->columns = &data_set->columns();
+    std::shared_ptr<Rows> given = std::make_shared<Rows>();
+    given->indices = indices;
+    given->members = RowBitset(columns->size());
+    for(auto i = indices.cbegin(); i != indices.cend(); i++) {
+        given->members.set(*i);
+    }
+    rows = given;
+    sorted_rows = NULL;
+    if(indices.size() != columns->size()) {
+        sorted_rows = std::make_shared<SortedRowsCache>(nullptr, data_set->feature_types.size());
+    }
+}
+
+DataReferences::DataReferences(const DataSet *data_set, const RowBitset &members) {
+    this->data_set = data_set;
+    this->columns = &data_set->columns();
+    std::shared_ptr<Rows> given = std::make_shared<Rows>();
+    given->members = members;
+    members.appendRows(given->indices);
+    rows = given;
+    sorted_rows = NULL;
+    if(rows->indices.size() != columns->size()) {
+        sorted_rows = std::make_shared<SortedRowsCache>(nullptr, data_set->feature_types.size());
+    }
 }
 
-DataReferences DataReferences::set_union(const DataReferences &e1, const DataReferences &e2) {
-    // XXX strong assumption that e1.data_set == e2.data_set
-    // and the invariant that DataReferences::indices are sorted
-    std::vector<int>::const_iterator i1, i2;
-    std::vector<int> ret_indices;
-
-    i1 = e1.indices.begin();
-    i2 = e2.indices.begin();
-    while(i1 != e1.indices.end() || i2 != e2.indices.end()) {
-        std::vector<int> candidates;
-        if(i1 != e1.indices.end()) {
-            candidates.push_back(*i1);
+void DataReferences::deriveSortedRows() {
+    std::shared_ptr<const SortedRowsCache> parent = sorted_rows;
+    // A cache with nothing built has nothing to offer beyond its own parent
+    if(parent != NULL && !parent->anyBuilt()) {
+        parent = parent->parent;
+    }
+    sorted_rows = std::make_shared<SortedRowsCache>(parent, data_set->feature_types.size());
+}
+
+void DataReferences::remove(int index) {
+    std::shared_ptr<Rows> changed = std::make_shared<Rows>(*rows);
+    changed->members.reset(changed->indices[index]);
+    changed->indices.erase(changed->indices.begin() + index);
+    rows = changed;
+    deriveSortedRows();
+}
+
+void DataReferences::filter(const std::vector<bool> &keep) {
+    const std::vector<int> &indices = rows->indices;
+    unsigned int kept = std::count(keep.cbegin(), keep.cbegin() + indices.size(), true);
+    if(kept == indices.size()) {
+        return;
+    }
+    std::shared_ptr<Rows> changed = std::make_shared<Rows>();
+    changed->indices.reserve(kept);
+    changed->members = rows->members;
+    for(unsigned int i = 0; i < indices.size(); i++) {
+        if(keep[i]) {
+            changed->indices.push_back(indices[i]);
+        } else {
+            changed->members.reset(indices[i]);
         }
-        if(i2 != e2.indices.end()) {
-            candidates.push_back(*i2);
+    }
+    rows = changed;
+    deriveSortedRows();
+}
+
+std::vector<int> DataReferences::labelCounts() const {
+    std::vector<int> counts(data_set->num_categories, 0);
+    const std::vector<int> &indices = rows->indices;
+    const RowBitset &members = rows->members;
+    const std::vector<RowBitset> &label_rows = columns->labelRows();
+    if(indices.size() >= members.numWords() * label_rows.size()) {
+        // Cheaper to intersect with each label's rows a word at a time
+        for(unsigned int i = 0; i < counts.size() && i < label_rows.size(); i++) {
+            counts[i] = members.countIntersection(label_rows[i]);
         }
-        int current = *std::min_element(candidates.begin(), candidates.end());
-        ret_indices.push_back(current);
-        if(i1 != e1.indices.end() && *i1 == current) {
-            i1++;
+        return counts;
+    }
+    const int *labels = columns->labelColumn();
+    for(auto i = indices.cbegin(); i != indices.cend(); i++) {
+        counts[labels[*i]]++;
+    }
+    return counts;
+}
+
+RowSpan DataReferences::sortedRows(unsigned int feature_index) const {
+    if(sorted_rows == NULL) {
+        return columns->sortedRows(feature_index);
+    }
+    const SortedRowsCache &cache = *sorted_rows;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if(cache.orders[feature_index] == NULL) {
+        // Start from the nearest ancestor that already has this order
+        const std::vector<int> *ancestor = NULL;
+        for(const SortedRowsCache *p = cache.parent.get(); p != NULL && ancestor == NULL; p = p->parent.get()) {
+            ancestor = p->lookup(feature_index);
         }
-        if(i2 != e2.indices.end() && *i2 == current) {
-            i2++;
+        RowSpan source = (ancestor != NULL ? RowSpan(*ancestor) : columns->sortedRows(feature_index));
+        // A stable filter keeps the order (and the tie-breaking by row)
+        std::unique_ptr<std::vector<int>> order(new std::vector<int>());
+        order->reserve(rows->indices.size());
+        for(auto i = source.begin(); i != source.end(); i++) {
+            if(rows->members.test(*i)) {
+                order->push_back(*i);
+            }
         }
+        cache.orders[feature_index] = std::move(order);
+        cache.any_built = true;
     }
-    return DataReferences(e1.data_set, ret_indices);
+    return RowSpan(*cache.orders[feature_index]);
+}
+
+DataReferences DataReferences::set_union(const DataReferences &e1, const DataReferences &e2) {
+    // XXX strong assumption that e1.data_set == e2.data_set
+    return DataReferences(e1.data_set, RowBitset::set_union(e1.rows->members, e2.rows->members));
+}
+
+DataReferences DataReferences::set_intersection(const DataReferences &e1, const DataReferences &e2) {
+    // XXX strong assumption that e1.data_set == e2.data_set
+    return DataReferences(e1.data_set, RowBitset::set_intersection(e1.rows->members, e2.rows->members));
+}
+
+unsigned int DataReferences::union_size(const DataReferences &e1, const DataReferences &e2) {
+    return e1.size() + e2.size() - e1.rows->members.countIntersection(e2.rows->members);
 }
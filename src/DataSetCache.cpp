@@ -0,0 +1,356 @@
+#include "DataSetCache.h"
+#include "DataColumns.h"
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include <cstdint>
+#include <cstdio> // for std::rename, std::remove
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static const char MAGIC[8] = {'D', 'S', 'C', 'A', 'C', 'H', 'E', '\0'};
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const uint8_t NUMERIC_TAG = 0;
+static const uint8_t BOOLEAN_TAG = 1;
+
+/**
+ * Source file stamps
+ */
+
+struct SourceStamp {
+    uint64_t size;
+    int64_t mtime_ns;
+};
+
+static bool stampSources(const std::vector<std::string> &sources, std::vector<SourceStamp> &stamps) {
+    stamps.clear();
+    for(auto i = sources.cbegin(); i != sources.cend(); i++) {
+        struct stat info;
+        if(stat(i->c_str(), &info) != 0) {
+            return false;
+        }
+        stamps.push_back({ (uint64_t)info.st_size, (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec });
+    }
+    return true;
+}
+
+/**
+ * Writing
+ */
+
+class SnapshotWriter {
+private:
+    std::ofstream out;
+    uint64_t offset = 0;
+
+public:
+    SnapshotWriter(const std::string &path) : out(path, std::ios::binary | std::ios::trunc) {}
+    bool good() const { return out.good(); }
+    // Flushes what is still buffered: only then is a failed write (say, a full disk) known
+    bool close() {
+        out.close();
+        return !out.fail();
+    }
+
+    void bytes(const void *data, size_t length) {
+        out.write((const char *)data, length);
+        offset += length;
+    }
+    template <typename T>
+    void value(const T &v) { bytes(&v, sizeof(T)); }
+    void string(const std::string &s) {
+        value((uint64_t)s.size());
+        bytes(s.data(), s.size());
+        pad();
+    }
+    // Arrays start (and so the next field starts) at a multiple of 8 from the start of the file
+    void pad() {
+        static const char zeros[8] = {0};
+        bytes(zeros, (8 - offset % 8) % 8);
+    }
+    template <typename T>
+    void array(const T *data, size_t length) {
+        bytes(data, length * sizeof(T));
+        pad();
+    }
+};
+
+static void writeDataSet(SnapshotWriter &writer, const DataSet &data_set) {
+    const DataColumns &columns = data_set.columns();
+    uint64_t num_rows = columns.size(); // A column-only data set has no rows
+    writer.value((uint64_t)data_set.feature_types.size());
+    writer.value(num_rows);
+    writer.value((int64_t)data_set.num_categories);
+    std::vector<uint8_t> tags;
+    for(auto i = data_set.feature_types.cbegin(); i != data_set.feature_types.cend(); i++) {
+        // XXX need to make changes here if adding new feature types
+        tags.push_back(*i == FeatureType::BOOLEAN ? BOOLEAN_TAG : NUMERIC_TAG);
+    }
+    writer.array(tags.data(), tags.size());
+    writer.array(columns.labelColumn(), num_rows);
+    for(unsigned int i = 0; i < data_set.feature_types.size(); i++) {
+        if(tags[i] == BOOLEAN_TAG) {
+            writer.array(columns.booleanRows(i).data(), columns.booleanRows(i).numWords());
+        } else {
+            writer.array(columns.numericColumn(i), num_rows);
+            writer.array(columns.sortedRows(i).data(), num_rows);
+        }
+    }
+}
+
+bool DataSetCache::save(const std::string &path, const std::string &key, const std::vector<std::string> &sources, const ExperimentData &data) {
+    std::vector<SourceStamp> stamps;
+    if(!stampSources(sources, stamps)) {
+        return false;
+    }
+    std::string temp_path = path + ".tmp" + std::to_string(getpid());
+    {
+        SnapshotWriter writer(temp_path);
+        if(!writer.good()) {
+            return false;
+        }
+        writer.bytes(MAGIC, sizeof(MAGIC));
+        writer.value(VERSION);
+        writer.value(BYTE_ORDER_MARK);
+        writer.string(key);
+        writer.value((uint64_t)stamps.size());
+        for(auto i = stamps.cbegin(); i != stamps.cend(); i++) {
+            writer.value(i->size);
+            writer.value(i->mtime_ns);
+        }
+        writer.value((uint64_t)data.class_labels.size());
+        for(auto i = data.class_labels.cbegin(); i != data.class_labels.cend(); i++) {
+            writer.string(*i);
+        }
+        writeDataSet(writer, *data.training);
+        writeDataSet(writer, *data.test);
+        if(!writer.close()) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if(std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reading
+ */
+
+// Reads fields out of the mapped file in the order SnapshotWriter wrote them;
+// every read checks bounds, and a failed read leaves the reader failed (so callers check once at the end)
+class SnapshotReader {
+private:
+    const char *begin, *current, *end;
+    bool failed = false;
+
+public:
+    SnapshotReader(const char *data, size_t length) : begin(data), current(data), end(data + length) {}
+    bool ok() const { return !failed; }
+
+    const void* bytes(size_t length) {
+        if(failed || (size_t)(end - current) < length) {
+            failed = true;
+            return NULL;
+        }
+        const char *ret = current;
+        current += length;
+        return ret;
+    }
+    template <typename T>
+    T value() {
+        const void *data = bytes(sizeof(T));
+        T ret = T();
+        if(data != NULL) {
+            std::memcpy(&ret, data, sizeof(T));
+        }
+        return ret;
+    }
+    std::string string() {
+        uint64_t length = value<uint64_t>();
+        const char *data = (const char *)bytes(length);
+        pad();
+        return (data == NULL ? std::string() : std::string(data, length));
+    }
+    void pad() {
+        bytes((8 - (current - begin) % 8) % 8);
+    }
+    template <typename T>
+    const T* array(size_t length) {
+        if(length > (size_t)(end - current) / sizeof(T)) {
+            failed = true;
+            return NULL;
+        }
+        const T *ret = (const T *)bytes(length * sizeof(T));
+        pad();
+        return ret;
+    }
+};
+
+// Whether sorted is the order DataColumns::finalize would have built:
+// strictly increasing by (value, row) and in range, which also makes it a permutation of the rows
+static bool checkSortedRows(const float *values, const int *sorted, uint64_t num_rows) {
+    for(uint64_t i = 0; i < num_rows; i++) {
+        if(sorted[i] < 0 || (uint64_t)sorted[i] >= num_rows) {
+            return false;
+        }
+        if(i > 0) {
+            float previous = values[sorted[i - 1]], current = values[sorted[i]];
+            if(!(previous < current || (previous == current && sorted[i - 1] < sorted[i]))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// With a mapping, the columns are viewed in place, otherwise they are copied out;
+// the rows are only rebuilt with_rows (for test sets: training code reads only columns)
+static DataSet* readDataSet(SnapshotReader &reader, const std::shared_ptr<const void> &mapping, bool with_rows) {
+    uint64_t num_features = reader.value<uint64_t>();
+    uint64_t num_rows = reader.value<uint64_t>();
+    int64_t num_categories = reader.value<int64_t>();
+    const uint8_t *tags = reader.array<uint8_t>(num_features);
+    const int *labels = reader.array<int>(num_rows);
+    if(!reader.ok() || num_categories <= 0 || num_categories > std::numeric_limits<int>::max()) {
+        return NULL;
+    }
+    // Training code indexes label counts by these, so one out of range mustn't get past here
+    for(uint64_t row = 0; row < num_rows; row++) {
+        if(labels[row] < 0 || labels[row] >= num_categories) {
+            return NULL;
+        }
+    }
+
+    FeatureVectorHeader header(num_features);
+    for(uint64_t i = 0; i < num_features; i++) {
+        if(tags[i] != NUMERIC_TAG && tags[i] != BOOLEAN_TAG) {
+            return NULL;
+        }
+        header[i] = (tags[i] == BOOLEAN_TAG ? FeatureType::BOOLEAN : FeatureType::NUMERIC);
+    }
+    DataColumns *columns = (mapping != NULL ? new DataColumns(header, num_rows, mapping) : new DataColumns(header, num_rows));
+    if(mapping != NULL) {
+        columns->viewLabels(labels);
+    } else {
+        columns->setLabels(labels);
+    }
+    for(uint64_t i = 0; i < num_features; i++) {
+        if(header[i] == FeatureType::BOOLEAN) {
+            const uint64_t *words = reader.array<uint64_t>((num_rows + 63) / 64);
+            if(words != NULL) {
+                columns->setBooleanColumn(i, words); // Copied even when mapping: it is a bit per row
+            }
+        } else {
+            const float *values = reader.array<float>(num_rows);
+            const int *sorted = reader.array<int>(num_rows);
+            if(values == NULL || sorted == NULL || !checkSortedRows(values, sorted, num_rows)) {
+                delete columns;
+                return NULL;
+            }
+            if(mapping != NULL) {
+                columns->viewNumericColumn(i, values, sorted);
+            } else {
+                columns->setNumericColumn(i, values, sorted);
+            }
+        }
+    }
+    if(!reader.ok()) {
+        delete columns;
+        return NULL;
+    }
+    columns->finalize();
+
+    DataSet *ret = new DataSet { header, (int)num_categories, std::vector<DataRow>() };
+    if(with_rows) {
+        // The rest of the code base reads test rows, so they are rebuilt from the columns
+        ret->rows = std::vector<DataRow>(num_rows);
+        for(uint64_t row = 0; row < num_rows; row++) {
+            FeatureVector &x = ret->rows[row].x;
+            x = FeatureVector(num_features);
+            for(uint64_t i = 0; i < num_features; i++) {
+                if(header[i] == FeatureType::BOOLEAN) {
+                    x[i] = columns->getBooleanValue(row, i);
+                } else {
+                    x[i] = columns->getNumericValue(row, i);
+                }
+            }
+            ret->rows[row].y = columns->getLabel(row);
+        }
+    }
+    ret->column_cache.get([columns]() { return columns; });
+    return ret;
+}
+
+static ExperimentData* readSnapshot(SnapshotReader &reader, const std::string &key, const std::vector<SourceStamp> &stamps, const std::shared_ptr<const void> &training_mapping) {
+    const char *magic = (const char *)reader.bytes(sizeof(MAGIC));
+    if(magic == NULL || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       reader.value<uint32_t>() != DataSetCache::VERSION || reader.value<uint32_t>() != BYTE_ORDER_MARK || reader.string() != key) {
+        return NULL;
+    }
+    if(reader.value<uint64_t>() != stamps.size()) {
+        return NULL;
+    }
+    for(auto i = stamps.cbegin(); i != stamps.cend(); i++) {
+        uint64_t size = reader.value<uint64_t>();
+        int64_t mtime_ns = reader.value<int64_t>();
+        if(size != i->size || mtime_ns != i->mtime_ns) {
+            return NULL;
+        }
+    }
+    uint64_t num_labels = reader.value<uint64_t>();
+    std::vector<std::string> class_labels;
+    for(uint64_t i = 0; i < num_labels && reader.ok(); i++) {
+        class_labels.push_back(reader.string());
+    }
+    if(!reader.ok()) {
+        return NULL;
+    }
+
+    DataSet *training = readDataSet(reader, training_mapping, false);
+    if(training == NULL) {
+        return NULL;
+    }
+    DataSet *test = readDataSet(reader, nullptr, true);
+    if(test == NULL) {
+        delete training;
+        return NULL;
+    }
+    return new ExperimentData { training, test, class_labels };
+}
+
+ExperimentData* DataSetCache::load(const std::string &path, const std::string &key, const std::vector<std::string> &sources, bool map_training) {
+    std::vector<SourceStamp> stamps;
+    if(!stampSources(sources, stamps)) {
+        return NULL;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = info.st_size;
+    void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED) {
+        return NULL;
+    }
+    // Unmapped once nothing views it: right after reading, unless the training columns stay mapped
+    std::shared_ptr<const void> mapping(mapped, [length](const void *p) { munmap(const_cast<void *>(p), length); });
+    SnapshotReader reader((const char *)mapped, length);
+    return readSnapshot(reader, key, stamps, (map_training ? mapping : nullptr));
+}
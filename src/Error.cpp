@@ -1,4 +1,5 @@
 #include "Error.h"
+#include <string>
 
 Error::Error() {
     _isFatal = false; 
@@ -10,11 +11,27 @@ void Error::fatal(const std::string msg) {
     _isFatal = true;
 }
 
+void Error::fatal(int lineNum, const std::string msg) {
+    fatal("line " + std::to_string(lineNum) + ": " + msg);
+}
+
+void Error::fatal(int lineNum, int colNum, const std::string msg) {
+    fatal("line " + std::to_string(lineNum) + ", column " + std::to_string(colNum) + ": " + msg);
+}
+
 void Error::warning(const std::string msg) {
     std::cout << "Warning: " << msg << std::endl; 
     _isWarning = true;
 }
 
+void Error::warning(int lineNum, const std::string msg) {
+    warning("line " + std::to_string(lineNum) + ": " + msg);
+}
+
+void Error::warning(int lineNum, int colNum, const std::string msg) {
+    warning("line " + std::to_string(lineNum) + ", column " + std::to_string(colNum) + ": " + msg);
+}
+
 bool Error::isFatal() {
     return _isFatal; 
 }
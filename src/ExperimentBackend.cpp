@@ -1,14 +1,18 @@
 #include "ExperimentBackend.h"
 #include "AbstractSemanticsInstantiations.hpp"
-#include "AbstractSemanticsTemplate.cpp"
-#include "ASTNode.h"
-#include "ConcreteSemantics.h"
+#include "BoxDisjunctsDropoutTrace.h"
+#include "ConcreteDecisionTree.h"
 #include "DropoutDomains.hpp"
 #include "Feature.hpp"
+#include "RowBitset.hpp"
+#include "ThreadPool.h"
 #include <algorithm>
-#include <cstdlib> // for random stuff
 #include <map>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 using namespace std;
@@ -46,81 +50,179 @@ set<int> softMax(const CategoricalDistribution<Interval<double>> &p) {
     return ret;
 }
 
-unsigned int random_removal_size(int set_size, int num_dropout) {
-    // TODO make this actually consider smaller amounts
-    return num_dropout;
-}
+// Joins the posteriors of the leaves of an abstract run as they're reached (from any thread),
+// telling the run to stop once the join makes more than one class possible.
+// Joins only widen intervals, and widening only adds classes to softMax,
+// so by then the final posterior can't certify a single class either.
+class DecisionCutoff {
+    const PosteriorDistributionIntervalDomain *domain;
+    std::mutex mutex;
+    PosteriorDistributionAbstraction joined;
+
+public:
+    DecisionCutoff(const PosteriorDistributionIntervalDomain *domain) : domain(domain) {}
+
+    bool add(const PosteriorDistributionAbstraction &leaf) {
+        if(domain->isBottomElement(leaf)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        joined = domain->binary_join(joined, leaf);
+        return softMax(joined).size() > 1;
+    }
 
-DataReferences* random_subset(const DataSet *training, int num_dropout) {
-    unsigned int removal_size = random_removal_size(training->rows.size(), num_dropout);
-    set<int> indices;
-    while(indices.size() < removal_size) {
-        indices.insert(rand() % training->rows.size());
+    const PosteriorDistributionAbstraction &getJoined() const { return joined; }
+};
+
+// A uniformly random subset of the training set, without num_dropout of its rows
+// (Floyd's sampling: each removal is one draw, checked against the rows already removed)
+DataReferences random_subset(const DataSet *training, int num_dropout, mt19937 &generator) {
+    unsigned int num_rows = training->columns().size();
+    // Keep at least one row: an empty training set has no summary
+    unsigned int removal_size = min((unsigned int)max(num_dropout, 0), num_rows > 0 ? num_rows - 1 : 0);
+    RowBitset members(num_rows);
+    for(unsigned int i = 0; i < num_rows; i++) {
+        members.set(i);
     }
-    DataReferences *ret = new DataReferences(training);
-    // For each index in decreasing order, remove it
-    for(auto i = indices.crbegin(); i != indices.crend(); i++) {
-        ret->remove(*i);
+    for(unsigned int j = num_rows - removal_size; j < num_rows; j++) {
+        unsigned int row = uniform_int_distribution<unsigned int>(0, j)(generator);
+        members.reset(members.test(row) ? row : j);
     }
-    return ret;
+    return DataReferences(training, members);
 }
 
 /**
  * ExperimentBackend members
  */
 
-ExperimentBackend::ExperimentBackend(const DataSet *training, const DataSet *test) {
+ExperimentBackend::ExperimentBackend(const DataSet *training, const DataSet *test) : memo(DEFAULT_MEMO_BYTES) {
+    use_memo = true;
+    use_trace = false;
+    decision_only = false;
+    pool = NULL;
     this->training = training;
     this->test = test;
     //this->use_label_flipping = label_flipping;
 }
 
+std::shared_ptr<BoxDisjunctsDropoutTrace> ExperimentBackend::getTrace(int depth, const TrainingReferencesWithDropout &initial_training_set) {
+    const TrainingReferencesWithDropout &t = initial_training_set;
+    TraceKey key = std::make_tuple(depth, t.num_dropout, t.num_add, t.add_sens_info, t.num_labels_flip, t.label_sens_info,
+                                   t.num_features_flip, t.feature_flip_index, t.feature_flip_amt);
+    std::lock_guard<std::mutex> lock(traces_mutex);
+    auto found = traces.find(key);
+    if(found != traces.end()) {
+        return found->second;
+    }
+    // Cheap: the trace only does work as test inputs are replayed through it
+    BoxDropoutDomain::AbstractionType initial_box = {
+        initial_training_set,
+        PredicateAbstraction::onlyBottom(), // XXX any non-bot value, ideally top?
+        PosteriorDistributionAbstraction(1) // XXX any non-bot value, ideally top?
+    };
+    std::shared_ptr<BoxDisjunctsDropoutTrace> ret(new BoxDisjunctsDropoutTrace(initial_box, depth, use_memo ? &memo : NULL));
+    traces.insert(std::make_pair(key, ret));
+    return ret;
+}
+
+const FlatDecisionTree& ExperimentBackend::getConcreteTree(int depth) {
+    depth = max(depth, 0); // buildTree treats a negative depth as 0
+    std::lock_guard<std::mutex> lock(concrete_trees_mutex);
+    auto found = concrete_trees.find(depth);
+    if(found == concrete_trees.end()) {
+        ConcreteDecisionTree tree(training, depth);
+        found = concrete_trees.insert(std::make_pair(depth, std::unique_ptr<FlatDecisionTree>(
+            new FlatDecisionTree(tree, training->feature_types, training->num_categories)))).first;
+    }
+    return *found->second;
+}
+
 ExperimentBackend::Result<double> ExperimentBackend::run_concrete(int depth, int test_index) {
-    ProgramNode *program = buildTree(depth);
-    ConcreteSemantics sem;
-    auto ret = sem.execute(test->rows[test_index].x, training, program);
-    delete program;
+    auto ret = getConcreteTree(depth).classify(test->rows[test_index].x);
     return { ret, softMax(ret), groundTruth(test_index) };
 }
 
+double ExperimentBackend::concrete_accuracy(int depth, const std::vector<int> &test_indices) {
+    const FlatDecisionTree &tree = getConcreteTree(depth);
+    // Whether each leaf's classification is a single class, and which
+    std::vector<int> leaf_classes(tree.numLeaves());
+    for(unsigned int i = 0; i < tree.numLeaves(); i++) {
+        set<int> classification = softMax(tree.posterior(i));
+        leaf_classes[i] = (classification.size() == 1) ? *classification.cbegin() : -1;
+    }
+    std::vector<unsigned int> leaves = tree.leavesOf(*test, test_indices);
+    unsigned int num_correct = 0;
+    for(unsigned int i = 0; i < test_indices.size(); i++) {
+        num_correct += (leaf_classes[leaves[i]] == groundTruth(test_indices[i]));
+    }
+    return test_indices.empty() ? 0 : (double)num_correct / test_indices.size();
+}
+
 ExperimentBackend::Result<Interval<double>> ExperimentBackend::run_abstract(int depth, int test_index, int num_dropout, int num_add, 
                                                                             std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info,
                                                                             int num_features_flip, int feature_flip_index, float feature_flip_amt) {
-    ProgramNode *program = buildTree(depth);
     DropoutDomains d;
-    BoxDropoutSemantics sem(&d.box_domain);
+    d.box_domain.setMemo(use_memo ? &memo : NULL);
+    BoxDropoutUnrolledSemantics sem(&d.box_domain);
+    sem.setThreadPool(pool); // Forks the live branches of each if-then-else
     FeatureVector test_input = test->rows[test_index].x;
     DataReferences training_references(training);
     BoxDropoutDomain::AbstractionType initial_state = {
         TrainingReferencesWithDropout(training_references, num_dropout, num_add, add_sens_info, num_labels_flip, label_sens_info, num_features_flip, feature_flip_index, feature_flip_amt),
-        PredicateAbstraction(1), // XXX any non-bot value, ideally top?
+        PredicateAbstraction::onlyBottom(), // XXX any non-bot value, ideally top?
         PosteriorDistributionAbstraction(1) // XXX any non-bot value, ideally top?
     };
-    auto final_state = sem.execute(test_input, initial_state, program);
+    DecisionCutoff cutoff(&d.D_domain);
+    if(decision_only) {
+        sem.setCutoff([&cutoff](const BoxDropoutDomain::AbstractionType &leaf) { return cutoff.add(leaf.posterior_distribution_abstraction); });
+    }
+    auto final_state = sem.execute(test_input, initial_state, depth);
+    if(sem.wasCutShort()) {
+        auto ret = cutoff.getJoined();
+        return { ret, softMax(ret), groundTruth(test_index), true };
+    }
     auto ret = final_state.posterior_distribution_abstraction;
-    delete program;
     return { ret, softMax(ret), groundTruth(test_index) };
-
-
 }
 
 ExperimentBackend::Result<Interval<double>> ExperimentBackend::run_abstract_disjuncts(int depth, int test_index, int num_dropout, int num_add, 
                                                                             std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info,
                                                                             int num_features_flip, int feature_flip_index, float feature_flip_amt) {
-    ProgramNode *program = buildTree(depth);
+    if(use_trace) {
+        DataReferences training_references(training);
+        TrainingReferencesWithDropout initial_training_set(training_references, num_dropout, num_add, add_sens_info, num_labels_flip, label_sens_info, num_features_flip, feature_flip_index, feature_flip_amt);
+        auto ret = getTrace(depth, initial_training_set)->run(test->rows[test_index].x);
+        return { ret, softMax(ret), groundTruth(test_index) };
+    }
 
     DropoutDomains d;
-    BoxDisjunctsDropoutSemantics sem(&d.disjuncts_domain);
+    d.box_domain.setMemo(use_memo ? &memo : NULL);
+    d.disjuncts_domain.setThreadPool(pool);
+    BoxDisjunctsDropoutUnrolledSemantics sem(&d.disjuncts_domain);
+    sem.setThreadPool(pool); // Forks the live branches of each if-then-else
     FeatureVector test_input = test->rows[test_index].x;
     DataReferences training_references(training);
     BoxDropoutDomain::AbstractionType initial_box = {
         TrainingReferencesWithDropout(training_references, num_dropout, num_add, add_sens_info, num_labels_flip, label_sens_info, num_features_flip, feature_flip_index, feature_flip_amt),
-        PredicateAbstraction(1), // XXX any non-bot value, ideally top?
+        PredicateAbstraction::onlyBottom(), // XXX any non-bot value, ideally top?
         PosteriorDistributionAbstraction(1) // XXX any non-bot value, ideally top?
     };
     BoxDisjunctsDomainDropoutInstantiation::AbstractionType initial_state = {initial_box};
-    auto final_state = sem.execute(test_input, initial_state, program);
-    delete program;
+    DecisionCutoff cutoff(&d.D_domain);
+    if(decision_only) {
+        sem.setCutoff([&cutoff](const BoxDisjunctsDomainDropoutInstantiation::AbstractionType &leaf) {
+            bool decided = false;
+            for(auto i = leaf.cbegin(); i != leaf.cend(); i++) {
+                decided = cutoff.add(i->posterior_distribution_abstraction) || decided;
+            }
+            return decided;
+        });
+    }
+    auto final_state = sem.execute(test_input, initial_state, depth);
+    if(sem.wasCutShort()) {
+        auto ret = cutoff.getJoined();
+        return { ret, softMax(ret), groundTruth(test_index), true };
+    }
     std::vector<CategoricalDistribution<Interval<double>>> posteriors;
     for(auto i = final_state.cbegin(); i != final_state.cend(); i++) {
         posteriors.push_back(i->posterior_distribution_abstraction);
@@ -132,21 +234,36 @@ ExperimentBackend::Result<Interval<double>> ExperimentBackend::run_abstract_disj
 ExperimentBackend::Result<Interval<double>> ExperimentBackend::run_abstract_bounded_disjuncts(int depth, int test_index, int num_dropout, int num_add, 
                                                                             std::pair<int, int> add_sens_info, int num_labels_flip, std::pair<int, int> label_sens_info,
                                                                             int num_features_flip, int feature_flip_index, float feature_flip_amt, int disjunct_bound, const DisjunctsMergeMode &merge_mode) {
-    ProgramNode *program = buildTree(depth);
     DropoutDomains d;
+    d.box_domain.setMemo(use_memo ? &memo : NULL);
+    d.disjuncts_domain.setThreadPool(pool);
     FeatureVector test_input = test->rows[test_index].x;
 
     d.bounded_disjuncts_domain.setMergeDetails(disjunct_bound, merge_mode);
-    BoxDisjunctsDropoutSemantics sem(&d.bounded_disjuncts_domain);
+    BoxBoundedDisjunctsDropoutUnrolledSemantics sem(&d.bounded_disjuncts_domain);
+    sem.setThreadPool(pool); // Forks the live branches of each if-then-else
     DataReferences training_references(training);
     BoxDropoutDomain::AbstractionType initial_box = {
         TrainingReferencesWithDropout(training_references, num_dropout, num_add, add_sens_info, num_labels_flip, label_sens_info, num_features_flip, feature_flip_index, feature_flip_amt),
-        PredicateAbstraction(1), // XXX any non-bot value, ideally top?
+        PredicateAbstraction::onlyBottom(), // XXX any non-bot value, ideally top?
         PosteriorDistributionAbstraction(1) // XXX any non-bot value, ideally top?
     };
     BoxDisjunctsDomainDropoutInstantiation::AbstractionType initial_state = {initial_box};
-    auto final_state = sem.execute(test_input, initial_state, program);
-    delete program;
+    DecisionCutoff cutoff(&d.D_domain);
+    if(decision_only) {
+        sem.setCutoff([&cutoff](const BoxDisjunctsDomainDropoutInstantiation::AbstractionType &leaf) {
+            bool decided = false;
+            for(auto i = leaf.cbegin(); i != leaf.cend(); i++) {
+                decided = cutoff.add(i->posterior_distribution_abstraction) || decided;
+            }
+            return decided;
+        });
+    }
+    auto final_state = sem.execute(test_input, initial_state, depth);
+    if(sem.wasCutShort()) {
+        auto ret = cutoff.getJoined();
+        return { ret, softMax(ret), groundTruth(test_index), true };
+    }
     std::vector<CategoricalDistribution<Interval<double>>> posteriors;
     for(auto i = final_state.cbegin(); i != final_state.cend(); i++) {
         posteriors.push_back(i->posterior_distribution_abstraction);
@@ -155,23 +272,67 @@ ExperimentBackend::Result<Interval<double>> ExperimentBackend::run_abstract_boun
     return { ret, softMax(ret), groundTruth(test_index) };
 }
 
-std::map<int,int> ExperimentBackend::run_test(int depth, int test_index, int num_dropout, int num_trials, unsigned int seed) {
-    ProgramNode *program = buildTree(depth);
-    ConcreteSemantics sem;
-    map<int,int> ret;
-    for(int i = 0; i < training->num_categories; i++) {
-        ret.insert(make_pair(i, 0));
-    }
-    srand(seed);
-    for(int i = 0; i < num_trials; i++) {
-        DataReferences *subset = random_subset(training, num_dropout);
-        auto result = sem.execute(test->rows[test_index].x, subset, program);
-        set<int> classification = softMax(result);
-        for(auto j = classification.cbegin(); j != classification.cend(); j++) {
-            ret[*j]++;
+ExperimentBackend::RadiusResult ExperimentBackend::search_max_radius(int limit, const std::function<Result<Interval<double>>(int budget)> &run) {
+    RadiusResult ret;
+    ret.num_runs = 1;
+    ret.at_radius = run(0);
+    if(ret.at_radius.possible_classifications.size() != 1) {
+        ret.radius = -1;
+        return ret;
+    }
+    // Invariant: lo is certified (with its run in ret.at_radius), and hi (when positive) isn't
+    int lo = 0, hi = -1;
+    for(int step = 1; hi < 0 && lo < limit; step *= 2) {
+        int budget = std::min(step, limit);
+        auto result = run(budget);
+        ret.num_runs++;
+        if(result.possible_classifications.size() == 1) {
+            lo = budget;
+            ret.at_radius = result;
+        } else {
+            hi = budget;
+        }
+    }
+    while(hi - lo > 1) {
+        int budget = lo + (hi - lo) / 2;
+        auto result = run(budget);
+        ret.num_runs++;
+        if(result.possible_classifications.size() == 1) {
+            lo = budget;
+            ret.at_radius = result;
+        } else {
+            hi = budget;
+        }
+    }
+    ret.radius = lo;
+    return ret;
+}
+
+std::vector<std::map<int,int>> ExperimentBackend::run_test(int depth, const std::vector<int> &test_indices, int num_dropout, int num_trials, unsigned int seed) {
+    // Counts per test index (in order) and class
+    vector<vector<int>> counts(test_indices.size(), vector<int>(training->num_categories, 0));
+    mutex counts_mutex;
+    // Each trial seeds its own generator from (seed, trial), so the subsets don't depend on which thread runs which trial
+    parallelFor(pool, 0, max(num_trials, 0), 1, [&](size_t trial) {
+        seed_seq trial_seed = { seed, (unsigned int)trial };
+        mt19937 generator(trial_seed);
+        ConcreteDecisionTree tree(random_subset(training, num_dropout, generator), depth);
+        vector<set<int>> classifications(test_indices.size());
+        for(unsigned int i = 0; i < test_indices.size(); i++) {
+            classifications[i] = softMax(tree.classify(test->rows[test_indices[i]].x));
+        }
+        lock_guard<mutex> lock(counts_mutex);
+        for(unsigned int i = 0; i < test_indices.size(); i++) {
+            for(auto j = classifications[i].cbegin(); j != classifications[i].cend(); j++) {
+                counts[i][*j]++;
+            }
+        }
+    });
+    vector<map<int,int>> ret(test_indices.size());
+    for(unsigned int i = 0; i < test_indices.size(); i++) {
+        for(int j = 0; j < training->num_categories; j++) {
+            ret[i].insert(make_pair(j, counts[i][j]));
         }
-        delete subset;
     }
-    delete program;
     return ret;
 }
@@ -1,7 +1,11 @@
 #include "ExperimentDataWrangler.h"
+#include "ArffParser.h"
+#include "DataSetCache.h"
 #include "Feature.hpp"
 #include "MNIST.h"
 #include "UCI.h"
+#include <cstdio> // for std::snprintf
+#include <functional> // for std::hash
 #include <map>
 #include <string>
 #include <utility>
@@ -130,6 +134,8 @@ void makeWineExperimentDataThresholded(ExperimentData *wine) {
 
 ExperimentDataWrangler::ExperimentDataWrangler(const std::string &path_prefix) {
     this->path_prefix = path_prefix;
+    use_dataset_cache = true;
+    map_training_set = false;
 }
 
 ExperimentDataWrangler::~ExperimentDataWrangler() {
@@ -138,62 +144,108 @@ ExperimentDataWrangler::~ExperimentDataWrangler() {
     }
 }
 
+std::vector<std::string> ExperimentDataWrangler::sourceFiles(const ExperimentDataEnum &dataset) const {
+    UCINames uci;
+    switch(dataset) {
+        case ExperimentDataEnum::MNIST_BOOLEAN_1_7:
+        case ExperimentDataEnum::MNIST_1_7:
+        case ExperimentDataEnum::MNIST_BOOLEAN:
+        case ExperimentDataEnum::MNIST:
+            return { path_prefix + "/" + MNIST_TRAINING_LABEL_FILE, path_prefix + "/" + MNIST_TRAINING_IMAGE_FILE,
+                     path_prefix + "/" + MNIST_TEST_LABEL_FILE, path_prefix + "/" + MNIST_TEST_IMAGE_FILE };
+        case ExperimentDataEnum::USE_ARFF:
+            return {}; // See fetchArff
+        case ExperimentDataEnum::UCI_IRIS: uci = UCINames::IRIS; break;
+        case ExperimentDataEnum::UCI_CANCER: uci = UCINames::CANCER; break;
+        case ExperimentDataEnum::UCI_WINE: uci = UCINames::WINE; break;
+        case ExperimentDataEnum::UCI_WINE_2CLASS: uci = UCINames::WINE; break;
+        case ExperimentDataEnum::UCI_YEAST: uci = UCINames::YEAST; break;
+        case ExperimentDataEnum::UCI_RETINOPATHY: uci = UCINames::RETINOPATHY; break;
+        case ExperimentDataEnum::UCI_MAMMOGRAPHY: uci = UCINames::MAMMOGRAPHY; break;
+        case ExperimentDataEnum::ADULT_INCOME: uci = UCINames::ADULT_INCOME; break;
+        case ExperimentDataEnum::GERMAN_LOAN: uci = UCINames::GERMAN_LOAN; break;
+        case ExperimentDataEnum::COMPAS: uci = UCINames::COMPAS; break;
+        case ExperimentDataEnum::DRUG_CONSUMPTION: uci = UCINames::DRUG_CONSUMPTION; break;
+        default: return {}; // XXX shouldn't happen
+    }
+    const UCIDetails &details = UCI::getDetails(uci);
+    return { path_prefix + "/" + details.training_file_name, path_prefix + "/" + details.test_file_name };
+}
+
 void ExperimentDataWrangler::loadData(const ExperimentDataEnum &dataset) {
+    // The snapshot is keyed by the dataset's name, so derived datasets (like wine_2) get their own
+    std::string cache_path = path_prefix + "/" + to_string(dataset) + ".dscache";
+    ExperimentData *data = loadThroughSnapshot(cache_path, to_string(dataset), sourceFiles(dataset), [this, &dataset]() { return parseData(dataset); });
+    if(data != NULL) {
+        cache.insert(std::make_pair(dataset, data));
+    }
+}
+
+ExperimentData* ExperimentDataWrangler::parseData(const ExperimentDataEnum &dataset) {
     ExperimentData *temp;
     switch(dataset) {
         case ExperimentDataEnum::MNIST_BOOLEAN_1_7:
-            cache.insert(std::make_pair(dataset, loadSimplifiedMNIST(std::make_pair(1,7), true)));
-            break;
+            return loadSimplifiedMNIST(std::make_pair(1,7), true);
         case ExperimentDataEnum::MNIST_1_7:
-            cache.insert(std::make_pair(dataset, loadSimplifiedMNIST(std::make_pair(1,7), false)));
-            break;
+            return loadSimplifiedMNIST(std::make_pair(1,7), false);
         case ExperimentDataEnum::MNIST_BOOLEAN:
-            cache.insert(std::make_pair(dataset, loadFullMNIST(true)));
-            break;
+            return loadFullMNIST(true);
         case ExperimentDataEnum::MNIST:
-            cache.insert(std::make_pair(dataset, loadFullMNIST(false)));
-            break;
+            return loadFullMNIST(false);
         case ExperimentDataEnum::UCI_IRIS:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::IRIS)));
-            break;
+            return loadUCI(UCINames::IRIS);
         case ExperimentDataEnum::UCI_CANCER:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::CANCER)));
-            break;
+            return loadUCI(UCINames::CANCER);
         case ExperimentDataEnum::UCI_WINE:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::WINE)));
-            break;
+            return loadUCI(UCINames::WINE);
         case ExperimentDataEnum::UCI_WINE_2CLASS:
             temp = loadUCI(UCINames::WINE);
             makeWineExperimentDataThresholded(temp);
-            cache.insert(std::make_pair(dataset, temp));
-            break;
+            return temp;
         case ExperimentDataEnum::UCI_YEAST:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::YEAST)));
-            break;
+            return loadUCI(UCINames::YEAST);
         case ExperimentDataEnum::UCI_RETINOPATHY:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::RETINOPATHY)));
-            break;
+            return loadUCI(UCINames::RETINOPATHY);
         case ExperimentDataEnum::UCI_MAMMOGRAPHY:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::MAMMOGRAPHY)));
-            break;
+            return loadUCI(UCINames::MAMMOGRAPHY);
         case ExperimentDataEnum::USE_ARFF:
             // will be handled by arff parser
-            break; 
+            return NULL;
         case ExperimentDataEnum::ADULT_INCOME:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::ADULT_INCOME)));
-            break;
+            return loadUCI(UCINames::ADULT_INCOME);
         case ExperimentDataEnum::GERMAN_LOAN:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::GERMAN_LOAN)));
-            break;
+            return loadUCI(UCINames::GERMAN_LOAN);
         case ExperimentDataEnum::COMPAS:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::COMPAS)));
-            break;
+            return loadUCI(UCINames::COMPAS);
         case ExperimentDataEnum::DRUG_CONSUMPTION:
-            cache.insert(std::make_pair(dataset, loadUCI(UCINames::DRUG_CONSUMPTION)));
-            break;
+            return loadUCI(UCINames::DRUG_CONSUMPTION);
     }
+    return NULL; // XXX shouldn't happen---it's here to suppress a warning
 }
 
+ExperimentData* ExperimentDataWrangler::loadThroughSnapshot(const std::string &cache_path, const std::string &key, const std::vector<std::string> &sources,
+                                                            const std::function<ExperimentData*()> &parse) {
+    ExperimentData *ret = (use_dataset_cache ? DataSetCache::load(cache_path, key, sources, map_training_set) : NULL);
+    if(ret == NULL) {
+        ret = parse();
+        if(ret == NULL) {
+            return NULL;
+        }
+        if(use_dataset_cache && DataSetCache::save(cache_path, key, sources, *ret) && map_training_set) {
+            // Swap the parsed training set for the mapped one, so that it doesn't stay resident
+            ExperimentData *mapped = DataSetCache::load(cache_path, key, sources, true);
+            if(mapped != NULL) {
+                delete ret->training;
+                delete ret->test;
+                delete ret;
+                ret = mapped;
+            }
+        }
+    }
+    // Training only reads columns, so the training rows aren't kept around (only test rows are read)
+    ret->training->dropRows();
+    return ret;
+}
 
 ExperimentData* ExperimentDataWrangler::loadSimplifiedMNIST(const std::pair<int, int> &classes, bool booleanized) {
     RawMNIST raw_mnist_training(MNISTMode::TRAINING, path_prefix);
@@ -237,7 +289,7 @@ ExperimentData* ExperimentDataWrangler::loadUCI(const UCINames &dataset) {
     std::vector<std::string> labels;
 
     for(unsigned int i = 0; i < raw_uci.getTrainingData().size(); i++) {
-        CSVRow temp = raw_uci.getTrainingData()[i];
+        const CSVRow &temp = raw_uci.getTrainingData()[i];
         uci_training->rows[i].x = FeatureVector(temp.x.size());
         for(unsigned int j = 0; j < temp.x.size(); j++) {
             uci_training->rows[i].x[j] = temp.x[j];
@@ -251,7 +303,7 @@ ExperimentData* ExperimentDataWrangler::loadUCI(const UCINames &dataset) {
     }
     // XXX copy-paste
     for(unsigned int i = 0; i < raw_uci.getTestData().size(); i++) {
-        CSVRow temp = raw_uci.getTestData()[i];
+        const CSVRow &temp = raw_uci.getTestData()[i];
         uci_test->rows[i].x = FeatureVector(temp.x.size());
         for(unsigned int j = 0; j < temp.x.size(); j++) {
             uci_test->rows[i].x[j] = temp.x[j];
@@ -276,3 +328,27 @@ const ExperimentData* ExperimentDataWrangler::fetch(const ExperimentDataEnum &da
         return cache.at(dataset);
     }
 }
+
+const ExperimentData* ExperimentDataWrangler::fetchArff(const std::string &train_path, const std::string &test_path, bool booleanized, float thres, int label_ind) {
+    if(cache.find(ExperimentDataEnum::USE_ARFF) != cache.cend()) {
+        return cache.at(ExperimentDataEnum::USE_ARFF);
+    }
+    // Everything that changes how the files are read goes into the key (%a prints the threshold exactly),
+    // and a hash of it into the file name, so runs with different options keep separate snapshots
+    char threshold[64];
+    std::snprintf(threshold, sizeof(threshold), "%a", booleanized ? thres : 0);
+    std::string key = "arff " + train_path + " " + test_path + " -B " + threshold + " -i " + std::to_string(label_ind);
+    char key_hash[32];
+    std::snprintf(key_hash, sizeof(key_hash), "%016zx", std::hash<std::string>()(key));
+    std::string cache_path = train_path + "." + key_hash + ".dscache";
+    std::vector<std::string> sources = { train_path, test_path };
+
+    ExperimentData *ret = loadThroughSnapshot(cache_path, key, sources, [&]() {
+        return ArffParser::loadArff(train_path, test_path, booleanized, thres, label_ind);
+    });
+    if(ret == NULL) {
+        return NULL;
+    }
+    cache.insert(std::make_pair(ExperimentDataEnum::USE_ARFF, ret));
+    return ret;
+}
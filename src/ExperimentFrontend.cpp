@@ -5,11 +5,21 @@
 #include "ExperimentDataWrangler.h"
 #include "Interval.h"
 #include "ArffParser.h"
+#include "RunProfile.h"
+#include "ThreadPool.h"
+#include <algorithm> // for std::stable_sort
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -36,6 +46,28 @@ void vectorizeIntStringSplit(std::vector<int> &items, const std::string &space_s
     }
 }
 
+// Token constraints for ArgParse (std::stoi and friends accept negatives and trailing junk)
+bool isNonNegativeInt(const std::string &value) {
+    try {
+        size_t end;
+        int n = std::stoi(value, &end);
+        return end == value.size() && n >= 0;
+    } catch(const std::exception &) {
+        return false;
+    }
+}
+
+// A size in MB that still fits in a size_t once shifted to bytes
+bool isMemoMegabytes(const std::string &value) {
+    try {
+        size_t end;
+        long long n = std::stoll(value, &end);
+        return end == value.size() && n >= 0 && (unsigned long long)n <= (std::numeric_limits<size_t>::max() >> 20);
+    } catch(const std::exception &) {
+        return false;
+    }
+}
+
 std::string formatDistribution(const CategoricalDistribution<Interval<double>> &dist, const std::vector<std::string> &labels) {
     // XXX strong assumption that dist.size() == labels.size()
     std::string ret = "{";
@@ -82,8 +114,19 @@ void ExperimentFrontend::createCommandLineArguments() {
     p.createArgument("use_abstract", "-a", 0, "Use abstract semantics (not concrete); The passed value is a space-separated list of the n in <T,n>", true);
     p.createArgument("use_disjuncts", "-V", 0, "Like -a, but with disjuncts", true);
     p.createArgument("disjunct_bound", "-b", 2, "When -V is used, (1) an integer bound on the number of disjuncts, and (2) specify the merging strategy from " + setToString(merge_options), true);
+    p.createArgument("trace", "--trace", 0, "When -V is used without -b, learn the abstract tree once and replay it for each test index (same results, much less work per index)", true);
+    p.createArgument("decision_only", "--decision-only", 0, "With -a or -V (except when replaying a --trace), stop as soon as more than one classification is possible; the posterior reported is then only part of the full one, and the output says \"cut_short\"", true);
+    p.createArgument("max_radius", "--max-radius", 1, "With -a or -V, report for each test index the largest budget of one kind (n, m or l; up to the training set size) that is still certified, in place of running the budget given for it (the other budgets stay as given)", true);
+    p.createArgument("accuracy", "--accuracy", 0, "With concrete semantics, print each depth's accuracy over the test indices (one line per depth) instead of each index's result", true);
+    p.createArgument("save_tree", "--save-tree", 1, "With concrete semantics, also save each depth's learned tree to <prefix>-d<depth>.tree", true);
+    p.createArgument("profile", "--profile", 0, "With -a or -V (except with --max-radius), add a \"profile\" to each result: calls, time and bytes allocated per abstract transformer, disjunct counts per tree level, and bytes allocated by the whole run (replayed --trace runs only get the totals)", true);
+    p.createArgument("chrome_trace", "--chrome-trace", 1, "With -a or -V (except with --max-radius), write every abstract transformer call to this file as a Chrome trace (for chrome://tracing or Perfetto), one process per test index", true);
     p.createArgument("verbose", "-v", 0, "", true);
-    p.createArgument("random_test", "-r", 2, "Run concrete semantics on random samples from <T,n, l, m, f, i>. (1) # of random samples, (2) the random seed, (3) n, (4) m, (5) l, (6) f, (7) i", true);
+    p.createArgument("threads", "--threads", 1, "Number of threads that run test indices, and the disjuncts of each (with -V), concurrently (0 for one per core); results are still printed in order. With -r, the random trials run concurrently instead (with the same results)", true);
+    p.createArgument("no_data_cache", "--no-data-cache", 0, "Always parse the dataset files, neither reading nor writing the binary snapshot (.dscache) normally kept next to them", true);
+    p.createArgument("out_of_core", "--out-of-core", 0, "Train from the dataset's binary snapshot mapped in place, paging it in from disk as needed, rather than holding the training set in memory (ignored with --no-data-cache)", true);
+    p.createArgument("memo_mb", "--memo-mb", 1, "Memory budget (in MB) for remembering abstract transformer results across disjuncts and test indices (0 disables); default " + std::to_string(ExperimentBackend::DEFAULT_MEMO_BYTES >> 20), true);
+    p.createArgument("random_test", "-r", 2, "Count the concrete classifications over random samples from <T,n> (n as given by -n): (1) # of random samples, (2) the random seed", true);
     p.createArgument("binary", "-B", 1, "Transform dataset into binary form by threshold (only effective with arff datasets)", true);
     p.createArgument("num_dropout", "-n", 1, "Number of potentially fake elements to drop", true);
     p.createArgument("label_flipping", "-l", 1, "Number of labels to flip", true);
@@ -109,32 +152,36 @@ void ExperimentFrontend::createCommandLineArguments() {
     p.requireAtMostOne({"missing_data", "missing_data_one"});
 
     p.requireTokenInSet("disjunct_bound", 1, merge_options);
+    p.requireTokenInSet("max_radius", 0, {"n", "m", "l"});
     p.requireTokenInSet("dataset", 1, dataset_options);
+    p.requireTokenConstraint("threads", 0, isNonNegativeInt, "--threads must be a non-negative integer");
+    p.requireTokenConstraint("memo_mb", 0, isMemoMegabytes, "--memo-mb must be a non-negative number of megabytes");
 }
 
-void ExperimentFrontend::performSingleTest(int depth, int test_index) {
+std::optional<std::string> ExperimentFrontend::performSingleTest(int depth, int test_index) {
     if(test_index < e->test_size()) {
-        if(params.random_test.flag) {
-            output("running a depth-" + std::to_string(depth) + " random test (" + std::to_string(params.random_test.num_trials) + ") using <T," + std::to_string(params.random_test.num_dropout) + "> on test " + std::to_string(test_index));
-            std::map<int,int> ret = e->run_test(depth, test_index, params.random_test.num_dropout, params.random_test.num_trials, params.random_test.seed);
-            output(output_to_json(depth, test_index, ret), true);
+        if(params.use_abstract && params.max_radius.has_value()) {
+            return performMaxRadiusTests(depth, test_index);
         } else if(params.use_abstract) {
-            performAbstractTests(depth, test_index);
+            return performAbstractTests(depth, test_index);
         } else {
             output("running a depth-" + std::to_string(depth) + " experiment using T on test " + std::to_string(test_index));
             ExperimentBackend::Result<double> ret = e->run_concrete(depth, test_index);
-            output(output_to_json(depth, test_index, ret), true);
+            return output_to_json(depth, test_index, ret);
         }
     } else {
         output("skipping test " + std::to_string(test_index) + " (out of bounds)");
+        return {};
     }
 }
 
-void ExperimentFrontend::performAbstractTests(int depth, int test_index) {
+std::string ExperimentFrontend::performAbstractTests(int depth, int test_index) {
     std::string message = "running a depth-" + std::to_string(depth) + " experiment ";
     if(params.with_disjuncts) {
         if(params.disjunct_bound.has_value()) {
             message += "(with disjuncts # <= " + std::to_string(params.disjunct_bound.value()) + ") ";
+        } else if(params.use_trace) {
+            message += "(with disjuncts, replaying a trace) ";
         } else {
             message += "(with disjuncts) ";
         }
@@ -149,17 +196,110 @@ void ExperimentFrontend::performAbstractTests(int depth, int test_index) {
 
     message += "on test " + std::to_string(test_index);
     output(message);
-    ExperimentBackend::Result<Interval<double>> ret;
+    std::shared_ptr<RunProfile> profile;
+    if(params.profile || params.chrome_trace_path.has_value()) {
+        profile = std::make_shared<RunProfile>(params.chrome_trace_path.has_value());
+    }
+    auto run = [&]() {
+        // Whatever this thread (and the tasks it hands off) does until runAbstract returns goes into profile
+        RunProfile::Scope scope(profile.get());
+        return runAbstract(depth, test_index, params.num_dropout, params.num_add, params.num_labels_flip);
+    };
+    ExperimentBackend::Result<Interval<double>> ret = run();
+    if(profile) {
+        profile->finish();
+        if(params.chrome_trace_path.has_value()) {
+            std::lock_guard<std::mutex> lock(traced_runs_mutex);
+            traced_runs.push_back(std::make_pair(std::make_pair(depth, test_index), profile));
+        }
+    }
+    return output_to_json(depth, test_index, ret, params.profile ? profile.get() : NULL);
+}
+
+std::string ExperimentFrontend::performMaxRadiusTests(int depth, int test_index) {
+    const std::string &which = params.max_radius.value();
+    output("searching for the largest certified " + which + " at depth " + std::to_string(depth) + " on test " + std::to_string(test_index));
+    // Every budget runs in this process, so the data (and the memo, for budgets other test indices also tried) stay warm
+    auto ret = ExperimentBackend::search_max_radius(e->training_size(), [this, &which, depth, test_index](int budget) {
+        return runAbstract(depth, test_index,
+                           which == "n" ? budget : params.num_dropout,
+                           which == "m" ? budget : params.num_add,
+                           which == "l" ? budget : params.num_labels_flip);
+    });
+    return output_to_json(depth, test_index, ret);
+}
+
+ExperimentBackend::Result<Interval<double>> ExperimentFrontend::runAbstract(int depth, int test_index, int num_dropout, int num_add, int num_labels_flip) {
     if(!params.with_disjuncts) {
-        ret = e->run_abstract(depth, test_index, params.num_dropout, params.num_add, params.add_sens_info, params.num_labels_flip, params.label_sens_info, params.num_features_flip, params.feature_flip_index, params.feature_flip_amt);
+        return e->run_abstract(depth, test_index, num_dropout, num_add, params.add_sens_info, num_labels_flip, params.label_sens_info, params.num_features_flip, params.feature_flip_index, params.feature_flip_amt);
+    } else if(params.disjunct_bound.has_value()) {
+        return e->run_abstract_bounded_disjuncts(depth, test_index, num_dropout, num_add, params.add_sens_info, num_labels_flip, params.label_sens_info, params.num_features_flip, params.feature_flip_index, params.feature_flip_amt, params.disjunct_bound.value(), params.merge_mode);
     } else {
-        if(params.disjunct_bound.has_value()) {
-            ret = e->run_abstract_bounded_disjuncts(depth, test_index, params.num_dropout, params.num_add, params.add_sens_info, params.num_labels_flip, params.label_sens_info, params.num_features_flip, params.feature_flip_index, params.feature_flip_amt, params.disjunct_bound.value(), params.merge_mode);
+        return e->run_abstract_disjuncts(depth, test_index, num_dropout, num_add, params.add_sens_info, num_labels_flip, params.label_sens_info, params.num_features_flip, params.feature_flip_index, params.feature_flip_amt);
+    }
+}
+
+void ExperimentFrontend::performRandomTests(int depth, const std::vector<int> &test_indices) {
+    std::vector<int> in_bounds;
+    for(auto i = test_indices.cbegin(); i != test_indices.cend(); i++) {
+        if(*i < e->test_size()) {
+            in_bounds.push_back(*i);
         } else {
-            ret = e->run_abstract_disjuncts(depth, test_index, params.num_dropout, params.num_add, params.add_sens_info, params.num_labels_flip, params.label_sens_info, params.num_features_flip, params.feature_flip_index, params.feature_flip_amt);
+            output("skipping test " + std::to_string(*i) + " (out of bounds)");
         }
     }
-    output(output_to_json(depth, test_index, ret), true);  
+    output("running a depth-" + std::to_string(depth) + " random test (" + std::to_string(params.random_test.num_trials) + ") using <T," + std::to_string(params.random_test.num_dropout) + "> on " + std::to_string(in_bounds.size()) + " tests");
+    std::vector<std::map<int,int>> ret = e->run_test(depth, in_bounds, params.random_test.num_dropout, params.random_test.num_trials, params.random_test.seed);
+    for(unsigned int i = 0; i < in_bounds.size(); i++) {
+        output(output_to_json(depth, in_bounds[i], ret[i]), true);
+    }
+}
+
+void ExperimentFrontend::performBatch(const std::vector<std::pair<int, int>> &jobs, ThreadPool &pool) {
+    // Each job's result lands in its own slot; whichever thread completes the
+    // lowest not-yet-printed job flushes the finished prefix, so the output
+    // comes out in exactly the order a serial run would produce.
+    std::vector<std::optional<std::string>> results(jobs.size());
+    std::vector<bool> finished(jobs.size(), false);
+    unsigned int next_to_print = 0;
+    std::mutex results_mutex;
+
+    TaskGroup group(&pool);
+    for(unsigned int i = 0; i < jobs.size(); i++) {
+        group.run([this, i, &jobs, &results, &finished, &next_to_print, &results_mutex]() {
+            std::optional<std::string> result = performSingleTest(jobs[i].first, jobs[i].second);
+            std::lock_guard<std::mutex> lock(results_mutex);
+            results[i] = result;
+            finished[i] = true;
+            for(; next_to_print < jobs.size() && finished[next_to_print]; next_to_print++) {
+                if(results[next_to_print].has_value()) {
+                    output(results[next_to_print].value(), true);
+                }
+                results[next_to_print] = {}; // No need to hold on to printed strings
+            }
+        });
+    }
+    group.wait();
+}
+
+void ExperimentFrontend::writeChromeTrace() {
+    // In output order (the runs finish in any order with --threads), each in a process of its own
+    std::stable_sort(traced_runs.begin(), traced_runs.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+    std::string events;
+    for(unsigned int i = 0; i < traced_runs.size(); i++) {
+        const std::pair<int, int> &job = traced_runs[i].first;
+        traced_runs[i].second->appendChromeTraceEvents(events, i + 1, "depth " + std::to_string(job.first) + ", test " + std::to_string(job.second));
+    }
+    traced_runs.clear();
+
+    std::ofstream out(params.chrome_trace_path.value());
+    out << "{ \"traceEvents\" : [\n" << events << "\n], \"displayTimeUnit\" : \"ms\" }" << std::endl;
+    if(out) {
+        output("wrote the Chrome trace to " + params.chrome_trace_path.value());
+    } else {
+        output("could not write the Chrome trace to " + params.chrome_trace_path.value(), true);
+    }
 }
 
 std::string ExperimentFrontend::output_to_json(int depth, int test_index, const std::map<int,int> &result) {
@@ -167,11 +307,13 @@ std::string ExperimentFrontend::output_to_json(int depth, int test_index, const
     ret += "\"depth\" : " + std::to_string(depth) + ", ";
     ret += "\"test_index\" : " + std::to_string(test_index) + ", ";
     ret += "\"classification_counts\" : { ";
+    bool first = true;
     for(auto i = result.cbegin(); i != result.cend(); i++) {
         if(i->second != 0) {
-            if(i != result.cbegin()) {
+            if(!first) {
                 ret += ", ";
             }
+            first = false;
             ret += "\"" + current_data->class_labels[i->first] + "\" : " + std::to_string(i->second);
         }
     }
@@ -205,7 +347,7 @@ std::string ExperimentFrontend::output_to_json(int depth, int test_index, const
     return ret;
 }
 
-std::string ExperimentFrontend::output_to_json(int depth, int test_index, const ExperimentBackend::Result<Interval<double>> &result) {
+std::string ExperimentFrontend::output_to_json(int depth, int test_index, const ExperimentBackend::Result<Interval<double>> &result, const RunProfile *profile) {
     std::string ret = "{ ";
     ret += "\"depth\" : " + std::to_string(depth) + ", ";
     ret += "\"test_index\" : " + std::to_string(test_index) + ", ";
@@ -228,12 +370,39 @@ std::string ExperimentFrontend::output_to_json(int depth, int test_index, const
         ret += "\"" + current_data->class_labels[*i] + "\"";
     }
     ret += " ]";
+    if(params.decision_only) {
+        ret += std::string(", \"cut_short\" : ") + (result.cut_short ? "true" : "false");
+    }
+    if(profile != NULL) {
+        ret += ", \"profile\" : " + profile->toJson();
+    }
+    ret += " }";
+    return ret;
+}
+
+std::string ExperimentFrontend::output_to_json(int depth, int test_index, const ExperimentBackend::RadiusResult &result) {
+    std::string ret = "{ ";
+    ret += "\"depth\" : " + std::to_string(depth) + ", ";
+    ret += "\"test_index\" : " + std::to_string(test_index) + ", ";
+    ret += "\"ground_truth\" : \"" + current_data->class_labels[result.at_radius.ground_truth] + "\", ";
+    ret += "\"budget\" : \"" + params.max_radius.value() + "\", ";
+    ret += "\"certified_radius\" : " + std::to_string(result.radius) + ", ";
+    ret += "\"possible_classifications\" : [ ";
+    for(auto i = result.at_radius.possible_classifications.cbegin(); i != result.at_radius.possible_classifications.cend(); i++) {
+        if(i != result.at_radius.possible_classifications.cbegin()) {
+            ret += ", ";
+        }
+        ret += "\"" + current_data->class_labels[*i] + "\"";
+    }
+    ret += " ], ";
+    ret += "\"num_runs\" : " + std::to_string(result.num_runs);
     ret += " }";
     return ret;
 }
 
 void ExperimentFrontend::output(const std::string &message, bool force) {
     if(verbose || force) {
+        std::lock_guard<std::mutex> lock(output_mutex);
         std::cout << message << std::endl;
     }
 }
@@ -254,7 +423,7 @@ bool ExperimentFrontend::processCommandLineArguments(int argc, char ** const &ar
         } else if(p["dataset(arff)"].included) {
             params.arff_train = p["dataset(arff)"].tokens[0];
             params.arff_test = p["dataset(arff)"].tokens[1];
-            std::cout << "dataset: " << p["dataset"].tokens[0] << std::endl;
+            std::cout << "dataset: " << p["dataset(arff)"].tokens[0] << std::endl;
             params.dataset = ExperimentDataEnum::USE_ARFF; 
             if(p["label_index"].included) {
                 params.arff_label_ind = std::stoi(p["label_index"].tokens[0]); 
@@ -308,6 +477,7 @@ bool ExperimentFrontend::processCommandLineArguments(int argc, char ** const &ar
         if(p["random_test"].included) {
             params.random_test.num_trials = std::stoi(p["random_test"].tokens[0]);
             params.random_test.seed = std::stoi(p["random_test"].tokens[1]);
+            params.random_test.num_dropout = params.num_dropout;
         } else if(p["use_abstract"].included) {
             params.with_disjuncts = false;
         } else if(p["use_disjuncts"].included) {
@@ -319,6 +489,37 @@ bool ExperimentFrontend::processCommandLineArguments(int argc, char ** const &ar
                 params.disjunct_bound = {};
             }
         }
+        params.use_trace = p["trace"].included;
+        params.decision_only = p["decision_only"].included;
+        if(p["max_radius"].included) {
+            params.max_radius = p["max_radius"].tokens[0];
+        } else {
+            params.max_radius = {};
+        }
+        params.accuracy = p["accuracy"].included;
+        if(p["save_tree"].included) {
+            params.save_tree_prefix = p["save_tree"].tokens[0];
+        } else {
+            params.save_tree_prefix = {};
+        }
+        params.profile = p["profile"].included;
+        if(p["chrome_trace"].included) {
+            params.chrome_trace_path = p["chrome_trace"].tokens[0];
+        } else {
+            params.chrome_trace_path = {};
+        }
+        params.use_dataset_cache = !p["no_data_cache"].included;
+        params.out_of_core = p["out_of_core"].included && params.use_dataset_cache;
+        if(p["threads"].included) {
+            params.num_threads = std::stoi(p["threads"].tokens[0]);
+        } else {
+            params.num_threads = 1;
+        }
+        if(p["memo_mb"].included) {
+            params.memo_bytes = (size_t)std::stoll(p["memo_mb"].tokens[0]) << 20;
+        } else {
+            params.memo_bytes = ExperimentBackend::DEFAULT_MEMO_BYTES;
+        }
         if(p["binary"].included) {
             params.use_bin = true;
             params.bin_thres = stof(p["binary"].tokens[0]);
@@ -335,32 +536,101 @@ bool ExperimentFrontend::processCommandLineArguments(int argc, char ** const &ar
 }
 
 void ExperimentFrontend::performExperiments() {
+    wrangler = new ExperimentDataWrangler(params.data_prefix);
+    wrangler->setUseDataSetCache(params.use_dataset_cache);
+    wrangler->setMapTrainingSet(params.out_of_core);
     if(params.dataset != ExperimentDataEnum::USE_ARFF) {
-        wrangler = new ExperimentDataWrangler(params.data_prefix);
         current_data = wrangler->fetch(params.dataset);
     } else {
-        current_data = ArffParser::loadArff(params.arff_train, 
-                                            params.arff_test, 
-                                            params.use_bin, 
-                                            params.use_bin ? params.bin_thres : 0.0, 
-                                            params.arff_label_ind); 
+        current_data = wrangler->fetchArff(params.arff_train, 
+                                           params.arff_test, 
+                                           params.use_bin, 
+                                           params.use_bin ? params.bin_thres : 0.0, 
+                                           params.arff_label_ind); 
     }
     e = new ExperimentBackend(current_data->training, current_data->test);
+    e->setMemoCapacity(params.memo_bytes);
+    e->setUseTrace(params.use_trace);
+    // A radius search only needs each budget's verdict
+    e->setDecisionOnly(params.decision_only || params.max_radius.has_value());
 
+    std::vector<std::pair<int, int>> jobs; // (depth, test index) in output order
     for(auto depth = params.depths.begin(); depth != params.depths.end(); depth++) {
         if(params.test_all) {
             for(int i = 0; i < e->test_size(); i++) {
-                performSingleTest(*depth, i);
+                jobs.push_back(std::make_pair(*depth, i));
             }
         } else {
             for(auto i = params.test_indices.begin(); i != params.test_indices.end(); i++) {
-                performSingleTest(*depth, *i);
+                jobs.push_back(std::make_pair(*depth, *i));
             }
         }
     }
-    delete e;
 
-    if(params.dataset != ExperimentDataEnum::USE_ARFF) {
-        delete wrangler;
-    } 
+    bool concrete = !params.use_abstract && !params.random_test.flag;
+    if(concrete && params.save_tree_prefix.has_value()) {
+        for(auto depth = params.depths.cbegin(); depth != params.depths.cend(); depth++) {
+            std::string path = params.save_tree_prefix.value() + "-d" + std::to_string(*depth) + ".tree";
+            if(e->save_concrete_tree(*depth, path)) {
+                output("saved the depth-" + std::to_string(*depth) + " tree to " + path);
+            } else {
+                output("could not save the depth-" + std::to_string(*depth) + " tree to " + path, true);
+            }
+        }
+    }
+
+    if(concrete && params.accuracy) {
+        for(auto i = jobs.cbegin(); i != jobs.cend();) {
+            std::vector<int> test_indices;
+            int depth = i->first;
+            for(; i != jobs.cend() && i->first == depth; i++) {
+                if(i->second < e->test_size()) {
+                    test_indices.push_back(i->second);
+                }
+            }
+            double accuracy = e->concrete_accuracy(depth, test_indices);
+            output("{ \"depth\" : " + std::to_string(depth) + ", \"num_tests\" : " + std::to_string(test_indices.size())
+                    + ", \"accuracy\" : " + std::to_string(accuracy) + " }", true);
+        }
+    } else if(params.random_test.flag) {
+        // Each depth's trials are shared by all of its test indices, and run on the pool
+        std::unique_ptr<ThreadPool> pool;
+        if(params.num_threads != 1) {
+            pool.reset(new ThreadPool(params.num_threads));
+            e->setThreadPool(pool.get());
+        }
+        for(auto i = jobs.cbegin(); i != jobs.cend();) {
+            std::vector<int> test_indices;
+            int depth = i->first;
+            for(; i != jobs.cend() && i->first == depth; i++) {
+                test_indices.push_back(i->second);
+            }
+            performRandomTests(depth, test_indices);
+        }
+        e->setThreadPool(NULL);
+    } else if(params.num_threads == 1) {
+        for(auto i = jobs.cbegin(); i != jobs.cend(); i++) {
+            std::optional<std::string> result = performSingleTest(i->first, i->second);
+            if(result.has_value()) {
+                output(result.value(), true);
+            }
+        }
+    } else {
+        // Each test index is a task, and (with -V) forks its branches and a task per few disjuncts on the same pool
+        ThreadPool pool(params.num_threads);
+        e->setThreadPool(&pool);
+        performBatch(jobs, pool);
+        e->setThreadPool(NULL);
+    }
+    if(params.use_abstract && params.memo_bytes > 0) {
+        BoxDropoutMemo::Stats stats = e->memoStats();
+        output("memo: " + std::to_string(stats.hits) + " hits, " + std::to_string(stats.misses) + " misses, "
+                + std::to_string(stats.evictions) + " evictions; " + std::to_string(stats.num_entries) + " entries using "
+                + std::to_string(stats.used_bytes >> 10) + " of " + std::to_string(stats.capacity_bytes >> 10) + " KB");
+    }
+    if(params.chrome_trace_path.has_value()) {
+        writeChromeTrace();
+    }
+    delete e;
+    delete wrangler;
 }
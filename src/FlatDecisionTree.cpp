@@ -0,0 +1,179 @@
+#include "FlatDecisionTree.h"
+#include "CategoricalDistribution.hpp"
+#include "ConcreteDecisionTree.h"
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+using namespace std;
+
+static const char MAGIC[8] = {'D', 'T', 'R', 'E', 'E', '\0', '\0', '\0'};
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+static unsigned int height(const ConcreteDecisionTree &tree, unsigned int node) {
+    const ConcreteDecisionTree::Node &n = tree.getNodes()[node];
+    if(!n.phi.has_value()) {
+        return 0;
+    }
+    return 1 + max(height(tree, n.satisfied), height(tree, n.unsatisfied));
+}
+
+/**
+ * FlatDecisionTree members
+ */
+
+FlatDecisionTree::FlatDecisionTree(const ConcreteDecisionTree &tree, const FeatureVectorHeader &feature_types, unsigned int num_categories) {
+    depth = height(tree, 0);
+    num_features = feature_types.size();
+    this->num_categories = num_categories;
+    unsigned int num_leaves = 0;
+    root = place(tree, 0, num_leaves);
+}
+
+uint32_t FlatDecisionTree::place(const ConcreteDecisionTree &tree, unsigned int node, unsigned int &num_leaves) {
+    const ConcreteDecisionTree::Node &n = tree.getNodes()[node];
+    if(!n.phi.has_value()) {
+        posteriors.resize(posteriors.size() + num_categories, 0);
+        for(unsigned int k = 0; k < num_categories && k < n.posterior.size(); k++) {
+            posteriors[(size_t)num_leaves * num_categories + k] = n.posterior[k];
+        }
+        return LEAF | num_leaves++;
+    }
+    const Predicate &phi = n.phi.value();
+    uint32_t i = features.size();
+    features.push_back(phi.get_feature_index());
+    switch(phi.get_feature_type()) {
+        // XXX need to make changes here if adding new feature types
+        case FeatureType::BOOLEAN:
+            thresholds.push_back(0.5);
+            negated.push_back(1);
+            break;
+        case FeatureType::NUMERIC:
+            thresholds.push_back(phi.get_threshold());
+            negated.push_back(0);
+            break;
+    }
+    children.resize(children.size() + 2);
+    // children may be reallocated while placing the subtrees, so index it afresh afterwards
+    uint32_t satisfied = place(tree, n.satisfied, num_leaves);
+    uint32_t unsatisfied = place(tree, n.unsatisfied, num_leaves);
+    children[2 * i] = satisfied;
+    children[2 * i + 1] = unsatisfied;
+    return i;
+}
+
+void FlatDecisionTree::toFloats(const FeatureVector &x, vector<float> &out) {
+    out.resize(x.size());
+    for(unsigned int f = 0; f < x.size(); f++) {
+        switch(x[f].getType()) {
+            // XXX need to make changes here if adding new feature types
+            case FeatureType::BOOLEAN:
+                out[f] = x[f].getBooleanValue() ? 1 : 0;
+                break;
+            case FeatureType::NUMERIC:
+                out[f] = x[f].getNumericValue();
+                break;
+        }
+    }
+}
+
+CategoricalDistribution<double> FlatDecisionTree::posterior(unsigned int leaf) const {
+    CategoricalDistribution<double> ret(num_categories);
+    for(unsigned int k = 0; k < num_categories; k++) {
+        ret[k] = posteriors[(size_t)leaf * num_categories + k];
+    }
+    return ret;
+}
+
+CategoricalDistribution<double> FlatDecisionTree::classify(const FeatureVector &x) const {
+    vector<float> values;
+    toFloats(x, values);
+    return posterior(leafOf(values.data()));
+}
+
+vector<unsigned int> FlatDecisionTree::leavesOf(const DataSet &data_set, const vector<int> &rows) const {
+    vector<unsigned int> ret(rows.size());
+    vector<float> values;
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        toFloats(data_set.rows[rows[i]].x, values);
+        ret[i] = leafOf(values.data());
+    }
+    return ret;
+}
+
+bool FlatDecisionTree::save(const string &path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    auto write = [&out](const void *data, size_t length) { out.write((const char *)data, length); };
+    write(MAGIC, sizeof(MAGIC));
+    write(&VERSION, sizeof(VERSION));
+    write(&BYTE_ORDER_MARK, sizeof(BYTE_ORDER_MARK));
+    write(&depth, sizeof(depth));
+    write(&num_features, sizeof(num_features));
+    write(&num_categories, sizeof(num_categories));
+    uint32_t num_internal = features.size();
+    write(&num_internal, sizeof(num_internal));
+    write(&root, sizeof(root));
+    write(features.data(), features.size() * sizeof(uint32_t));
+    write(thresholds.data(), thresholds.size() * sizeof(float));
+    write(negated.data(), negated.size() * sizeof(uint8_t));
+    write(children.data(), children.size() * sizeof(uint32_t));
+    write(posteriors.data(), posteriors.size() * sizeof(double));
+    return out.good();
+}
+
+optional<FlatDecisionTree> FlatDecisionTree::load(const string &path) {
+    ifstream in(path, ios::binary | ios::ate);
+    auto read = [&in](void *data, size_t length) { in.read((char *)data, length); return in.good(); };
+    uint64_t file_size = in.good() ? (uint64_t)in.tellg() : 0;
+    in.seekg(0);
+    char magic[sizeof(MAGIC)];
+    uint32_t version, byte_order_mark, num_internal;
+    FlatDecisionTree ret;
+    if(!read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       !read(&version, sizeof(version)) || version != VERSION ||
+       !read(&byte_order_mark, sizeof(byte_order_mark)) || byte_order_mark != BYTE_ORDER_MARK ||
+       !read(&ret.depth, sizeof(ret.depth)) || !read(&ret.num_features, sizeof(ret.num_features)) ||
+       !read(&ret.num_categories, sizeof(ret.num_categories)) ||
+       !read(&num_internal, sizeof(num_internal)) || !read(&ret.root, sizeof(ret.root)) || num_internal >= LEAF) {
+        return {};
+    }
+    // Check the sizes against the file before allocating anything for them
+    uint64_t num_leaves = (uint64_t)num_internal + 1;
+    uint64_t expected = (uint64_t)in.tellg() +
+        num_internal * (uint64_t)(sizeof(uint32_t) + sizeof(float) + sizeof(uint8_t) + 2 * sizeof(uint32_t)) +
+        num_leaves * ret.num_categories * sizeof(double);
+    if(expected != file_size) {
+        return {};
+    }
+    ret.features.resize(num_internal);
+    ret.thresholds.resize(num_internal);
+    ret.negated.resize(num_internal);
+    ret.children.resize(2 * (size_t)num_internal);
+    ret.posteriors.resize(num_leaves * ret.num_categories);
+    if(!read(ret.features.data(), ret.features.size() * sizeof(uint32_t)) ||
+       !read(ret.thresholds.data(), ret.thresholds.size() * sizeof(float)) ||
+       !read(ret.negated.data(), ret.negated.size() * sizeof(uint8_t)) ||
+       !read(ret.children.data(), ret.children.size() * sizeof(uint32_t)) ||
+       !read(ret.posteriors.data(), ret.posteriors.size() * sizeof(double))) {
+        return {};
+    }
+    // The traversal trusts these, so a corrupt file mustn't send it out of bounds (or round in circles)
+    auto valid_child = [&num_leaves, &num_internal](uint32_t child, uint64_t after) {
+        return (child & LEAF) ? (child & ~LEAF) < num_leaves : (child >= after && child < num_internal);
+    };
+    if(!valid_child(ret.root, 0)) {
+        return {};
+    }
+    for(unsigned int i = 0; i < num_internal; i++) {
+        if(ret.features[i] >= max(ret.num_features, 1u) || ret.negated[i] > 1 ||
+           !valid_child(ret.children[2 * i], i + 1) || !valid_child(ret.children[2 * i + 1], i + 1)) {
+            return {};
+        }
+    }
+    return ret;
+}
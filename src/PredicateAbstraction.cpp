@@ -0,0 +1,39 @@
+#include "PredicateAbstraction.h"
+#include "SymbolicPredicate.hpp"
+#include <algorithm> // for std::is_sorted, std::sort, std::unique, std::set_union
+#include <iterator> // for std::back_inserter
+#include <utility>
+#include <vector>
+using namespace std;
+
+PredicateAbstraction::PredicateAbstraction(vector<SymbolicPredicate> predicates, bool contains_bottom) {
+    if(!is_sorted(predicates.begin(), predicates.end())) {
+        sort(predicates.begin(), predicates.end());
+    }
+    predicates.erase(unique(predicates.begin(), predicates.end()), predicates.end());
+    this->predicates = std::move(predicates);
+    this->contains_bottom = contains_bottom;
+}
+
+PredicateAbstraction PredicateAbstraction::withoutBottom() const {
+    PredicateAbstraction ret;
+    ret.predicates = predicates;
+    return ret;
+}
+
+PredicateAbstraction PredicateAbstraction::join(const PredicateAbstraction &e1, const PredicateAbstraction &e2) {
+    PredicateAbstraction ret;
+    ret.predicates.reserve(max(e1.predicates.size(), e2.predicates.size()));
+    // Both are sorted without duplicates, so the union is too (predicates in both are taken once, from e1)
+    set_union(e1.predicates.cbegin(), e1.predicates.cend(), e2.predicates.cbegin(), e2.predicates.cend(), back_inserter(ret.predicates));
+    ret.contains_bottom = e1.contains_bottom || e2.contains_bottom;
+    return ret;
+}
+
+bool PredicateAbstraction::operator ==(const PredicateAbstraction &right) const {
+    return contains_bottom == right.contains_bottom && predicates == right.predicates;
+}
+
+size_t PredicateAbstraction::memoryUsage() const {
+    return sizeof(*this) + predicates.capacity() * sizeof(SymbolicPredicate);
+}
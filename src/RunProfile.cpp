@@ -0,0 +1,215 @@
+#include "RunProfile.h"
+#include <cstdlib> // for std::malloc, std::free
+#include <iomanip> // for std::setprecision
+#include <new>
+#include <sstream>
+using namespace std;
+
+thread_local RunProfile *RunProfile::current_profile = NULL;
+thread_local uint64_t RunProfile::charged_bytes = 0;
+thread_local uint64_t RunProfile::thread_allocated_bytes = 0;
+
+static const RunProfile::Clock::time_point trace_epoch = RunProfile::Clock::now(); // Chrome trace timestamps count from here
+static atomic<unsigned int> num_traced_threads(0);
+static thread_local unsigned int traced_thread = num_traced_threads++;
+
+static const char *probe_names[] = {
+    "bestSplit", "filter", "filterNegated", "summary", "join", "combined",
+    "backwardsPosterior", "backwardsImpurity"
+};
+static_assert(sizeof(probe_names) / sizeof(probe_names[0]) == RunProfile::NUM_PROBES, "Every probe needs a name");
+static const unsigned int NUM_TIMED_PROBES = (unsigned int)RunProfile::Probe::BACKWARDS_POSTERIOR;
+
+#ifndef NO_PROFILING
+/**
+ * Counting what each thread allocates
+ */
+
+void* operator new(size_t size) {
+    RunProfile::thread_allocated_bytes += size;
+    if(size == 0) {
+        size = 1;
+    }
+    void *ret;
+    while((ret = malloc(size)) == NULL) {
+        new_handler handler = get_new_handler();
+        if(handler == NULL) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+    return ret;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+#endif
+
+/**
+ * Scope and Timer members
+ */
+
+RunProfile::Scope::Scope(RunProfile *profile) {
+#ifndef NO_PROFILING
+    charge();
+    previous = current_profile;
+    current_profile = profile;
+#endif
+}
+
+RunProfile::Scope::~Scope() {
+#ifndef NO_PROFILING
+    charge();
+    current_profile = previous;
+#endif
+}
+
+RunProfile::Timer::Timer(Probe probe) {
+    profile = current_profile;
+    this->probe = probe;
+    if(profile != NULL) {
+        start_bytes = thread_allocated_bytes;
+        start = Clock::now();
+    }
+}
+
+RunProfile::Timer::~Timer() {
+    if(profile != NULL) {
+        profile->record(probe, start, Clock::now(), thread_allocated_bytes - start_bytes);
+    }
+}
+
+/**
+ * RunProfile members
+ */
+
+RunProfile::RunProfile(bool record_events) {
+    for(array<atomic<uint64_t>, NUM_BUCKETS> &histogram : disjunct_counts) {
+        for(atomic<uint64_t> &count : histogram) {
+            count = 0;
+        }
+    }
+    allocated_bytes = 0;
+    thread = traced_thread;
+    this->record_events = record_events;
+    start = end = Clock::now();
+}
+
+void RunProfile::charge() {
+    if(current_profile != NULL) {
+        current_profile->allocated_bytes.fetch_add(thread_allocated_bytes - charged_bytes, memory_order_relaxed);
+    }
+    charged_bytes = thread_allocated_bytes;
+}
+
+const char* RunProfile::probeName(Probe probe) {
+    return probe_names[(unsigned int)probe];
+}
+
+void RunProfile::record(Probe probe, Clock::time_point start, Clock::time_point end, uint64_t bytes) {
+    Counter &counter = counters[(unsigned int)probe];
+    counter.calls.fetch_add(1, memory_order_relaxed);
+    counter.nanoseconds.fetch_add(chrono::duration_cast<chrono::nanoseconds>(end - start).count(), memory_order_relaxed);
+    counter.bytes.fetch_add(bytes, memory_order_relaxed);
+    if(record_events) {
+        lock_guard<mutex> lock(events_mutex);
+        events.push_back({probe, traced_thread, start, end});
+    }
+}
+
+void RunProfile::recordDisjuncts(int depth, size_t num_disjuncts) {
+    unsigned int level = min((unsigned int)max(depth, 0), MAX_DEPTH - 1);
+    unsigned int bucket = 0;
+    while(num_disjuncts > 1 && bucket < NUM_BUCKETS - 1) {
+        num_disjuncts >>= 1;
+        bucket++;
+    }
+    disjunct_counts[level][bucket].fetch_add(1, memory_order_relaxed);
+}
+
+uint64_t RunProfile::numReaching(int depth) const {
+    uint64_t ret = 0;
+    for(const atomic<uint64_t> &count : disjunct_counts[min((unsigned int)max(depth, 0), MAX_DEPTH - 1)]) {
+        ret += count;
+    }
+    return ret;
+}
+
+static string bucketName(unsigned int bucket) {
+    if(bucket == 0) {
+        return "1";
+    }
+    if(bucket == RunProfile::NUM_BUCKETS - 1) {
+        return to_string(1ull << bucket) + "+";
+    }
+    return to_string(1ull << bucket) + "-" + to_string((2ull << bucket) - 1);
+}
+
+static double toMilliseconds(uint64_t nanoseconds) {
+    return nanoseconds / 1e6;
+}
+
+static double toMicroseconds(RunProfile::Clock::duration duration) {
+    return chrono::duration_cast<chrono::nanoseconds>(duration).count() / 1e3;
+}
+
+string RunProfile::toJson() const {
+    stringstream out;
+    out << fixed << setprecision(3);
+    out << "{ \"wall_ms\" : " << toMilliseconds(chrono::duration_cast<chrono::nanoseconds>(end - start).count())
+        << ", \"allocated_bytes\" : " << allocated_bytes.load() << ", \"transformers\" : { ";
+    for(unsigned int i = 0; i < NUM_TIMED_PROBES; i++) {
+        out << (i > 0 ? ", " : "") << "\"" << probe_names[i] << "\" : { \"calls\" : " << counters[i].calls.load()
+            << ", \"ms\" : " << toMilliseconds(counters[i].nanoseconds.load()) << ", \"bytes\" : " << counters[i].bytes.load() << " }";
+    }
+    out << " }, \"backwards_intervals\" : { ";
+    for(unsigned int i = NUM_TIMED_PROBES; i < NUM_PROBES; i++) {
+        out << (i > NUM_TIMED_PROBES ? ", " : "") << "\"" << probe_names[i] << "\" : " << counters[i].calls.load();
+    }
+    // One histogram per level, up to the deepest one reached
+    out << " }, \"disjuncts_by_depth\" : [";
+    unsigned int num_levels = 0;
+    for(unsigned int level = 0; level < MAX_DEPTH; level++) {
+        for(const atomic<uint64_t> &count : disjunct_counts[level]) {
+            if(count.load() > 0) {
+                num_levels = level + 1;
+            }
+        }
+    }
+    for(unsigned int level = 0; level < num_levels; level++) {
+        out << (level > 0 ? ", " : " ") << "{";
+        bool first = true;
+        for(unsigned int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+            uint64_t count = disjunct_counts[level][bucket].load();
+            if(count > 0) {
+                out << (first ? " " : ", ") << "\"" << bucketName(bucket) << "\" : " << count;
+                first = false;
+            }
+        }
+        out << " }";
+    }
+    out << (num_levels > 0 ? " ] }" : "] }");
+    return out.str();
+}
+
+void RunProfile::appendChromeTraceEvents(string &out, int pid, const string &process_name) {
+    lock_guard<mutex> lock(events_mutex);
+    stringstream events_out;
+    events_out << fixed << setprecision(3);
+    events_out << "{ \"name\" : \"process_name\", \"ph\" : \"M\", \"pid\" : " << pid << ", \"args\" : { \"name\" : \"" << process_name << "\" } }";
+    events_out << ",\n{ \"name\" : \"run\", \"ph\" : \"X\", \"pid\" : " << pid << ", \"tid\" : " << thread
+               << ", \"ts\" : " << toMicroseconds(start - trace_epoch) << ", \"dur\" : " << toMicroseconds(end - start) << " }";
+    for(const Event &event : events) {
+        events_out << ",\n{ \"name\" : \"" << probeName(event.probe) << "\", \"ph\" : \"X\", \"pid\" : " << pid << ", \"tid\" : " << event.thread
+                   << ", \"ts\" : " << toMicroseconds(event.start - trace_epoch) << ", \"dur\" : " << toMicroseconds(event.end - event.start) << " }";
+    }
+    if(!out.empty()) {
+        out += ",\n";
+    }
+    out += events_out.str();
+}
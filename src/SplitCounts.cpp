@@ -0,0 +1,203 @@
+#include "SplitCounts.h"
+#include "DataColumns.h"
+#include "DataReferences.h"
+#include "RowBitset.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef __x86_64__
+#define SPLITCOUNTS_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Choosing between the AVX2 and scalar kernels
+ */
+
+static bool avx2Supported() {
+#ifdef SPLITCOUNTS_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#else
+    return false;
+#endif
+}
+
+static std::atomic<bool> use_avx2(avx2Supported());
+
+bool setSplitCountsVectorized(bool enabled) {
+    use_avx2 = enabled && avx2Supported();
+    return use_avx2;
+}
+
+/**
+ * Scalar kernels
+ */
+
+// Over n words, sets both = popcount(a & b) and all_three = popcount(a & b & c)
+static void countAnd(const uint64_t *a, const uint64_t *b, const uint64_t *c, unsigned int n, int &both, int &all_three) {
+    both = 0;
+    all_three = 0;
+    for(unsigned int i = 0; i < n; i++) {
+        uint64_t ab = a[i] & b[i];
+        both += __builtin_popcountll(ab);
+        all_three += __builtin_popcountll(ab & c[i]);
+    }
+}
+
+// Adds the first n rows to ret
+static void countThreshold(const float *values, const int *labels, const int *rows, unsigned int n, float lb, float ub, SplitCounts &ret) {
+    for(unsigned int i = 0; i < n; i++) {
+        float value = values[rows[i]];
+        int label = labels[rows[i]];
+        if(value <= lb) {
+            ret.satisfied[label]++;
+        } else if(value < ub) {
+            ret.maybe[label]++;
+        } else {
+            ret.unsatisfied[label]++;
+        }
+    }
+}
+
+/**
+ * AVX2 kernels (same contracts as the scalar ones)
+ */
+
+#ifdef SPLITCOUNTS_X86
+
+// Per 64-bit lane popcounts, by looking up each nibble (Mula's method)
+__attribute__((target("avx2")))
+static inline __m256i popcountEpi64(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(v, low_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t sumEpi64(__m256i v) {
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+}
+
+__attribute__((target("avx2,popcnt")))
+static void countAndAVX2(const uint64_t *a, const uint64_t *b, const uint64_t *c, unsigned int n, int &both, int &all_three) {
+    __m256i both_lanes = _mm256_setzero_si256();
+    __m256i all_three_lanes = _mm256_setzero_si256();
+    unsigned int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256i ab = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+        __m256i abc = _mm256_and_si256(ab, _mm256_loadu_si256((const __m256i *)(c + i)));
+        both_lanes = _mm256_add_epi64(both_lanes, popcountEpi64(ab));
+        all_three_lanes = _mm256_add_epi64(all_three_lanes, popcountEpi64(abc));
+    }
+    both = sumEpi64(both_lanes);
+    all_three = sumEpi64(all_three_lanes);
+    for(; i < n; i++) {
+        uint64_t ab = a[i] & b[i];
+        both += _mm_popcnt_u64(ab);
+        all_three += _mm_popcnt_u64(ab & c[i]);
+    }
+}
+
+__attribute__((target("avx2,popcnt")))
+static void countThresholdAVX2(const float *values, const int *labels, const int *rows, unsigned int n, float lb, float ub, SplitCounts &ret) {
+    const __m256 lbs = _mm256_set1_ps(lb);
+    const __m256 ubs = _mm256_set1_ps(ub);
+    const int num_categories = ret.satisfied.size();
+    unsigned int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i row8 = _mm256_loadu_si256((const __m256i *)(rows + i));
+        __m256 value8 = _mm256_i32gather_ps(values, row8, 4);
+        __m256i label8 = _mm256_i32gather_epi32(labels, row8, 4);
+        // One bit per lane
+        int satisfied = _mm256_movemask_ps(_mm256_cmp_ps(value8, lbs, _CMP_LE_OQ));
+        int below_ub = _mm256_movemask_ps(_mm256_cmp_ps(value8, ubs, _CMP_LT_OQ));
+        int maybe = below_ub & ~satisfied;
+        int unsatisfied = ~(satisfied | below_ub) & 0xff;
+        for(int label = 0; label < num_categories; label++) {
+            int has_label = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(label8, _mm256_set1_epi32(label))));
+            ret.satisfied[label] += _mm_popcnt_u32(has_label & satisfied);
+            ret.maybe[label] += _mm_popcnt_u32(has_label & maybe);
+            ret.unsatisfied[label] += _mm_popcnt_u32(has_label & unsatisfied);
+        }
+    }
+    countThreshold(values, labels, rows + i, n - i, lb, ub, ret);
+}
+
+#endif
+
+/**
+ * The kernels proper
+ */
+
+static SplitCounts emptySplitCounts(int num_categories) {
+    return { std::vector<int>(num_categories, 0), std::vector<int>(num_categories, 0), std::vector<int>(num_categories, 0) };
+}
+
+SplitCounts countBooleanSplit(const DataReferences &references, unsigned int feature_index) {
+    SplitCounts ret = emptySplitCounts(references.getNumCategories());
+    const DataColumns &columns = references.getColumns();
+    const RowBitset &members = references.getMembers();
+    const std::vector<RowBitset> &label_rows = columns.labelRows();
+
+    if(references.size() >= members.numWords() * label_rows.size()) {
+        // Cheaper to intersect bitmaps a word at a time (as in DataReferences::labelCounts)
+        const RowBitset &true_rows = columns.booleanRows(feature_index);
+        for(unsigned int label = 0; label < ret.satisfied.size() && label < label_rows.size(); label++) {
+            int total, satisfied;
+#ifdef SPLITCOUNTS_X86
+            if(use_avx2) {
+                countAndAVX2(members.data(), label_rows[label].data(), true_rows.data(), members.numWords(), total, satisfied);
+            } else
+#endif
+            countAnd(members.data(), label_rows[label].data(), true_rows.data(), members.numWords(), total, satisfied);
+            ret.satisfied[label] = satisfied;
+            ret.unsatisfied[label] = total - satisfied;
+        }
+        return ret;
+    }
+
+    const RowBitset &true_rows = columns.booleanRows(feature_index);
+    const int *labels = columns.labelColumn();
+    const std::vector<int> &rows = references.getIndices();
+    for(std::size_t begin = 0; begin < rows.size(); begin += DataColumns::CHUNK_ROWS) {
+        std::size_t end = std::min(rows.size(), begin + DataColumns::CHUNK_ROWS);
+        if(end < rows.size()) {
+            columns.willNeed(feature_index, rows[end], rows[std::min(rows.size(), end + DataColumns::CHUNK_ROWS) - 1] + 1);
+        }
+        for(std::size_t i = begin; i < end; i++) {
+            (true_rows.test(rows[i]) ? ret.satisfied : ret.unsatisfied)[labels[rows[i]]]++;
+        }
+    }
+    return ret;
+}
+
+SplitCounts countThresholdSplit(const DataReferences &references, unsigned int feature_index, float lb, float ub) {
+    SplitCounts ret = emptySplitCounts(references.getNumCategories());
+    const DataColumns &columns = references.getColumns();
+    const std::vector<int> &rows = references.getIndices();
+    // A chunk at a time, hinting the next chunk's rows while this one is counted (see DataColumns::willNeed);
+    // the counts don't depend on the chunking
+    for(std::size_t begin = 0; begin < rows.size(); begin += DataColumns::CHUNK_ROWS) {
+        std::size_t end = std::min(rows.size(), begin + DataColumns::CHUNK_ROWS);
+        if(end < rows.size()) {
+            columns.willNeed(feature_index, rows[end], rows[std::min(rows.size(), end + DataColumns::CHUNK_ROWS) - 1] + 1);
+        }
+#ifdef SPLITCOUNTS_X86
+        if(use_avx2) {
+            countThresholdAVX2(columns.numericColumn(feature_index), columns.labelColumn(), rows.data() + begin, end - begin, lb, ub, ret);
+            continue;
+        }
+#endif
+        countThreshold(columns.numericColumn(feature_index), columns.labelColumn(), rows.data() + begin, end - begin, lb, ub, ret);
+    }
+    return ret;
+}
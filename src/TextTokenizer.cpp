@@ -0,0 +1,87 @@
+#include "TextTokenizer.h"
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool readWholeFile(const std::string &path, std::string &contents) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file.is_open()) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    if(size < 0) {
+        return false;
+    }
+    contents.resize(size);
+    file.seekg(0);
+    return (bool)file.read(&contents[0], size);
+}
+
+std::vector<TextLine> splitLines(const char *begin, const char *end, unsigned int first_line_number) {
+    std::vector<TextLine> ret;
+    unsigned int number = first_line_number;
+    const char *line_begin = begin;
+    while(line_begin < end) {
+        const char *line_end = line_begin;
+        while(line_end < end && *line_end != '\n') {
+            line_end++;
+        }
+        const char *next = line_end + 1;
+        if(line_end > line_begin && *(line_end - 1) == '\r') {
+            line_end--;
+        }
+        const char *content = line_begin;
+        while(content < line_end && (isBlank(*content) || *content == '\n')) {
+            content++;
+        }
+        if(content < line_end) {
+            ret.push_back({ line_begin, line_end, number });
+        }
+        number++;
+        line_begin = next;
+    }
+    return ret;
+}
+
+void trimField(const char *&begin, const char *&end) {
+    while(begin < end && isBlank(*begin)) {
+        begin++;
+    }
+    while(end > begin && isBlank(*(end - 1))) {
+        end--;
+    }
+}
+
+bool parseFloatField(const char *begin, const char *end, float &value) {
+    trimField(begin, end);
+    if(begin < end && *begin == '+') {
+        begin++;
+        if(begin < end && *begin == '-') { // "+-1" isn't a number
+            return false;
+        }
+    }
+    if(begin == end) {
+        return false;
+    }
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+void reportIssues(const std::vector<TextIssue> &issues, Error *err_handler, bool fatal) {
+    for(auto i = issues.cbegin(); i != issues.cend(); i++) {
+        if(fatal && i->column == 0) {
+            err_handler->fatal(i->line, i->message);
+        } else if(fatal) {
+            err_handler->fatal(i->line, i->column, i->message);
+        } else if(i->column == 0) {
+            err_handler->warning(i->line, i->message);
+        } else {
+            err_handler->warning(i->line, i->column, i->message);
+        }
+    }
+}
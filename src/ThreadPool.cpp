@@ -0,0 +1,203 @@
+#include "ThreadPool.h"
+#include "RunProfile.h"
+#include <algorithm> // for std::min
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Lets a worker find its own deque (and tells external threads apart from workers)
+static thread_local const ThreadPool *current_pool = NULL;
+static thread_local unsigned int current_index = 0;
+
+/**
+ * ThreadPool members
+ */
+
+ThreadPool::ThreadPool(unsigned int num_threads) {
+    if(num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    next_queue = 0;
+    num_queued = 0;
+    stopping = false;
+    for(unsigned int i = 0; i < num_threads; i++) {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue));
+    }
+    // Only start the threads once every queue exists, since workers steal from each other
+    for(unsigned int i = 0; i < num_threads; i++) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    for(auto i = workers.begin(); i != workers.end(); i++) {
+        i->join();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    current_pool = this;
+    current_index = index;
+    while(true) {
+        Task task;
+        if(popOwn(index, task) || steal(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [this]{ return stopping || num_queued > 0; });
+        if(stopping && num_queued <= 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popOwn(unsigned int index, Task &task) {
+    WorkerQueue &queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    num_queued--;
+    return true;
+}
+
+bool ThreadPool::steal(unsigned int thief, Task &task) {
+    // thief == size() means "not a worker", so every queue is a candidate
+    for(unsigned int offset = 1; offset <= queues.size(); offset++) {
+        unsigned int victim = (thief + offset) % queues.size();
+        if(victim == thief) {
+            continue;
+        }
+        WorkerQueue &queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            num_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::submit(Task task) {
+    unsigned int target = inWorkerThread() ? current_index : (next_queue++ % queues.size());
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Incrementing under sleep_mutex means a worker can't miss the wakeup
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        num_queued++;
+    }
+    sleep_cv.notify_one();
+}
+
+bool ThreadPool::tryRunPendingTask() {
+    Task task;
+    bool found;
+    if(inWorkerThread()) {
+        found = popOwn(current_index, task) || steal(current_index, task);
+    } else {
+        found = steal(queues.size(), task);
+    }
+    if(found) {
+        task();
+    }
+    return found;
+}
+
+bool ThreadPool::inWorkerThread() const {
+    return current_pool == this;
+}
+
+/**
+ * TaskGroup members
+ */
+
+TaskGroup::TaskGroup(ThreadPool *pool) {
+    this->pool = pool;
+    pending = 0;
+}
+
+void TaskGroup::run(ThreadPool::Task task) {
+    if(pool == NULL) {
+        task();
+        return;
+    }
+    pending++;
+    // The task works on the same run as whoever queued it, whichever thread picks it up
+    RunProfile *profile = RunProfile::current();
+    pool->submit([this, task, profile]() {
+        RunProfile::Scope scope(profile);
+        try {
+            task();
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            if(!first_exception) {
+                first_exception = std::current_exception();
+            }
+        }
+        pending--;
+    });
+}
+
+void TaskGroup::drain() {
+    while(pending > 0) {
+        if(!pool->tryRunPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::wait() {
+    drain();
+    std::lock_guard<std::mutex> lock(exception_mutex);
+    if(first_exception) {
+        std::exception_ptr to_throw = first_exception;
+        first_exception = NULL;
+        std::rethrow_exception(to_throw);
+    }
+}
+
+/**
+ * Non-member helpers
+ */
+
+void parallelFor(ThreadPool *pool, std::size_t begin, std::size_t end, std::size_t grain_size,
+                 const std::function<void(std::size_t)> &f) {
+    if(grain_size == 0) {
+        grain_size = 1;
+    }
+    if(pool == NULL || end - begin <= grain_size) {
+        for(std::size_t i = begin; i < end; i++) {
+            f(i);
+        }
+        return;
+    }
+    // A few chunks per worker gives stealing something to balance with
+    std::size_t num_chunks = std::min((end - begin + grain_size - 1) / grain_size, (std::size_t)pool->size() * 4);
+    std::size_t chunk_size = (end - begin + num_chunks - 1) / num_chunks;
+    TaskGroup group(pool);
+    for(std::size_t chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size) {
+        std::size_t chunk_end = std::min(end, chunk_begin + chunk_size);
+        group.run([chunk_begin, chunk_end, &f]() {
+            for(std::size_t i = chunk_begin; i < chunk_end; i++) {
+                f(i);
+            }
+        });
+    }
+    group.wait();
+}
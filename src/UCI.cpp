@@ -1,8 +1,7 @@
 #include "UCI.h"
+#include "TextTokenizer.h"
 #include <algorithm>
-#include <fstream>
 #include <set>
-#include <sstream>
 #include <string>
 #include <vector>
 using namespace std;
@@ -13,74 +12,84 @@ UCI::UCI(const UCINames &name, const string &prefix) {
     loadFromFile(prefix + "/" + details->test_file_name, &test_data);
 }
 
-void UCI::setDetails(const UCINames &name) {
+const UCIDetails& UCI::getDetails(const UCINames &name) {
     switch(name) {
         case UCINames::IRIS:
-            details = &UCI_IRIS_DETAILS;
-            break;
+            return UCI_IRIS_DETAILS;
         case UCINames::CANCER:
-            details = &UCI_CANCER_DETAILS;
-            break;
+            return UCI_CANCER_DETAILS;
         case UCINames::WINE:
-            details = &UCI_WINE_DETAILS;
-            break;
+            return UCI_WINE_DETAILS;
         case UCINames::YEAST:
-            details = &UCI_YEAST_DETAILS;
-            break;
+            return UCI_YEAST_DETAILS;
         case UCINames::RETINOPATHY:
-            details = &UCI_RETINOPATHY_DETAILS;
-            break;
+            return UCI_RETINOPATHY_DETAILS;
         case UCINames::MAMMOGRAPHY:
-            details = &UCI_MAMMOGRAPHY_DETAILS;
-            break;
+            return UCI_MAMMOGRAPHY_DETAILS;
         case UCINames::ADULT_INCOME:
-            details = &UCI_ADULT_INCOME_DETAILS;
-            break;
+            return UCI_ADULT_INCOME_DETAILS;
         case UCINames::GERMAN_LOAN:
-            details = &UCI_GERMAN_LOAN_DETAILS;
-            break;
+            return UCI_GERMAN_LOAN_DETAILS;
         case UCINames::COMPAS:
-            details = &UCI_COMPAS_DETAILS;
-            break;
+            return UCI_COMPAS_DETAILS;
         case UCINames::DRUG_CONSUMPTION:
-            details = &UCI_DRUG_CONSUMPTION_DETAILS;
-            break;
+            return UCI_DRUG_CONSUMPTION_DETAILS;
     }
+    return UCI_IRIS_DETAILS; // XXX shouldn't happen---it's here to suppress a warning
 }
 
-void UCI::loadFromFile(const std::string &filepath, std::vector<CSVRow> *data) {
-    ifstream file;
-    file.open(filepath);
-    string line;
-    // XXX we just stop reading after we run out of lines
-    // without checking if it matches the expected details
-    // (which maybe are unnecessary?)
-    while(getline(file, line)) {
-        CSVRow temp;
-        parseLine(temp, line); // Handles accruing the output class labels, too
-        data->push_back(temp);
+void UCI::setDetails(const UCINames &name) {
+    details = &getDetails(name);
+    column_targets = std::vector<int>(details->num_cols, IGNORED_COLUMN);
+    num_features = 0;
+    for(int i = 0; i < details->num_cols; i++) {
+        if(i == details->label_index) {
+            column_targets[i] = LABEL_COLUMN;
+        } else if(std::none_of(details->indices_to_ignore.cbegin(), details->indices_to_ignore.cend(), [i](int j){ return i == j; })) {
+            column_targets[i] = num_features++;
+        }
     }
-    file.close();
 }
 
-void UCI::parseLine(CSVRow &csv_row, const std::string &comma_separated_line) {
-    vector<string> items;
-    istringstream iss(comma_separated_line);
-    string item;
-    while(getline(iss, item, ',')) {
-        items.push_back(item);
+void UCI::loadFromFile(const std::string &filepath, std::vector<CSVRow> *data) {
+    std::string contents;
+    if(!readWholeFile(filepath, contents)) {
+        err_handler.fatal("Cannot open " + filepath);
+        return;
     }
-    //  assuming that items.size() is consistent with details->num_cols
-    csv_row.x = vector<float>(0);
-    for(int i = 0; i < details->num_cols; i++) {
-        if(std::none_of(details->indices_to_ignore.cbegin(), details->indices_to_ignore.cend(), [i](int j){ return i == j; })) {
-            //  for better precision, add something here to keep track of whether this label can be flipped 
-            if(i == details->label_index) {
-                csv_row.y = items[i];
-                labels.insert(items[i]);
-            } else {
-                csv_row.x.push_back(stof(items[i]));
-            }
+    std::vector<TextLine> lines = splitLines(contents.data(), contents.data() + contents.size());
+    std::vector<TextIssue> issues;
+    parseLines(lines, [this](const TextLine &line, CSVRow &csv_row, std::vector<TextIssue> &issues) {
+        return parseLine(line, csv_row, issues);
+    }, *data, issues);
+    reportIssues(issues, &err_handler, false);
+    // Handles accruing the output class labels
+    for(auto i = data->cbegin(); i != data->cend(); i++) {
+        labels.insert(i->y);
+    }
+}
+
+bool UCI::parseLine(const TextLine &line, CSVRow &csv_row, std::vector<TextIssue> &issues) const {
+    csv_row.x = vector<float>(num_features);
+    bool ok = true;
+    unsigned int num_fields = forEachField(line, ',', [this, &line, &csv_row, &issues, &ok](unsigned int column, const char *begin, const char *end) {
+        if(column >= column_targets.size()) {
+            return false; // Anything past num_cols is ignored
+        }
+        int target = column_targets[column];
+        if(target == LABEL_COLUMN) {
+            //  for better precision, add something here to keep track of whether this label can be flipped
+            csv_row.y.assign(begin, end);
+        } else if(target != IGNORED_COLUMN && !parseFloatField(begin, end, csv_row.x[target])) {
+            issues.push_back({ line.number, column + 1, "Invalid number: " + std::string(begin, end) });
+            ok = false;
+            return false;
         }
+        return true;
+    });
+    if(ok && num_fields < column_targets.size()) {
+        issues.push_back({ line.number, 0, "Expected " + to_string(column_targets.size()) + " columns, but only read " + to_string(num_fields) });
+        ok = false;
     }
+    return ok;
 }
@@ -1,11 +1,11 @@
 #include "information_math.h"
 #include "CategoricalDistribution.hpp"
 #include "Interval.h"
+#include "RunProfile.h"
 #include <algorithm> // for std::max/min
 #include <numeric> // for std::accumulate (easy summations)
 #include <utility>
 #include <vector>
-#include <iostream>
 using namespace std;
 
 double estimateBernoulli0(const BinarySamples &counts) {
@@ -22,8 +22,6 @@ Interval<double> estimateBernoulli(const BinarySamples &counts, int num_dropout,
         return Interval<double>(0, 1);
     }
 
-    std::cout << "I AM HERE" << std::endl;
-
     // Since this is effectively computing an average of a collection of 0s and 1s,
     // extremal behavior occurs either when maximally many 1s are removed
     // or when maximally many 0s are removed.
@@ -101,23 +99,16 @@ double jointImpurity(const vector<int> &counts1, const vector<int> &counts2) {
     return total1 * impurity(counts1) + total2 * impurity(counts2);
 }
 
-CategoricalDistribution<Interval<double>> estimateCategorical(const std::vector<int> &counts, int num_dropout, int num_add, int num_labels_flip, int num_features_flip, std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
-    int count_total = accumulate(counts.cbegin(), counts.cend(), 0);
-    // When num_dropout >= count_total, anything is possible.
-    // In the == case, this is because we assume estimating from an empty set is undefined behavior.
-    if(count_total <= num_dropout + num_labels_flip) {
-        return CategoricalDistribution<Interval<double>>(counts.size(), Interval<double>(0,1));
-    }
-
-    CategoricalDistribution<Interval<double>> ret(counts.size());
+// The nontrivial case of the abstract estimate, shared by the std::vector and fixed-arity versions:
+// only counts[0] and counts[1] are ever looked at
+static FixedCategoricalDistribution<Interval<double>, 2> estimateBinaryCategorical(int count0, int count1, int count_total, int num_dropout, int num_add, int num_labels_flip, int num_features_flip, std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
+    FixedCategoricalDistribution<Interval<double>, 2> ret;
     // We estimate each component individually.
     // Since this is effectively computing an average of a collection of 0s and 1s,
     // extremal behavior occurs either when maximally many 1s are removed
     // or when maximally many 0s are removed.
     // (This is more precise than the obvious count-interval division)    
-    
-    int count0 = counts[0];
-    int count1 = counts[1];
+
     BinarySamples minimizer, maximizer;
     //maximizer.num_ones = min(count1 + num_labels_flip + num_add, count0 + count1 + num_add); // AI can flip from 0 to 1
     //maximizer.num_zeros = max(0, count0 - num_dropout - num_labels_flip); // AI can flip from 0 to 1
@@ -148,20 +139,34 @@ CategoricalDistribution<Interval<double>> estimateCategorical(const std::vector<
     ret[0] = Interval<double>(estimateBernoulli0(maximizer), estimateBernoulli0(minimizer));
     ret[1] = Interval<double>(estimateBernoulli(minimizer), estimateBernoulli(maximizer));
 
+    // These shouldn't happen; count them (see RunProfile) rather than trust them
     if (ret[0].get_upper_bound() < ret[0].get_lower_bound()) {
-        std::cout << "PROBLEM INTERVAL IS BACKWARDS (0)" << std::endl;
-        std::cout << "count0: " << std::to_string(count0) << ", count1: " << std::to_string(count1) << std::endl;
-        std::cout << "max.num0: " << std::to_string(maximizer.num_zeros) << ", max.num1: " << std::to_string(maximizer.num_ones) << ", min.num0: " << std::to_string(minimizer.num_zeros) << ", min.num1: " << std::to_string(minimizer.num_ones) << std::endl;
+        PROFILE_COUNT(BACKWARDS_POSTERIOR);
     }
     if (ret[1].get_upper_bound() < ret[1].get_lower_bound()) {
-        std::cout << "PROBLEM INTERVAL IS BACKWARDS (1)" << std::endl;
-        std::cout << "count0: " << std::to_string(count0) << ", count1: " << std::to_string(count1) << std::endl;
-
+        PROFILE_COUNT(BACKWARDS_POSTERIOR);
     }
     
     return ret; 
 }
 
+CategoricalDistribution<Interval<double>> estimateCategorical(const std::vector<int> &counts, int num_dropout, int num_add, int num_labels_flip, int num_features_flip, std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
+    int count_total = accumulate(counts.cbegin(), counts.cend(), 0);
+    // When num_dropout >= count_total, anything is possible.
+    // In the == case, this is because we assume estimating from an empty set is undefined behavior.
+    if(count_total <= num_dropout + num_labels_flip) {
+        return CategoricalDistribution<Interval<double>>(counts.size(), Interval<double>(0,1));
+    }
+
+    // Any components past the first two are left empty
+    CategoricalDistribution<Interval<double>> ret(counts.size());
+    FixedCategoricalDistribution<Interval<double>, 2> binary = estimateBinaryCategorical(counts[0], counts[1], count_total, num_dropout, num_add,
+                                                                    num_labels_flip, num_features_flip, label_sens_info, add_sens_info);
+    ret[0] = binary[0];
+    ret[1] = binary[1];
+    return ret;
+}
+
 Interval<double> impurity(const std::vector<int> &counts, int num_dropout, int num_add, int num_labels_flip, int num_features_flip, std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
     // TODO can be more precise
     CategoricalDistribution<Interval<double>> p = estimateCategorical(counts, num_dropout, num_add, num_labels_flip, num_features_flip, label_sens_info, add_sens_info);
@@ -182,10 +187,46 @@ Interval<double> jointImpurity(const std::vector<int> &counts1, int num_dropout1
     // one-sided can be more precise
     Interval<double> size1(total1 - num_dropout1, total1 + num_add1);
     Interval<double> size2(total2 - num_dropout2, total2 + num_add2);
-    Interval<double> imp = impurity(counts1, num_dropout1, num_add1, num_labels_flip1, num_features_flip2, label_sens_info, add_sens_info);
-    if (imp.get_upper_bound() < imp.get_lower_bound()) {
-        std::cout << "impurity.lower: " << std::to_string(imp.get_lower_bound()) << ", impurity.upper: " << std::to_string(imp.get_upper_bound()) << std::endl;
+    Interval<double> imp1 = impurity(counts1, num_dropout1, num_add1, num_labels_flip1, num_features_flip2, label_sens_info, add_sens_info);
+    if (imp1.get_upper_bound() < imp1.get_lower_bound()) {
+        PROFILE_COUNT(BACKWARDS_IMPURITY);
     }
-    return size1 * impurity(counts1, num_dropout1, num_add1, num_labels_flip1, num_features_flip2, label_sens_info, add_sens_info) + 
+    return size1 * imp1 +
             size2 * impurity(counts2, num_dropout2, num_add2, num_labels_flip2, num_features_flip2, label_sens_info, add_sens_info);
-}
\ No newline at end of file
+}
+
+/**
+ * Fixed-arity (K = 2) abstract kernels
+ */
+
+FixedCategoricalDistribution<Interval<double>, 2> estimateCategorical(const CategoryCounts<2> &counts, int num_dropout, int num_add, int num_labels_flip, int num_features_flip, std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
+    int count_total = counts[0] + counts[1];
+    if(count_total <= num_dropout + num_labels_flip) {
+        return {Interval<double>(0,1), Interval<double>(0,1)};
+    }
+    return estimateBinaryCategorical(counts[0], counts[1], count_total, num_dropout, num_add, num_labels_flip, num_features_flip, label_sens_info, add_sens_info);
+}
+
+Interval<double> impurity(const CategoryCounts<2> &counts, int num_dropout, int num_add, int num_labels_flip, int num_features_flip, std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
+    FixedCategoricalDistribution<Interval<double>, 2> p = estimateCategorical(counts, num_dropout, num_add, num_labels_flip, num_features_flip, label_sens_info, add_sens_info);
+    Interval<double> total(0);
+    total = total + (p[0] * (Interval<double>(1) - p[0]));
+    total = total + (p[1] * (Interval<double>(1) - p[1]));
+    return total;
+}
+
+Interval<double> jointImpurity(const CategoryCounts<2> &counts1, int num_dropout1, int num_add1, int num_labels_flip1, int num_features_flip1,
+                              const CategoryCounts<2> &counts2, int num_dropout2, int num_add2, int num_labels_flip2, int num_features_flip2,
+                              std::pair<int, int> label_sens_info, std::pair<int, int> add_sens_info) {
+    int total1 = counts1[0] + counts1[1];
+    int total2 = counts2[0] + counts2[1];
+    Interval<double> size1(total1 - num_dropout1, total1 + num_add1);
+    Interval<double> size2(total2 - num_dropout2, total2 + num_add2);
+    // Same arguments as the std::vector version (num_features_flip2 for both sides included), but the first impurity is only computed once
+    Interval<double> imp1 = impurity(counts1, num_dropout1, num_add1, num_labels_flip1, num_features_flip2, label_sens_info, add_sens_info);
+    if (imp1.get_upper_bound() < imp1.get_lower_bound()) {
+        PROFILE_COUNT(BACKWARDS_IMPURITY);
+    }
+    return size1 * imp1 +
+            size2 * impurity(counts2, num_dropout2, num_add2, num_labels_flip2, num_features_flip2, label_sens_info, add_sens_info);
+}
@@ -0,0 +1,50 @@
+#ifndef SYNTHETICDATASET_HPP
+#define SYNTHETICDATASET_HPP
+
+/**
+ * Small seeded data sets for the tests that compare two ways of computing the same thing.
+ * Each feature's values are drawn from a few levels so that ties (and so maybes and flip bands) are common:
+ * a numeric feature is uniform over {0, 1/scale, ..., (levels - 1)/scale},
+ * and a boolean one is true with probability 1/levels.
+ * The label of each row is then a function of its index and features.
+ */
+
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include <functional>
+#include <vector>
+
+struct SyntheticFeature {
+    FeatureType type;
+    unsigned int levels;
+    float scale = 1;
+};
+
+inline DataSet makeSyntheticDataSet(unsigned int num_rows, unsigned int seed, const std::vector<SyntheticFeature> &features,
+                                    int num_categories, const std::function<int(unsigned int, const FeatureVector &)> &label) {
+    FeatureVectorHeader header;
+    for(auto f = features.cbegin(); f != features.cend(); f++) {
+        header.push_back(f->type);
+    }
+    std::vector<DataRow> rows(num_rows);
+    for(unsigned int i = 0; i < num_rows; i++) {
+        rows[i].x = FeatureVector(features.size());
+        for(unsigned int f = 0; f < features.size(); f++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned int level = (seed >> 16) % features[f].levels;
+            switch(features[f].type) {
+                // XXX need to make changes here if adding new feature types
+                case FeatureType::BOOLEAN:
+                    rows[i].x[f] = (level == 0);
+                    break;
+                case FeatureType::NUMERIC:
+                    rows[i].x[f] = (float)level / features[f].scale;
+                    break;
+            }
+        }
+        rows[i].y = label(i, rows[i].x);
+    }
+    return { header, num_categories, rows };
+}
+
+#endif
@@ -1,4 +1,6 @@
 #define CATCH_CONFIG_MAIN
+// The bundled Catch2 predates glibc 2.34, where MINSIGSTKSZ stopped being a constant
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
 
 // Catch2 requires a single source file to use the above #define.
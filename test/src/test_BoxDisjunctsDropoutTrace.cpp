@@ -0,0 +1,47 @@
+#include "catch.hpp"
+#include "AbstractSemanticsInstantiations.hpp"
+#include "ASTNode.h"
+#include "BoxDisjunctsDropoutTrace.h"
+#include "DataReferences.h"
+#include "DataSet.hpp"
+#include "DropoutDomains.hpp"
+#include "Feature.hpp"
+#include "SyntheticDataSet.hpp"
+#include <vector>
+using namespace std;
+
+TEST_CASE("Replaying a BoxDisjunctsDropoutTrace agrees with the disjuncts semantics") {
+    // The abstract summary only handles binary labels
+    DataSet data_set = makeSyntheticDataSet(40, 7, { {FeatureType::NUMERIC, 8}, {FeatureType::NUMERIC, 5, 2}, {FeatureType::BOOLEAN, 3} }, 2,
+        [](unsigned int i, const FeatureVector &x) { return (x[0].getNumericValue() > 3) != (i % 5 == 0); });
+
+    for(int depth = 0; depth <= 2; depth++) {
+        DataReferences training_references(&data_set);
+        BoxDisjunctsDropoutTrace::Single initial_box = {
+            TrainingReferencesWithDropout(training_references, 2, 0, {-1, 0}, 1, {-1, 0}, 0, -1, 0),
+            PredicateAbstraction::onlyBottom(),
+            PosteriorDistributionAbstraction(1)
+        };
+        BoxDisjunctsDropoutTrace trace(initial_box, depth, NULL);
+
+        ProgramNode *program = buildTree(depth);
+        DropoutDomains d;
+        BoxDisjunctsDropoutSemantics sem(&d.disjuncts_domain);
+        for(unsigned int i = 0; i < data_set.rows.size(); i++) {
+            const FeatureVector &x = data_set.rows[i].x;
+            auto final_state = sem.execute(x, {initial_box}, program);
+            vector<PosteriorDistributionAbstraction> posteriors;
+            for(auto j = final_state.cbegin(); j != final_state.cend(); j++) {
+                posteriors.push_back(j->posterior_distribution_abstraction);
+            }
+            PosteriorDistributionAbstraction expected = d.D_domain.join(posteriors);
+            PosteriorDistributionAbstraction replayed = trace.run(x);
+
+            REQUIRE(replayed.size() == expected.size());
+            for(unsigned int j = 0; j < expected.size(); j++) {
+                REQUIRE(replayed[j] == expected[j]);
+            }
+        }
+        delete program;
+    }
+}
@@ -0,0 +1,208 @@
+#include "catch.hpp"
+#include "AbstractSemanticsInstantiations.hpp"
+#include "ASTNode.h"
+#include "BoxStateDomainDropoutInstantiation.h"
+#include "DataReferences.h"
+#include "DataSet.hpp"
+#include "DropoutDomains.hpp"
+#include "Feature.hpp"
+#include "PredicateAbstraction.h"
+#include "SymbolicPredicate.hpp"
+#include "SyntheticDataSet.hpp"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+TEST_CASE("Filtering by several predicates agrees with joining the filters one predicate at a time") {
+    DataSet data_set = makeSyntheticDataSet(60, 11, { {FeatureType::NUMERIC, 10}, {FeatureType::NUMERIC, 7, 2}, {FeatureType::BOOLEAN, 4} }, 3,
+        [](unsigned int i, const FeatureVector &x) { return i % 3; });
+
+    DataReferences all(&data_set);
+    vector<bool> keep(all.size());
+    for(unsigned int i = 0; i < keep.size(); i++) {
+        keep[i] = (i % 5 != 2);
+    }
+    DataReferences some = all;
+    some.filter(keep);
+
+    // Thresholds given out of order, overlapping, on both numeric features, and a boolean one
+    PredicateAbstraction predicates({
+        SymbolicPredicate(0, 4, 5), SymbolicPredicate(1, 1, 1.5), SymbolicPredicate(0, 1, 2),
+        SymbolicPredicate(2), SymbolicPredicate(0, 6.5, 7), SymbolicPredicate(1, 0, 3), SymbolicPredicate(0, 2, 2)
+    });
+    DropoutDomains d;
+    for(int flip_index = -1; flip_index <= 1; flip_index++) {
+        for(const DataReferences &references : {all, some}) {
+            TrainingReferencesWithDropout T(references, 3, 0, {-1, 0}, 2, {-1, 0}, 2, flip_index, 1.5);
+            for(bool positive_flag : {true, false}) {
+                vector<TrainingReferencesWithDropout> joins;
+                for(auto i = predicates.cbegin(); i != predicates.cend(); i++) {
+                    joins.push_back(T.filter(*i, positive_flag));
+                }
+                TrainingReferencesWithDropout expected = d.T_domain.join(joins);
+                TrainingReferencesWithDropout actual = positive_flag ? d.box_domain.filter(T, predicates) : d.box_domain.filterNegated(T, predicates);
+                REQUIRE(actual.training_references.getIndices() == expected.training_references.getIndices());
+                REQUIRE(PackedTrainingReferencesWithDropout(actual) == PackedTrainingReferencesWithDropout(expected));
+            }
+        }
+    }
+}
+
+TEST_CASE("The disjuncts domain gives the same disjuncts, in the same order, on a thread pool") {
+    // The abstract summary only handles binary labels
+    DataSet data_set = makeSyntheticDataSet(50, 3, { {FeatureType::NUMERIC, 9}, {FeatureType::NUMERIC, 6, 2}, {FeatureType::BOOLEAN, 3} }, 2,
+        [](unsigned int i, const FeatureVector &x) { return (x[0].getNumericValue() > 4) != (i % 7 == 0); });
+
+    ProgramNode *program = buildTree(2);
+    DataReferences training_references(&data_set);
+    BoxDropoutDomain::AbstractionType initial_box = {
+        TrainingReferencesWithDropout(training_references, 2, 0, {-1, 0}, 1, {-1, 0}, 0, -1, 0),
+        PredicateAbstraction::onlyBottom(),
+        PosteriorDistributionAbstraction(1)
+    };
+    ThreadPool pool(4);
+    DropoutDomains serial, parallel;
+    parallel.disjuncts_domain.setThreadPool(&pool);
+    BoxDisjunctsDropoutSemantics serial_sem(&serial.disjuncts_domain), parallel_sem(&parallel.disjuncts_domain);
+    for(unsigned int i = 0; i < data_set.rows.size(); i += 5) {
+        const FeatureVector &x = data_set.rows[i].x;
+        auto expected = serial_sem.execute(x, {initial_box}, program);
+        auto actual = parallel_sem.execute(x, {initial_box}, program);
+        REQUIRE(actual.size() == expected.size());
+        for(unsigned int j = 0; j < expected.size(); j++) {
+            REQUIRE(PackedTrainingReferencesWithDropout(actual[j].training_set_abstraction) == PackedTrainingReferencesWithDropout(expected[j].training_set_abstraction));
+            REQUIRE(actual[j].predicate_abstraction == expected[j].predicate_abstraction);
+            REQUIRE(actual[j].posterior_distribution_abstraction.size() == expected[j].posterior_distribution_abstraction.size());
+            for(unsigned int k = 0; k < expected[j].posterior_distribution_abstraction.size(); k++) {
+                REQUIRE(actual[j].posterior_distribution_abstraction[k] == expected[j].posterior_distribution_abstraction[k]);
+            }
+        }
+    }
+    delete program;
+}
+
+TEST_CASE("Predicate abstractions are canonical sets, and bot is tracked apart from the predicates") {
+    SymbolicPredicate a(0, 1, 2), b(0, 2, 3), c(1), d(2, 0, 0.5);
+    PredicateAbstraction e1({d, a, c, a}), e2({b, d}, true);
+    REQUIRE(e1 == PredicateAbstraction({a, c, d}));
+    REQUIRE(e1.size() == 3);
+    REQUIRE_FALSE(e1.containsBottom());
+
+    PredicateSetDomain domain;
+    PredicateAbstraction joined = domain.binary_join(e1, e2);
+    REQUIRE(joined == PredicateAbstraction({a, b, c, d}, true));
+    REQUIRE(joined == domain.binary_join(e2, e1));
+    REQUIRE(domain.binary_join(e1, PredicateAbstraction()) == e1);
+
+    REQUIRE(domain.meetPhiIsBottom(joined) == PredicateAbstraction::onlyBottom());
+    REQUIRE(domain.isBottomElement(domain.meetPhiIsBottom(e1)));
+    REQUIRE(domain.meetPhiIsNotBottom(joined) == PredicateAbstraction({a, b, c, d}));
+    REQUIRE_FALSE(domain.isBottomElement(PredicateAbstraction::onlyBottom()));
+    REQUIRE(domain.isBottomElement(domain.meetPhiIsNotBottom(PredicateAbstraction::onlyBottom())));
+}
+
+TEST_CASE("joinPrecisionLoss scores pairs as their full join would") {
+    FeatureVectorHeader header = { FeatureType::NUMERIC };
+    vector<DataRow> rows(200);
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(1);
+        rows[i].x[0] = (float)i;
+        rows[i].y = i % 2;
+    }
+    DataSet data_set = { header, 2, rows };
+    DataReferences all(&data_set);
+
+    DropoutDomains d;
+    vector<BoxDropoutDomain::AbstractionType> disjuncts;
+    disjuncts.push_back(BoxDropoutDomain::AbstractionType()); // Bottom
+    for(unsigned int k = 0; k < 6; k++) {
+        vector<bool> keep(all.size());
+        for(unsigned int i = 0; i < keep.size(); i++) {
+            keep[i] = ((i * (k + 3)) % 11 != 0) && (i % (k + 2) != 1);
+        }
+        DataReferences some = all;
+        some.filter(keep);
+        disjuncts.push_back({
+            TrainingReferencesWithDropout(some, 2 * k + 1, 0, {-1, 0}, 0, {-1, 0}, 0, -1, 0),
+            PredicateAbstraction::onlyBottom(),
+            PosteriorDistributionAbstraction(1)
+        });
+    }
+
+    for(unsigned int i = 0; i < disjuncts.size(); i++) {
+        for(unsigned int j = 0; j < disjuncts.size(); j++) {
+            if(i == 0 && j == 0) {
+                continue; // Nothing to score
+            }
+            INFO("disjuncts " << i << " and " << j);
+            auto joined = d.box_domain.binary_join(disjuncts[i], disjuncts[j]).training_set_abstraction;
+            int increase = joined.num_dropout - std::min(disjuncts[i].training_set_abstraction.num_dropout, disjuncts[j].training_set_abstraction.num_dropout);
+            REQUIRE(d.bounded_disjuncts_domain.joinPrecisionLoss(disjuncts[i], disjuncts[j]) == (double)increase / joined.training_references.size());
+        }
+    }
+}
+
+TEST_CASE("SortedSplitCounts counts each flip-band threshold as filter does, in any order") {
+    DataSet data_set = makeSyntheticDataSet(60, 5, { {FeatureType::NUMERIC, 10, 2}, {FeatureType::BOOLEAN, 3} }, 3,
+        [](unsigned int i, const FeatureVector &x) { return (x[0].getNumericValue() > 2) + (i % 4 == 0); });
+    DataReferences all(&data_set);
+    vector<bool> keep(all.size());
+    for(unsigned int i = 0; i < keep.size(); i++) {
+        keep[i] = (i % 3 != 1);
+    }
+    DataReferences some = all;
+    some.filter(keep);
+
+    // The flip-band candidates bestSplit builds for each value v (next value u, flip amount f),
+    // out of threshold order, plus the bands themselves
+    const float f = 1.5;
+    vector<SymbolicPredicate> phis;
+    for(float v = 0; v < 5; v += 0.5) {
+        float u = v + 0.5;
+        phis.push_back(SymbolicPredicate(0, v - f, u));
+        phis.push_back(SymbolicPredicate(0, v + f, std::max(u, v + f)));
+        phis.push_back(SymbolicPredicate(0, v, u));
+    }
+    for(float v = -f; v < 5 + f; v += 0.5) {
+        phis.push_back(SymbolicPredicate(0, v, v + 0.5));
+    }
+
+    for(const DataReferences &references : {all, some}) {
+        TrainingReferencesWithDropout T(references, 3, 0, {-1, 0}, 2, {-1, 0}, 2, 0, f);
+        SortedSplitCounts split_counts_of(T, 0);
+        for(auto phi = phis.cbegin(); phi != phis.cend(); phi++) {
+            INFO("lb " << phi->get_lb() << ", ub " << phi->get_ub());
+            auto counts = split_counts_of(*phi);
+            TrainingReferencesWithDropout satisfied = T.filter(*phi, true), unsatisfied = T.filter(*phi, false);
+            REQUIRE(counts.first.counts == satisfied.baseCounts());
+            REQUIRE(counts.first.num_dropout == satisfied.num_dropout);
+            REQUIRE(counts.first.num_labels_flip == satisfied.num_labels_flip);
+            REQUIRE(counts.first.num_features_flip == satisfied.num_features_flip);
+            REQUIRE(counts.second.counts == unsatisfied.baseCounts());
+            REQUIRE(counts.second.num_dropout == unsatisfied.num_dropout);
+            REQUIRE(counts.second.num_labels_flip == unsatisfied.num_labels_flip);
+            REQUIRE(counts.second.num_features_flip == unsatisfied.num_features_flip);
+        }
+    }
+}
+
+TEST_CASE("With feature flipping bestSplit keeps a threshold above the largest value") {
+    // Flipping the one row labelled 1 from 5 up to 8 makes a threshold in [5, 8) split the labels perfectly
+    FeatureVectorHeader header = { FeatureType::NUMERIC };
+    vector<float> values = { 1, 1, 5, 5, 5, 5 };
+    vector<DataRow> rows(values.size());
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(1);
+        rows[i].x[0] = values[i];
+        rows[i].y = (i == rows.size() - 1);
+    }
+    DataSet data_set = { header, 2, rows };
+
+    TrainingReferencesWithDropout T(DataReferences(&data_set), 0, 0, {-1, 0}, 0, {-1, 0}, 1, 0, 3);
+    DropoutDomains d;
+    PredicateAbstraction predicates = d.box_domain.bestSplit(T);
+    REQUIRE(std::any_of(predicates.cbegin(), predicates.cend(), [](const SymbolicPredicate &phi) {
+        return phi.get_feature_index() == 0 && phi.get_ub() > 5;
+    }));
+}
@@ -0,0 +1,134 @@
+#include "catch.hpp"
+#include "ASTNode.h"
+#include "ConcreteDecisionTree.h"
+#include "ConcreteSemantics.h"
+#include "ConcreteTrainingReferences.h"
+#include "DataReferences.h"
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include "FlatDecisionTree.h"
+#include "SyntheticDataSet.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+using namespace std;
+
+static void requireSameDistribution(const CategoricalDistribution<double> &actual, const CategoricalDistribution<double> &expected) {
+    REQUIRE(actual.size() == expected.size());
+    for(unsigned int k = 0; k < expected.size(); k++) {
+        REQUIRE(actual[k] == expected[k]);
+    }
+}
+
+static DataSet makeDataSet() {
+    return makeSyntheticDataSet(60, 7, { {FeatureType::NUMERIC, 10}, {FeatureType::NUMERIC, 5}, {FeatureType::BOOLEAN, 4} }, 3,
+        [](unsigned int i, const FeatureVector &x) { return (x[0].getNumericValue() > 3 && !x[2].getBooleanValue()) ? (i % 5 == 0 ? 2 : 1) : 0; });
+}
+
+TEST_CASE("ConcreteDecisionTree classifies like ConcreteSemantics") {
+    DataSet data_set = makeDataSet();
+    const vector<DataRow> &rows = data_set.rows;
+    vector<int> every_other;
+    for(int i = 0; i < 60; i += 2) {
+        every_other.push_back(i);
+    }
+    DataReferences subset(&data_set, every_other);
+
+    ConcreteSemantics sem;
+    for(int depth = 0; depth <= 4; depth++) {
+        ProgramNode *program = buildTree(depth);
+        ConcreteDecisionTree whole(&data_set, depth), part(subset, depth);
+        for(unsigned int i = 0; i < rows.size(); i++) {
+            INFO("depth " << depth << ", input " << i);
+            requireSameDistribution(whole.classify(rows[i].x), sem.execute(rows[i].x, &data_set, program));
+            requireSameDistribution(part.classify(rows[i].x), sem.execute(rows[i].x, &subset, program));
+        }
+        REQUIRE(whole.getNodes().size() <= (2u << depth) - 1);
+        delete program;
+    }
+}
+
+TEST_CASE("bestSplit takes the first least-impurity split, however it finds it") {
+    // Feature 0 is noise, and each of features 1 to 3 splits the labels perfectly
+    FeatureVectorHeader header = { FeatureType::NUMERIC, FeatureType::NUMERIC, FeatureType::BOOLEAN, FeatureType::NUMERIC };
+    vector<DataRow> rows(20);
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].y = (i * 7) % 3 == 0;
+        rows[i].x = FeatureVector(4);
+        rows[i].x[0] = (float)(i % 4);
+        rows[i].x[1] = rows[i].y ? 5.0f + i % 2 : 1.0f + i % 3;
+        rows[i].x[2] = (rows[i].y == 1);
+        rows[i].x[3] = (float)rows[i].y;
+    }
+    DataSet data_set = { header, 2, rows };
+    optional<Predicate> phi = ConcreteTrainingReferences(&data_set).bestSplit();
+    REQUIRE(phi.has_value());
+    REQUIRE(phi->get_feature_index() == 1);
+    REQUIRE(phi->get_threshold() == 4.0f); // Between the largest label 0 value (3) and the smallest label 1 value (5)
+
+    // Without feature 1, the boolean feature comes first
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x[1] = 0.0f;
+    }
+    DataSet without_1 = { header, 2, rows };
+    phi = ConcreteTrainingReferences(&without_1).bestSplit();
+    REQUIRE(phi.has_value());
+    REQUIRE(phi->get_feature_index() == 2);
+}
+
+TEST_CASE("FlatDecisionTree classifies like the tree it flattens, before and after a save and load") {
+    DataSet data_set = makeDataSet();
+    string path = std::filesystem::temp_directory_path().string() + "/test_FlatDecisionTree.tree";
+    vector<int> all_rows;
+    for(unsigned int i = 0; i < data_set.rows.size(); i++) {
+        all_rows.push_back(i);
+    }
+    for(int depth = 0; depth <= 4; depth++) {
+        ConcreteDecisionTree tree(&data_set, depth);
+        FlatDecisionTree flat(tree, data_set.feature_types, data_set.num_categories);
+        REQUIRE(flat.getDepth() <= (unsigned int)depth);
+        REQUIRE(flat.save(path));
+        auto loaded = FlatDecisionTree::load(path);
+        REQUIRE(loaded.has_value());
+        vector<unsigned int> leaves = loaded.value().leavesOf(data_set, all_rows);
+        for(unsigned int i = 0; i < data_set.rows.size(); i++) {
+            INFO("depth " << depth << ", input " << i);
+            requireSameDistribution(flat.classify(data_set.rows[i].x), tree.classify(data_set.rows[i].x));
+            requireSameDistribution(loaded.value().classify(data_set.rows[i].x), tree.classify(data_set.rows[i].x));
+            requireSameDistribution(loaded.value().posterior(leaves[i]), tree.classify(data_set.rows[i].x));
+        }
+    }
+
+    // Neither a truncated file nor a missing one loads
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    REQUIRE_FALSE(FlatDecisionTree::load(path).has_value());
+    std::filesystem::remove(path);
+    REQUIRE_FALSE(FlatDecisionTree::load(path).has_value());
+}
+
+TEST_CASE("FlatDecisionTree stores a tree deeper than 32 levels by its nodes") {
+    // Alternating labels along one feature: every split peels off a single row, so the tree is a chain
+    FeatureVectorHeader header = { FeatureType::NUMERIC };
+    vector<DataRow> rows(80);
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(1);
+        rows[i].x[0] = (float)i;
+        rows[i].y = i % 2;
+    }
+    DataSet data_set = { header, 2, rows };
+    string path = std::filesystem::temp_directory_path().string() + "/test_FlatDecisionTree_deep.tree";
+
+    ConcreteDecisionTree tree(&data_set, 40);
+    FlatDecisionTree flat(tree, data_set.feature_types, data_set.num_categories);
+    REQUIRE(flat.getDepth() > 32);
+    REQUIRE(flat.numLeaves() <= rows.size());
+    REQUIRE(flat.save(path));
+    auto loaded = FlatDecisionTree::load(path);
+    std::filesystem::remove(path);
+    REQUIRE(loaded.has_value());
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        INFO("input " << i);
+        requireSameDistribution(flat.classify(rows[i].x), tree.classify(rows[i].x));
+        requireSameDistribution(loaded.value().classify(rows[i].x), tree.classify(rows[i].x));
+    }
+}
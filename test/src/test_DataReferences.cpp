@@ -32,4 +32,105 @@ TEST_CASE("DataReferences<T> basic operations") {
             REQUIRE(&(data_references[i]) == &(data_set.rows[raw_index]));
         }
     }
+
+    SECTION("Copies share their rows until one of them changes") {
+        DataReferences copy = data_references;
+        REQUIRE(&copy.getIndices() == &data_references.getIndices());
+        copy.filter({true, false, true, false});
+        data_references.remove(0);
+        REQUIRE(copy.getIndices() == vector<int>({0, 2}));
+        REQUIRE(!copy.contains(1));
+        REQUIRE(data_references.getIndices() == vector<int>({1, 2, 3}));
+        REQUIRE(data_references.contains(1));
+        REQUIRE(!data_references.contains(0));
+    }
+}
+
+TEST_CASE("DataReferences column accessors agree with the rows") {
+    FeatureVectorHeader header = { FeatureType::NUMERIC, FeatureType::BOOLEAN };
+    vector<DataRow> rows(3);
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(2);
+        rows[i].x[0] = 0.5f * i;
+        rows[i].x[1] = (i % 2 == 0);
+        rows[i].y = (i == 2 ? 1 : 0);
+    }
+    DataSet data_set = { header, 2, rows };
+
+    DataReferences data_references(&data_set, {0, 2});
+    const DataColumns &columns = data_references.getColumns();
+
+    REQUIRE(columns.size() == 3);
+    for(unsigned int i = 0; i < data_references.size(); i++) {
+        int row = data_references.getIndex(i);
+        REQUIRE(columns.getNumericValue(row, 0) == data_references[i].x[0].getNumericValue());
+        REQUIRE(columns.getBooleanValue(row, 1) == data_references[i].x[1].getBooleanValue());
+        REQUIRE(data_references.getLabel(i) == data_references[i].y);
+    }
+    REQUIRE(data_references.labelCounts() == vector<int>({1, 1}));
+}
+
+TEST_CASE("DataReferences::sortedRows follows the feature order through filter, remove and set_union") {
+    const vector<float> VALUES = { 3, 1, 2, 1, 0, 2 };
+    FeatureVectorHeader header = { FeatureType::NUMERIC };
+    vector<DataRow> rows(VALUES.size());
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(1);
+        rows[i].x[0] = VALUES[i];
+        rows[i].y = 0;
+    }
+    DataSet data_set = { header, 1, rows };
+
+    DataReferences all(&data_set);
+    REQUIRE(all.sortedRows(0) == vector<int>({4, 1, 3, 2, 5, 0})); // Ties broken by row
+
+    DataReferences some = all;
+    some.filter({true, true, false, true, true, true});
+    REQUIRE(some.sortedRows(0) == vector<int>({4, 1, 3, 5, 0}));
+    some.remove(0); // Row 0
+    REQUIRE(some.sortedRows(0) == vector<int>({4, 1, 3, 5}));
+    REQUIRE(all.sortedRows(0).size() == VALUES.size());
+
+    DataReferences others(&data_set, {0, 2});
+    REQUIRE(DataReferences::set_union(some, others).sortedRows(0) == all.sortedRows(0));
+}
+
+TEST_CASE("DataReferences set operations and label counts over many rows") {
+    // Enough rows that labelCounts takes the word-at-a-time path for the larger sets
+    const int NUM_ROWS = 1000;
+    FeatureVectorHeader header = { FeatureType::NUMERIC };
+    vector<DataRow> rows(NUM_ROWS);
+    for(int i = 0; i < NUM_ROWS; i++) {
+        rows[i].x = FeatureVector(1);
+        rows[i].x[0] = (float)i;
+        rows[i].y = i % 3;
+    }
+    DataSet data_set = { header, 3, rows };
+
+    vector<int> evens, threes;
+    for(int i = 0; i < NUM_ROWS; i++) {
+        if(i % 2 == 0) {
+            evens.push_back(i);
+        }
+        if(i % 3 == 0) {
+            threes.push_back(i);
+        }
+    }
+    DataReferences e1(&data_set, evens), e2(&data_set, threes);
+
+    DataReferences u = DataReferences::set_union(e1, e2);
+    DataReferences n = DataReferences::set_intersection(e1, e2);
+    REQUIRE(u.size() == DataReferences::union_size(e1, e2));
+    REQUIRE(u.size() == 500 + 334 - 167);
+    REQUIRE(n.size() == 167);
+    for(unsigned int i = 0; i < u.size(); i++) {
+        REQUIRE((u.getIndex(i) % 2 == 0 || u.getIndex(i) % 3 == 0));
+        REQUIRE((i == 0 || u.getIndex(i - 1) < u.getIndex(i)));
+    }
+
+    REQUIRE(DataReferences(&data_set).labelCounts() == vector<int>({334, 333, 333}));
+    REQUIRE(e2.labelCounts() == vector<int>({334, 0, 0}));
+    REQUIRE(n.labelCounts() == vector<int>({167, 0, 0}));
+    REQUIRE(e1.contains(998));
+    REQUIRE(!e1.contains(999));
 }
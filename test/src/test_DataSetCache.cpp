@@ -0,0 +1,125 @@
+#include "catch.hpp"
+#include "DataSet.hpp"
+#include "DataReferences.h"
+#include "DataSetCache.h"
+#include "ExperimentDataWrangler.h"
+#include "Feature.hpp"
+#include "SplitCounts.h"
+#include "SyntheticDataSet.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+static DataSet* makeDataSet(unsigned int num_rows, unsigned int seed) {
+    // Feature 2 has a negative scale, so sortedRows also sees values at or below 0
+    return new DataSet(makeSyntheticDataSet(num_rows, seed, { {FeatureType::NUMERIC, 13, 4}, {FeatureType::BOOLEAN, 2}, {FeatureType::NUMERIC, 50, -1} }, 3,
+        [](unsigned int i, const FeatureVector &x) { return i % 3; }));
+}
+
+// Compares through the columns, since a loaded training set has no rows
+static void requireSameDataSet(const DataSet &actual, const DataSet &expected) {
+    REQUIRE(actual.feature_types == expected.feature_types);
+    REQUIRE(actual.num_categories == expected.num_categories);
+    const DataColumns &actual_columns = actual.columns(), &expected_columns = expected.columns();
+    REQUIRE(actual_columns.size() == expected.rows.size());
+    for(unsigned int i = 0; i < expected.rows.size(); i++) {
+        REQUIRE(actual_columns.getLabel(i) == expected.rows[i].y);
+        REQUIRE(actual_columns.getNumericValue(i, 0) == expected.rows[i].x[0].getNumericValue());
+        REQUIRE(actual_columns.getBooleanValue(i, 1) == expected.rows[i].x[1].getBooleanValue());
+        REQUIRE(actual_columns.getNumericValue(i, 2) == expected.rows[i].x[2].getNumericValue());
+    }
+    for(unsigned int f = 0; f < expected.feature_types.size(); f += 2) {
+        REQUIRE(actual_columns.sortedRows(f) == expected_columns.sortedRows(f));
+    }
+    REQUIRE(actual_columns.booleanRows(1) == expected_columns.booleanRows(1));
+}
+
+TEST_CASE("DataSetCache round-trips an ExperimentData and notices stale or damaged snapshots") {
+    string directory = std::filesystem::temp_directory_path().string();
+    string source = directory + "/test_DataSetCache.source";
+    string path = directory + "/test_DataSetCache.dscache";
+    ofstream(source) << "some source data";
+
+    ExperimentData data = { makeDataSet(100, 1), makeDataSet(17, 2), {"x", "y", "z"} };
+    REQUIRE(DataSetCache::save(path, "key", {source}, data));
+
+    ExperimentData *loaded = DataSetCache::load(path, "key", {source});
+    REQUIRE(loaded != NULL);
+    REQUIRE(loaded->class_labels == data.class_labels);
+    REQUIRE(loaded->training->rows.empty());
+    requireSameDataSet(*loaded->training, *data.training);
+    REQUIRE(loaded->test->rows.size() == data.test->rows.size());
+    requireSameDataSet(*loaded->test, *data.test);
+    delete loaded->training;
+    delete loaded->test;
+    delete loaded;
+
+    // A different key, or different sources, don't match
+    REQUIRE(DataSetCache::load(path, "other key", {source}) == NULL);
+    REQUIRE(DataSetCache::load(path, "key", {source, source}) == NULL);
+    REQUIRE(DataSetCache::load(path, "key", {directory + "/test_DataSetCache.missing"}) == NULL);
+
+    // Truncated
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    REQUIRE(DataSetCache::load(path, "key", {source}) == NULL);
+
+    // A label outside the categories
+    DataSet *bad_labels = makeDataSet(17, 2);
+    bad_labels->rows[5].y = 3;
+    REQUIRE(DataSetCache::save(path, "key", {source}, { data.training, bad_labels, data.class_labels }));
+    REQUIRE(DataSetCache::load(path, "key", {source}) == NULL);
+    delete bad_labels;
+
+    // Changed source
+    REQUIRE(DataSetCache::save(path, "key", {source}, data));
+    ofstream(source) << "some source data, edited";
+    REQUIRE(DataSetCache::load(path, "key", {source}) == NULL);
+
+    std::remove(source.c_str());
+    std::remove(path.c_str());
+    delete data.training;
+    delete data.test;
+}
+
+TEST_CASE("DataSetCache can leave the training set mapped, column-only") {
+    string directory = std::filesystem::temp_directory_path().string();
+    string source = directory + "/test_DataSetCache_mapped.source";
+    string path = directory + "/test_DataSetCache_mapped.dscache";
+    ofstream(source) << "some source data";
+
+    // More than a chunk of rows, so the chunked scans go around more than once
+    ExperimentData data = { makeDataSet(3 * DataColumns::CHUNK_ROWS / 2, 3), makeDataSet(10, 4), {"x", "y", "z"} };
+    REQUIRE(DataSetCache::save(path, "key", {source}, data));
+    ExperimentData *mapped = DataSetCache::load(path, "key", {source}, true);
+    REQUIRE(mapped != NULL);
+    // The file can go away; the mapping stays valid for as long as the training set lives
+    std::remove(path.c_str());
+
+    REQUIRE(mapped->training->rows.empty());
+    REQUIRE(mapped->training->columns().isMapped());
+    REQUIRE(mapped->training->columns().size() == data.training->rows.size());
+    REQUIRE_FALSE(mapped->test->columns().isMapped());
+    requireSameDataSet(*mapped->test, *data.test);
+
+    DataReferences expected(data.training), actual(mapped->training);
+    REQUIRE(actual.labelCounts() == expected.labelCounts());
+    for(unsigned int f = 0; f < 3; f += 2) {
+        REQUIRE(actual.sortedRows(f) == expected.sortedRows(f));
+        SplitCounts expected_split = countThresholdSplit(expected, f, 1.0, 2.0);
+        SplitCounts actual_split = countThresholdSplit(actual, f, 1.0, 2.0);
+        REQUIRE(actual_split.satisfied == expected_split.satisfied);
+        REQUIRE(actual_split.maybe == expected_split.maybe);
+        REQUIRE(actual_split.unsatisfied == expected_split.unsatisfied);
+    }
+    REQUIRE(countBooleanSplit(actual, 1).satisfied == countBooleanSplit(expected, 1).satisfied);
+
+    std::remove(source.c_str());
+    delete mapped->training;
+    delete mapped->test;
+    delete mapped;
+    delete data.training;
+    delete data.test;
+}
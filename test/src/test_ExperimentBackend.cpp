@@ -0,0 +1,86 @@
+#include "catch.hpp"
+#include "DataSet.hpp"
+#include "ExperimentBackend.h"
+#include "Feature.hpp"
+#include "ThreadPool.h"
+#include <map>
+#include <vector>
+using namespace std;
+
+// A run that certifies exactly the budgets up to threshold, counting its calls
+static ExperimentBackend::Result<Interval<double>> certifiedUpTo(int threshold, int budget, vector<int> &budgets_run) {
+    budgets_run.push_back(budget);
+    ExperimentBackend::Result<Interval<double>> ret;
+    ret.ground_truth = 0;
+    ret.possible_classifications = (budget <= threshold) ? set<int>{0} : set<int>{0, 1};
+    return ret;
+}
+
+TEST_CASE("search_max_radius finds the largest certified budget") {
+    for(int threshold = -1; threshold <= 40; threshold++) {
+        INFO("threshold " << threshold);
+        vector<int> budgets_run;
+        auto result = ExperimentBackend::search_max_radius(100, [threshold, &budgets_run](int budget) { return certifiedUpTo(threshold, budget, budgets_run); });
+        REQUIRE(result.radius == threshold);
+        REQUIRE(result.num_runs == (int)budgets_run.size());
+        REQUIRE(result.at_radius.possible_classifications.size() == (threshold < 0 ? 2 : 1));
+        // Galloping then bisecting takes about 2 log2(threshold) runs
+        REQUIRE(budgets_run.size() <= 2 + 2 * 6);
+    }
+
+    // Certified all the way to the limit, which needn't be a power of 2
+    vector<int> budgets_run;
+    auto result = ExperimentBackend::search_max_radius(20, [&budgets_run](int budget) { return certifiedUpTo(1000, budget, budgets_run); });
+    REQUIRE(result.radius == 20);
+    REQUIRE(budgets_run == vector<int>({0, 1, 2, 4, 8, 16, 20}));
+}
+
+TEST_CASE("search_max_radius agrees with running each budget") {
+    FeatureVectorHeader header = { FeatureType::NUMERIC, FeatureType::BOOLEAN };
+    vector<DataRow> rows(40);
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(2);
+        rows[i].x[0] = (float)(i % 10);
+        rows[i].x[1] = (i % 4 == 0);
+        rows[i].y = (i % 10 > 3) != (i % 9 == 0);
+    }
+    DataSet training = { header, 2, rows }, test = { header, 2, rows };
+    ExperimentBackend e(&training, &test);
+    e.setDecisionOnly(true);
+    for(int test_index = 0; test_index < 40; test_index += 7) {
+        INFO("test index " << test_index);
+        auto result = ExperimentBackend::search_max_radius(e.training_size(), [&e, test_index](int budget) {
+            return e.run_abstract_disjuncts(1, test_index, 0, 0, {-1, 0}, budget, {-1, 0}, 0, -1, 0);
+        });
+        REQUIRE(result.radius >= 0);
+        e.setDecisionOnly(false);
+        REQUIRE(e.run_abstract_disjuncts(1, test_index, 0, 0, {-1, 0}, result.radius, {-1, 0}, 0, -1, 0).possible_classifications.size() == 1);
+        REQUIRE(e.run_abstract_disjuncts(1, test_index, 0, 0, {-1, 0}, result.radius + 1, {-1, 0}, 0, -1, 0).possible_classifications.size() > 1);
+        e.setDecisionOnly(true);
+    }
+}
+
+TEST_CASE("run_test counts the same with and without a thread pool") {
+    FeatureVectorHeader header = { FeatureType::NUMERIC, FeatureType::BOOLEAN };
+    vector<DataRow> rows(30);
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        rows[i].x = FeatureVector(2);
+        rows[i].x[0] = (float)(i % 10);
+        rows[i].x[1] = (i % 4 == 0);
+        rows[i].y = (i % 10 > 3) != (i % 7 == 0);
+    }
+    DataSet training = { header, 2, rows }, test = { header, 2, rows };
+    ExperimentBackend e(&training, &test);
+    vector<int> test_indices = {0, 5, 9, 17, 22};
+    auto serial = e.run_test(2, test_indices, 6, 50, 3);
+    REQUIRE(serial.size() == test_indices.size());
+    for(auto i = serial.cbegin(); i != serial.cend(); i++) {
+        REQUIRE(i->at(0) + i->at(1) >= 50); // Ties count for every tied class
+    }
+
+    ThreadPool pool(4);
+    e.setThreadPool(&pool);
+    REQUIRE(e.run_test(2, test_indices, 6, 50, 3) == serial);
+    REQUIRE(e.run_test(2, {test_indices[2]}, 6, 50, 3)[0] == serial[2]);
+    e.setThreadPool(NULL);
+}
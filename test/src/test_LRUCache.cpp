@@ -0,0 +1,45 @@
+#include "catch.hpp"
+#include "LRUCache.hpp"
+#include <optional>
+#include <string>
+using namespace std;
+
+TEST_CASE("LRUCache remembers values and counts hits and misses") {
+    LRUCache<int, string> cache(100);
+    REQUIRE(!cache.lookup(1).has_value());
+    cache.insert(1, "one", 10);
+    REQUIRE(cache.lookup(1) == optional<string>("one"));
+
+    auto stats = cache.stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.num_entries == 1);
+    REQUIRE(stats.used_bytes == 10);
+}
+
+TEST_CASE("LRUCache evicts the least recently used entries to stay within budget") {
+    LRUCache<int, int> cache(30);
+    cache.insert(1, 1, 10);
+    cache.insert(2, 2, 10);
+    cache.insert(3, 3, 10);
+    cache.lookup(1); // Now 2 is the least recently used
+    cache.insert(4, 4, 10);
+
+    REQUIRE(!cache.lookup(2).has_value());
+    REQUIRE(cache.lookup(1).has_value());
+    REQUIRE(cache.lookup(3).has_value());
+    REQUIRE(cache.lookup(4).has_value());
+    REQUIRE(cache.stats().evictions == 1);
+
+    SECTION("An entry larger than the whole budget is not kept") {
+        cache.insert(5, 5, 31);
+        REQUIRE(!cache.lookup(5).has_value());
+        REQUIRE(cache.stats().num_entries == 3);
+    }
+
+    SECTION("Shrinking the budget evicts immediately") {
+        cache.setCapacity(10);
+        REQUIRE(cache.stats().num_entries == 1);
+        REQUIRE(cache.lookup(4).has_value()); // The most recently used survives
+    }
+}
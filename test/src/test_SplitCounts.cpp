@@ -0,0 +1,63 @@
+#include "catch.hpp"
+#include "DataReferences.h"
+#include "DataSet.hpp"
+#include "Feature.hpp"
+#include "SplitCounts.h"
+#include "SyntheticDataSet.hpp"
+#include <vector>
+using namespace std;
+
+// The counts, by evaluating each row directly
+static SplitCounts expectedSplit(const DataReferences &references, unsigned int feature_index, bool boolean, float lb, float ub) {
+    SplitCounts ret = { vector<int>(2, 0), vector<int>(2, 0), vector<int>(2, 0) };
+    for(unsigned int i = 0; i < references.size(); i++) {
+        const Feature &value = references[i].x[feature_index];
+        int label = references[i].y;
+        if(boolean) {
+            (value.getBooleanValue() ? ret.satisfied : ret.unsatisfied)[label]++;
+        } else if(value.getNumericValue() <= lb) {
+            ret.satisfied[label]++;
+        } else if(value.getNumericValue() < ub) {
+            ret.maybe[label]++;
+        } else {
+            ret.unsatisfied[label]++;
+        }
+    }
+    return ret;
+}
+
+TEST_CASE("Split count kernels agree with evaluating each row") {
+    const unsigned int NUM_ROWS = 1000;
+    DataSet data_set = makeSyntheticDataSet(NUM_ROWS, 11, { {FeatureType::BOOLEAN, 3}, {FeatureType::NUMERIC, 100, 10} }, 2,
+        [](unsigned int i, const FeatureVector &x) { return i % 7 < 3; });
+
+    // Every row (dense), every third row, and a handful of rows (sparse)
+    vector<DataReferences> subsets = { DataReferences(&data_set) };
+    vector<int> every_third, few;
+    for(unsigned int i = 0; i < NUM_ROWS; i += 3) {
+        every_third.push_back(i);
+    }
+    for(unsigned int i = 5; i < NUM_ROWS; i += 97) {
+        few.push_back(i);
+    }
+    subsets.push_back(DataReferences(&data_set, every_third));
+    subsets.push_back(DataReferences(&data_set, few));
+
+    for(bool vectorized : {false, true}) {
+        setSplitCountsVectorized(vectorized);
+        for(auto references = subsets.cbegin(); references != subsets.cend(); references++) {
+            SplitCounts boolean = countBooleanSplit(*references, 0);
+            SplitCounts expected = expectedSplit(*references, 0, true, 0, 0);
+            REQUIRE(boolean.satisfied == expected.satisfied);
+            REQUIRE(boolean.unsatisfied == expected.unsatisfied);
+            REQUIRE(boolean.maybe == expected.maybe);
+
+            SplitCounts threshold = countThresholdSplit(*references, 1, 3.0, 6.5);
+            expected = expectedSplit(*references, 1, false, 3.0, 6.5);
+            REQUIRE(threshold.satisfied == expected.satisfied);
+            REQUIRE(threshold.unsatisfied == expected.unsatisfied);
+            REQUIRE(threshold.maybe == expected.maybe);
+        }
+    }
+    setSplitCountsVectorized(true);
+}
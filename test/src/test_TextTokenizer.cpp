@@ -0,0 +1,71 @@
+#include "catch.hpp"
+#include "TextTokenizer.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+TEST_CASE("TextTokenizer splits lines and fields in place") {
+    string text = "1,2.5,abc\r\n\n   \n+3, -4e2 ,\nx";
+    vector<TextLine> lines = splitLines(text.data(), text.data() + text.size());
+    REQUIRE(lines.size() == 3);
+    REQUIRE(lines[0].number == 1);
+    REQUIRE(string(lines[0].begin, lines[0].end) == "1,2.5,abc");
+    REQUIRE(lines[1].number == 4);
+    REQUIRE(lines[2].number == 5);
+
+    vector<string> fields;
+    auto collect = [&fields](unsigned int, const char *begin, const char *end) { fields.push_back(string(begin, end)); return true; };
+    REQUIRE(forEachField(lines[0], ',', collect) == 3);
+    // As with getline, the trailing comma doesn't make an empty field
+    REQUIRE(forEachField(lines[1], ',', collect) == 2);
+    REQUIRE(fields == vector<string>({"1", "2.5", "abc", "+3", " -4e2 "}));
+
+    float value;
+    REQUIRE(parseFloatField(fields[1].data(), fields[1].data() + fields[1].size(), value));
+    REQUIRE(value == 2.5f);
+    REQUIRE(parseFloatField(fields[3].data(), fields[3].data() + fields[3].size(), value));
+    REQUIRE(value == 3.0f);
+    REQUIRE(parseFloatField(fields[4].data(), fields[4].data() + fields[4].size(), value));
+    REQUIRE(value == -400.0f);
+    REQUIRE_FALSE(parseFloatField(fields[2].data(), fields[2].data() + fields[2].size(), value));
+    string partial = "1.5x", empty = " ", sign = "+-1";
+    REQUIRE_FALSE(parseFloatField(partial.data(), partial.data() + partial.size(), value));
+    REQUIRE_FALSE(parseFloatField(empty.data(), empty.data() + empty.size(), value));
+    REQUIRE_FALSE(parseFloatField(sign.data(), sign.data() + sign.size(), value));
+}
+
+TEST_CASE("TextTokenizer parses chunks in parallel but keeps rows and issues in line order") {
+    const unsigned int num_lines = PARALLEL_MIN_LINES + 3 * LINES_PER_CHUNK / 2;
+    string text;
+    for(unsigned int i = 0; i < num_lines; i++) {
+        text += (i % 1000 == 7 ? "bad" : to_string(i)) + ",x\n";
+    }
+    vector<TextLine> lines = splitLines(text.data(), text.data() + text.size());
+    vector<float> rows;
+    vector<TextIssue> issues;
+    parseLines(lines, [](const TextLine &line, float &row, vector<TextIssue> &issues) {
+        bool ok = true;
+        forEachField(line, ',', [&](unsigned int column, const char *begin, const char *end) {
+            if(column == 0 && !parseFloatField(begin, end, row)) {
+                issues.push_back({ line.number, column + 1, "Invalid number" });
+                ok = false;
+            }
+            return ok;
+        });
+        return ok;
+    }, rows, issues);
+
+    REQUIRE(issues.size() == (num_lines + 992) / 1000);
+    REQUIRE(rows.size() == num_lines - issues.size());
+    unsigned int expected = 0;
+    for(unsigned int i = 0; i < rows.size(); i++, expected++) {
+        if(expected % 1000 == 7) {
+            expected++;
+        }
+        REQUIRE(rows[i] == (float)expected);
+    }
+    for(unsigned int i = 0; i < issues.size(); i++) {
+        REQUIRE(issues[i].line == 1000 * i + 8);
+        REQUIRE(issues[i].column == 1);
+    }
+}
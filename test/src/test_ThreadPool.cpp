@@ -0,0 +1,62 @@
+#include "catch.hpp"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+TEST_CASE("ThreadPool runs every task submitted through a TaskGroup") {
+    ThreadPool pool(4);
+    const int NUM_TASKS = 1000;
+    vector<int> slots(NUM_TASKS, 0);
+    atomic<int> count(0);
+
+    TaskGroup group(&pool);
+    for(int i = 0; i < NUM_TASKS; i++) {
+        group.run([i, &slots, &count]() { slots[i] = i; count++; });
+    }
+    group.wait();
+
+    REQUIRE(count == NUM_TASKS);
+    for(int i = 0; i < NUM_TASKS; i++) {
+        REQUIRE(slots[i] == i);
+    }
+}
+
+TEST_CASE("Nested TaskGroups do not deadlock a small pool") {
+    // More outer tasks than workers, each of which waits on inner tasks
+    ThreadPool pool(2);
+    atomic<int> count(0);
+    TaskGroup outer(&pool);
+    for(int i = 0; i < 8; i++) {
+        outer.run([&pool, &count]() {
+            TaskGroup inner(&pool);
+            for(int j = 0; j < 8; j++) {
+                inner.run([&count]() { count++; });
+            }
+            inner.wait();
+        });
+    }
+    outer.wait();
+    REQUIRE(count == 64);
+}
+
+TEST_CASE("parallelFor covers the range exactly once, with or without a pool") {
+    const size_t N = 10007;
+    ThreadPool pool(3);
+    ThreadPool *pools[2] = {&pool, NULL};
+    for(int p = 0; p < 2; p++) {
+        vector<atomic<int>> hits(N);
+        parallelFor(pools[p], 0, N, 64, [&hits](size_t i) { hits[i]++; });
+        for(size_t i = 0; i < N; i++) {
+            REQUIRE(hits[i] == 1);
+        }
+    }
+}
+
+TEST_CASE("TaskGroup::wait rethrows an exception raised by a task") {
+    ThreadPool pool(2);
+    TaskGroup group(&pool);
+    group.run([]() { throw 42; });
+    REQUIRE_THROWS_AS(group.wait(), int);
+}
@@ -0,0 +1,205 @@
+#include "catch.hpp"
+#include "AbstractSemanticsInstantiations.hpp"
+#include "ASTNode.h"
+#include "DataReferences.h"
+#include "DataSet.hpp"
+#include "DropoutDomains.hpp"
+#include "Feature.hpp"
+#include "RunProfile.h"
+#include "SyntheticDataSet.hpp"
+#include "ThreadPool.h"
+#include <vector>
+using namespace std;
+
+static DataSet makeDataSet(unsigned int num_rows) {
+    // The abstract summary only handles binary labels
+    return makeSyntheticDataSet(num_rows, 11, { {FeatureType::NUMERIC, 9}, {FeatureType::NUMERIC, 6, 2}, {FeatureType::BOOLEAN, 3} }, 2,
+        [](unsigned int i, const FeatureVector &x) { return (x[0].getNumericValue() > 4) != (i % 7 == 0); });
+}
+
+static void requireSameBox(const BoxDropoutDomain::AbstractionType &actual, const BoxDropoutDomain::AbstractionType &expected) {
+    REQUIRE(PackedTrainingReferencesWithDropout(actual.training_set_abstraction) == PackedTrainingReferencesWithDropout(expected.training_set_abstraction));
+    REQUIRE(actual.predicate_abstraction == expected.predicate_abstraction);
+    REQUIRE(actual.posterior_distribution_abstraction.size() == expected.posterior_distribution_abstraction.size());
+    for(unsigned int k = 0; k < expected.posterior_distribution_abstraction.size(); k++) {
+        REQUIRE(actual.posterior_distribution_abstraction[k] == expected.posterior_distribution_abstraction[k]);
+    }
+}
+
+static void requireSameDisjuncts(const BoxDisjunctsDomainDropoutInstantiation::AbstractionType &actual, const BoxDisjunctsDomainDropoutInstantiation::AbstractionType &expected) {
+    REQUIRE(actual.size() == expected.size());
+    for(unsigned int j = 0; j < expected.size(); j++) {
+        requireSameBox(actual[j], expected[j]);
+    }
+}
+
+TEST_CASE("The unrolled semantics agree with the visitor semantics on buildTree") {
+    DataSet data_set = makeDataSet(50);
+    DataReferences training_references(&data_set);
+    BoxDropoutDomain::AbstractionType initial_box = {
+        TrainingReferencesWithDropout(training_references, 2, 0, {-1, 0}, 1, {-1, 0}, 0, -1, 0),
+        PredicateAbstraction::onlyBottom(),
+        PosteriorDistributionAbstraction(1)
+    };
+
+    for(int depth = 0; depth <= 2; depth++) {
+        ProgramNode *program = buildTree(depth);
+        DropoutDomains d;
+        d.bounded_disjuncts_domain.setMergeDetails(3, DisjunctsMergeMode::GREEDY);
+        BoxDropoutSemantics box_sem(&d.box_domain);
+        BoxDropoutUnrolledSemantics box_unrolled(&d.box_domain);
+        BoxDisjunctsDropoutSemantics disjuncts_sem(&d.disjuncts_domain), bounded_sem(&d.bounded_disjuncts_domain);
+        BoxDisjunctsDropoutUnrolledSemantics disjuncts_unrolled(&d.disjuncts_domain);
+        BoxBoundedDisjunctsDropoutUnrolledSemantics bounded_unrolled(&d.bounded_disjuncts_domain);
+        for(unsigned int i = 0; i < data_set.rows.size(); i += 7) {
+            const FeatureVector &x = data_set.rows[i].x;
+            INFO("depth " << depth << ", test input " << i);
+            requireSameBox(box_unrolled.execute(x, initial_box, depth), box_sem.execute(x, initial_box, program));
+            requireSameDisjuncts(disjuncts_unrolled.execute(x, {initial_box}, depth), disjuncts_sem.execute(x, {initial_box}, program));
+            requireSameDisjuncts(bounded_unrolled.execute(x, {initial_box}, depth), bounded_sem.execute(x, {initial_box}, program));
+        }
+        delete program;
+    }
+
+    // Past MAX_UNROLLED_DEPTH, the unrolled semantics recurse at runtime first
+    int depth = BoxDropoutUnrolledSemantics::MAX_UNROLLED_DEPTH + 2;
+    ProgramNode *program = buildTree(depth);
+    DropoutDomains d;
+    BoxDropoutSemantics box_sem(&d.box_domain);
+    BoxDropoutUnrolledSemantics box_unrolled(&d.box_domain);
+    for(unsigned int i = 0; i < data_set.rows.size(); i += 7) {
+        const FeatureVector &x = data_set.rows[i].x;
+        requireSameBox(box_unrolled.execute(x, initial_box, depth), box_sem.execute(x, initial_box, program));
+    }
+    delete program;
+}
+
+TEST_CASE("The unrolled semantics give the same results with branches forked on a thread pool") {
+    DataSet data_set = makeDataSet(50);
+    DataReferences training_references(&data_set);
+    BoxDropoutDomain::AbstractionType initial_box = {
+        TrainingReferencesWithDropout(training_references, 3, 0, {-1, 0}, 1, {-1, 0}, 0, -1, 0),
+        PredicateAbstraction::onlyBottom(),
+        PosteriorDistributionAbstraction(1)
+    };
+    ThreadPool pool(4);
+    DropoutDomains d;
+    d.bounded_disjuncts_domain.setMergeDetails(4, DisjunctsMergeMode::OPTIMAL);
+    BoxDropoutUnrolledSemantics box_serial(&d.box_domain), box_forked(&d.box_domain);
+    BoxDisjunctsDropoutUnrolledSemantics disjuncts_serial(&d.disjuncts_domain), disjuncts_forked(&d.disjuncts_domain);
+    BoxBoundedDisjunctsDropoutUnrolledSemantics bounded_serial(&d.bounded_disjuncts_domain), bounded_forked(&d.bounded_disjuncts_domain);
+    box_forked.setThreadPool(&pool);
+    disjuncts_forked.setThreadPool(&pool);
+    bounded_forked.setThreadPool(&pool);
+    for(unsigned int i = 0; i < data_set.rows.size(); i += 5) {
+        const FeatureVector &x = data_set.rows[i].x;
+        requireSameBox(box_forked.execute(x, initial_box, 3), box_serial.execute(x, initial_box, 3));
+        requireSameDisjuncts(disjuncts_forked.execute(x, {initial_box}, 3), disjuncts_serial.execute(x, {initial_box}, 3));
+        requireSameDisjuncts(bounded_forked.execute(x, {initial_box}, 3), bounded_serial.execute(x, {initial_box}, 3));
+    }
+}
+
+TEST_CASE("A cutoff stops the unrolled semantics at the first leaf it rejects") {
+    DataSet data_set = makeDataSet(50);
+    DataReferences training_references(&data_set);
+    BoxDropoutDomain::AbstractionType initial_box = {
+        TrainingReferencesWithDropout(training_references, 3, 0, {-1, 0}, 0, {-1, 0}, 0, -1, 0),
+        PredicateAbstraction::onlyBottom(),
+        PosteriorDistributionAbstraction(1)
+    };
+    DropoutDomains d;
+    BoxDisjunctsDropoutUnrolledSemantics uncut(&d.disjuncts_domain), never_cut(&d.disjuncts_domain), cut(&d.disjuncts_domain);
+    unsigned int never_cut_leaves = 0, cut_leaves = 0;
+    never_cut.setCutoff([&never_cut_leaves](const BoxDisjunctsDomainDropoutInstantiation::AbstractionType &) { never_cut_leaves++; return false; });
+    cut.setCutoff([&cut_leaves](const BoxDisjunctsDomainDropoutInstantiation::AbstractionType &) { cut_leaves++; return true; });
+    const FeatureVector &x = data_set.rows[0].x;
+
+    requireSameDisjuncts(never_cut.execute(x, {initial_box}, 3), uncut.execute(x, {initial_box}, 3));
+    REQUIRE_FALSE(never_cut.wasCutShort());
+    REQUIRE(never_cut_leaves > 1);
+
+    cut.execute(x, {initial_box}, 3);
+    REQUIRE(cut.wasCutShort());
+    REQUIRE(cut_leaves == 1);
+}
+
+#ifndef NO_PROFILING
+TEST_CASE("A run profile sees the transformers of the runs in its scope, forked branches included") {
+    DataSet data_set = makeDataSet(50);
+    DataReferences training_references(&data_set);
+    BoxDropoutDomain::AbstractionType initial_box = {
+        TrainingReferencesWithDropout(training_references, 3, 0, {-1, 0}, 0, {-1, 0}, 0, -1, 0),
+        PredicateAbstraction::onlyBottom(),
+        PosteriorDistributionAbstraction(1)
+    };
+    ThreadPool pool(4);
+    DropoutDomains d;
+    BoxDisjunctsDropoutUnrolledSemantics serial(&d.disjuncts_domain), forked(&d.disjuncts_domain);
+    forked.setThreadPool(&pool);
+    const FeatureVector &x = data_set.rows[0].x;
+
+    RunProfile serial_profile, forked_profile;
+    {
+        RunProfile::Scope scope(&serial_profile);
+        serial.execute(x, {initial_box}, 3);
+    }
+    {
+        RunProfile::Scope scope(&forked_profile);
+        forked.execute(x, {initial_box}, 3);
+    }
+    serial.execute(x, {initial_box}, 3); // In no scope
+    REQUIRE(RunProfile::current() == NULL);
+
+    REQUIRE(serial_profile.numCalls(RunProfile::Probe::BEST_SPLIT) > 0);
+    REQUIRE(serial_profile.numReaching(0) == 1);
+    REQUIRE(serial_profile.numReaching(3) > 0);
+    REQUIRE(serial_profile.allocatedBytes() > 0);
+    for(unsigned int i = 0; i < RunProfile::NUM_PROBES; i++) {
+        REQUIRE(forked_profile.numCalls((RunProfile::Probe)i) == serial_profile.numCalls((RunProfile::Probe)i));
+    }
+    for(int depth = 0; depth <= 3; depth++) {
+        REQUIRE(forked_profile.numReaching(depth) == serial_profile.numReaching(depth));
+    }
+}
+#endif
+
+// Hidden (run with: test/bin/tester "[benchmark]"); the domain work is the same either way,
+// so this measures what the virtual visitor costs on top of it
+TEST_CASE("Benchmark the unrolled semantics against the visitor semantics", "[.][benchmark]") {
+    DataSet data_set = makeDataSet(2000);
+    DataReferences training_references(&data_set);
+    BoxDropoutDomain::AbstractionType initial_box = {
+        TrainingReferencesWithDropout(training_references, 4, 0, {-1, 0}, 0, {-1, 0}, 0, -1, 0),
+        PredicateAbstraction::onlyBottom(),
+        PosteriorDistributionAbstraction(1)
+    };
+    const int depth = 4;
+    ProgramNode *program = buildTree(depth);
+    DropoutDomains d;
+    BoxDropoutSemantics box_sem(&d.box_domain);
+    BoxDropoutUnrolledSemantics box_unrolled(&d.box_domain);
+    BoxDisjunctsDropoutSemantics disjuncts_sem(&d.disjuncts_domain);
+    BoxDisjunctsDropoutUnrolledSemantics disjuncts_unrolled(&d.disjuncts_domain);
+
+    BENCHMARK("box domain, visitor") {
+        for(unsigned int i = 0; i < data_set.rows.size(); i += 100) {
+            box_sem.execute(data_set.rows[i].x, initial_box, program);
+        }
+    }
+    BENCHMARK("box domain, unrolled") {
+        for(unsigned int i = 0; i < data_set.rows.size(); i += 100) {
+            box_unrolled.execute(data_set.rows[i].x, initial_box, depth);
+        }
+    }
+    BENCHMARK("disjuncts domain, visitor") {
+        for(unsigned int i = 0; i < data_set.rows.size(); i += 100) {
+            disjuncts_sem.execute(data_set.rows[i].x, {initial_box}, program);
+        }
+    }
+    BENCHMARK("disjuncts domain, unrolled") {
+        for(unsigned int i = 0; i < data_set.rows.size(); i += 100) {
+            disjuncts_unrolled.execute(data_set.rows[i].x, {initial_box}, depth);
+        }
+    }
+    delete program;
+}